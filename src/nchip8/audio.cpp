@@ -0,0 +1,281 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "audio.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nchip8
+{
+
+//! Peak of the square wave, about a quarter of full scale
+static constexpr std::int16_t amplitude = 8000;
+
+//! @brief Appends a little endian integer of some number of bytes
+static void put_le(std::string &out, const std::uint64_t &value, const unsigned &bytes)
+{
+    for(unsigned b = 0; b < bytes; b++)
+    {
+        out += static_cast<char>((value >> (8 * b)) & 0xFF);
+    }
+}
+
+wav_sink::wav_sink(const std::string &path, const std::uint32_t &sample_rate) :
+    m_out(path, std::ios::binary | std::ios::trunc),
+    m_sample_rate(sample_rate)
+{
+    if(!m_out)
+    {
+        throw std::runtime_error("could not open " + path + " for audio");
+    }
+
+    write_header();
+}
+
+wav_sink::~wav_sink()
+{
+    // now the sizes are known
+    m_out.seekp(0);
+    write_header();
+}
+
+void wav_sink::write(const std::int16_t* samples, const std::size_t &count)
+{
+    std::string data;
+    data.reserve(count * 2);
+
+    for(std::size_t i = 0; i < count; i++)
+    {
+        put_le(data, static_cast<std::uint16_t>(samples[i]), 2);
+    }
+
+    m_out.write(data.data(), data.size());
+    m_samples += count;
+}
+
+void wav_sink::write_header()
+{
+    const std::uint64_t data_size = m_samples * 2;
+
+    // RIFF, then a PCM fmt chunk for mono 16-bit, then the data chunk
+    std::string header = "RIFF";
+    put_le(header, 36 + data_size, 4);
+    header += "WAVEfmt ";
+    put_le(header, 16, 4);
+    put_le(header, 1, 2);
+    put_le(header, 1, 2);
+    put_le(header, m_sample_rate, 4);
+    put_le(header, m_sample_rate * 2, 4);
+    put_le(header, 2, 2);
+    put_le(header, 16, 2);
+    header += "data";
+    put_le(header, data_size, 4);
+
+    m_out.write(header.data(), header.size());
+    m_out.flush();
+}
+
+void null_sink::write(const std::int16_t*, const std::size_t &count)
+{
+    m_samples += count;
+}
+
+std::uint64_t null_sink::get_samples() const
+{
+    return m_samples;
+}
+
+audio_synth::audio_synth(std::unique_ptr<audio_sink> sink, const audio_pacing &pacing,
+                         const std::uint32_t &sample_rate, const std::uint32_t &tone) :
+    m_sink(std::move(sink)),
+    m_pacing(pacing),
+    m_sample_rate(std::max<std::uint32_t>(sample_rate, 1)),
+    m_underruns(0),
+    m_latency_us(0),
+    m_max_latency_us(0),
+    m_edges_dropped(0),
+    m_samples_written(0),
+    m_stop(false),
+    m_phase_step(static_cast<std::uint32_t>((std::uint64_t(tone) << 32) / m_sample_rate))
+{
+    m_audio_thread = std::thread(&audio_synth::audio_thread, this);
+}
+
+audio_synth::~audio_synth()
+{
+    m_stop = true;
+    m_audio_thread.join();
+}
+
+void audio_synth::push_edge(const std::uint64_t &cycle, const std::uint32_t &speed, const bool &on)
+{
+    if(!m_queue.try_push(sound_edge { cycle, speed, on, clock::now() }))
+    {
+        m_edges_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::size_t audio_synth::get_underruns() const
+{
+    return m_underruns;
+}
+
+std::chrono::microseconds audio_synth::get_latency() const
+{
+    return std::chrono::microseconds(m_latency_us);
+}
+
+std::chrono::microseconds audio_synth::get_max_latency() const
+{
+    return std::chrono::microseconds(m_max_latency_us);
+}
+
+std::size_t audio_synth::get_edges_dropped() const
+{
+    return m_edges_dropped;
+}
+
+std::uint64_t audio_synth::get_samples_written() const
+{
+    return m_samples_written;
+}
+
+void audio_synth::audio_thread()
+{
+    // a sound card's worth of buffering: 10ms periods, 40ms queued before starting, never more than 200ms
+    const std::size_t period = std::max<std::size_t>(m_sample_rate / 100, 1);
+    const std::size_t prebuffer = period * 4;
+    const std::size_t backlog = std::max<std::size_t>(m_sample_rate / 5, prebuffer);
+
+    const auto period_time = std::chrono::microseconds(1000000 * period / m_sample_rate);
+    auto next_period = clock::now();
+
+    // realtime: playing, rather than waiting for the prebuffer to fill
+    bool primed = false;
+
+    while(true)
+    {
+        // the producer has gone by the time m_stop is set, so once it's seen, one more drain gets everything
+        const bool stopping = m_stop;
+
+        sound_edge edge;
+        while(m_queue.try_pop(edge))
+        {
+            render_to(edge);
+        }
+
+        if(stopping)
+        {
+            write_pending(m_pending.size(), m_pending.size());
+            return;
+        }
+
+        if(m_pacing == audio_pacing::emulated)
+        {
+            if(!m_pending.empty())  { write_pending(m_pending.size(), m_pending.size()); }
+            else                    { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
+
+            continue;
+        }
+
+        // emulation is running ahead of the wall clock, catch up by skipping the oldest samples
+        if(m_pending.size() > backlog)
+        {
+            const std::size_t skipped = m_pending.size() - prebuffer;
+            m_pending.erase(m_pending.begin(), m_pending.begin() + skipped);
+            m_consumed += skipped;
+
+            while(!m_in_flight.empty() && m_in_flight.front().first <= m_consumed) { m_in_flight.pop_front(); }
+        }
+
+        if(!primed) { primed = (m_pending.size() >= prebuffer); }
+
+        if(primed)
+        {
+            // one underrun per stall, then silence until the prebuffer has filled again (e.g. while paused)
+            if(m_pending.size() < period)
+            {
+                m_underruns++;
+                primed = false;
+            }
+
+            write_pending(period, period);
+        }
+        else
+        {
+            write_pending(0, period);
+        }
+
+        next_period += period_time;
+
+        // don't try to catch up after a long stall
+        const auto now = clock::now();
+        if(now - next_period > period_time * 4) { next_period = now; }
+
+        std::this_thread::sleep_until(next_period);
+    }
+}
+
+void audio_synth::render_to(const sound_edge &edge)
+{
+    // the first edge, or a new timeline, has nothing before it to render
+    if(m_last.m_clock != 0 && edge.m_cycle >= m_last.m_cycle)
+    {
+        const std::uint64_t scaled = (edge.m_cycle - m_last.m_cycle) * m_sample_rate + m_remainder;
+        const std::uint32_t speed = std::max<std::uint32_t>(edge.m_clock, 1);
+
+        const std::uint64_t samples = scaled / speed;
+        m_remainder = scaled % speed;
+
+        for(std::uint64_t s = 0; s < samples; s++)
+        {
+            const std::int16_t high = (m_phase & 0x80000000u) ? amplitude : -amplitude;
+            m_pending.push_back(m_last.m_on ? high : 0);
+            m_phase += m_phase_step;
+        }
+
+        m_rendered += samples;
+    }
+    else
+    {
+        m_remainder = 0;
+    }
+
+    m_in_flight.emplace_back(m_rendered, edge.m_pushed);
+    m_last = edge;
+}
+
+void audio_synth::write_pending(const std::size_t &count, const std::size_t &total)
+{
+    const std::size_t taken = std::min(count, m_pending.size());
+
+    std::vector<std::int16_t> samples(m_pending.begin(), m_pending.begin() + taken);
+    samples.resize(total, 0);
+
+    m_pending.erase(m_pending.begin(), m_pending.begin() + taken);
+    m_consumed += taken;
+
+    if(!samples.empty())
+    {
+        m_sink->write(samples.data(), samples.size());
+        m_samples_written += samples.size();
+    }
+
+    // every edge whose sample has now gone out
+    const auto now = clock::now();
+
+    while(!m_in_flight.empty() && m_in_flight.front().first <= m_consumed)
+    {
+        const std::int64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - m_in_flight.front().second).count();
+
+        m_latency_us = latency;
+        if(latency > m_max_latency_us) { m_max_latency_us = latency; }
+
+        m_in_flight.pop_front();
+    }
+}
+
+}
@@ -0,0 +1,182 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_AUDIO_HPP
+#define NCHIP8_AUDIO_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "spsc_ring.hpp"
+
+namespace nchip8
+{
+
+//! @brief Where rendered audio goes, mono signed 16-bit PCM
+class audio_sink
+{
+public:
+    virtual ~audio_sink() = default;
+
+    //! @brief      Takes the next samples
+    //! @details    Only ever called from the audio thread
+    virtual void write(const std::int16_t* samples, const std::size_t &count) = 0;
+};
+
+//! @brief Writes a WAV file, the sizes in the header are filled in when it's destroyed
+class wav_sink : public audio_sink
+{
+public:
+    //! @param path     The file to write, replaced if it exists
+    //! @throws         std::runtime_error if it can't be opened
+    wav_sink(const std::string &path, const std::uint32_t &sample_rate);
+
+    virtual ~wav_sink();
+
+    void write(const std::int16_t* samples, const std::size_t &count) override;
+
+private:
+    std::ofstream m_out;
+
+    std::uint32_t m_sample_rate;
+
+    //! Samples written so far
+    std::uint64_t m_samples = 0;
+
+    //! @brief Writes the RIFF header for m_samples samples at the start of the file
+    void write_header();
+};
+
+//! @brief Throws samples away, for benchmarks
+class null_sink : public audio_sink
+{
+public:
+    void write(const std::int16_t* samples, const std::size_t &count) override;
+
+    //! @brief Returns the number of samples thrown away
+    std::uint64_t get_samples() const;
+
+private:
+    std::atomic<std::uint64_t> m_samples { 0 };
+};
+
+//! @brief How the audio thread hands samples to its sink
+enum class audio_pacing : std::uint8_t
+{
+    //! As fast as emulation produces them, for headless runs and files
+    emulated,
+
+    //! One period at a time on the wall clock, the way a sound card pulls them, for local sessions.
+    //! If emulation hasn't produced enough by then, the gap is filled with silence and counted as an underrun
+    realtime
+};
+
+//! @brief      Renders the sound timer's buzzer as a square wave on its own thread
+//! @details    The cpu thread pushes the cycles the buzzer turns on and off at, plus a mark at the end of
+//!             every burst, into a lock-free queue. The audio thread turns cycles into sample positions,
+//!             so edges land on the right sample whatever the burst size, and nothing the sink does can
+//!             hold the cpu thread up. If the queue is ever full, the edge is dropped and counted.
+class audio_synth
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    //! @param sink         Where samples go, owned by the audio thread from here on
+    //! @param sample_rate  Samples per second
+    //! @param tone         Square wave frequency in Hz
+    audio_synth(std::unique_ptr<audio_sink> sink, const audio_pacing &pacing,
+                const std::uint32_t &sample_rate = 44100, const std::uint32_t &tone = 440);
+
+    //! @brief Renders whatever is still queued, then stops the audio thread and destroys the sink
+    virtual ~audio_synth();
+
+    //! @brief          Queues the buzzer's state as of a cycle, never blocks
+    //! @param cycle    Emulated cycle, a cycle lower than the last one starts a new timeline (e.g. a reset)
+    //! @param speed    Cycles per second the emulation ran at up to this cycle
+    //! @param on       True while the sound timer is non-zero
+    //! @details        Only ever call from one thread. Pushing the same state again just moves time on
+    void push_edge(const std::uint64_t &cycle, const std::uint32_t &speed, const bool &on);
+
+    //! @brief Returns the number of times the sink had to be given silence because emulation fell behind
+    std::size_t get_underruns() const;
+
+    //! @brief Returns how long the last edge written to the sink took to get there after it was pushed
+    std::chrono::microseconds get_latency() const;
+
+    //! @brief Returns the longest that's been
+    std::chrono::microseconds get_max_latency() const;
+
+    //! @brief Returns the number of edges dropped because the queue was full
+    std::size_t get_edges_dropped() const;
+
+    //! @brief Returns the number of samples given to the sink, including silence filled in for underruns
+    std::uint64_t get_samples_written() const;
+
+private:
+    //! @brief A point on the emulated timeline
+    struct sound_edge
+    {
+        std::uint64_t m_cycle;
+        std::uint32_t m_clock;
+        bool m_on;
+        clock::time_point m_pushed;
+    };
+
+    std::unique_ptr<audio_sink> m_sink;
+    audio_pacing m_pacing;
+    std::uint32_t m_sample_rate;
+
+    spsc_ring<sound_edge, 1024> m_queue;
+
+    std::atomic<std::size_t> m_underruns;
+    std::atomic<std::int64_t> m_latency_us;
+    std::atomic<std::int64_t> m_max_latency_us;
+    std::atomic<std::size_t> m_edges_dropped;
+    std::atomic<std::uint64_t> m_samples_written;
+
+    //! Set by the destructor, the audio thread drains the queue and exits
+    std::atomic<bool> m_stop;
+
+    //! Audio thread only: the last edge rendered up to, and the fraction of a sample left over (in cycles * rate)
+    sound_edge m_last {};
+    std::uint64_t m_remainder = 0;
+
+    //! Audio thread only: square wave phase, a full turn is 2^32
+    std::uint32_t m_phase = 0;
+    std::uint32_t m_phase_step;
+
+    //! Audio thread only: rendered samples not yet given to the sink
+    std::deque<std::int16_t> m_pending;
+
+    //! Audio thread only: samples ever added to and taken from m_pending
+    std::uint64_t m_rendered = 0;
+    std::uint64_t m_consumed = 0;
+
+    //! Audio thread only: when each edge rendered but not yet written was pushed, by its position in m_rendered
+    std::deque<std::pair<std::uint64_t, clock::time_point>> m_in_flight;
+
+    //! Thread object for void audio_thread()
+    std::thread m_audio_thread;
+
+    //! @brief Renders and writes until m_stop is set and the queue is empty
+    void audio_thread();
+
+    //! @brief Renders samples from the last edge up to this one, then takes on its state
+    void render_to(const sound_edge &edge);
+
+    //! @brief Writes up to count samples from m_pending, padded with silence to total
+    void write_pending(const std::size_t &count, const std::size_t &total);
+};
+
+}
+
+#endif //NCHIP8_AUDIO_HPP
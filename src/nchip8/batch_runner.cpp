@@ -0,0 +1,359 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "batch_runner.hpp"
+#include "hash.hpp"
+#include "io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace nchip8
+{
+
+//! First line of a frame trace file
+static const char* const frame_trace_magic = "nchip8 frame hashes 1";
+
+std::uint64_t frame_trace::get_hash(const std::size_t &frame) const
+{
+    if(frame >= m_frames) { return 0; }
+
+    // the last change at or before the frame
+    auto after = std::upper_bound(m_changes.begin(), m_changes.end(), frame,
+        [](const std::size_t &f, const std::pair<std::size_t, std::uint64_t> &change) { return f < change.first; });
+
+    return (after == m_changes.begin()) ? 0 : std::prev(after)->second;
+}
+
+void write_frame_traces(const std::string &path, const std::vector<batch_result> &results)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if(!out) { throw std::runtime_error("could not open " + path + " for writing"); }
+
+    out << frame_trace_magic << '\n';
+
+    // rom <frames> <sequence hash> <changes> <name>, then one <frame> <hash> line per change
+    for(const batch_result &result : results)
+    {
+        if(!result.m_error.empty()) { continue; }
+
+        const frame_trace &trace = result.m_frames;
+
+        out << "rom " << std::dec << trace.m_frames << ' ' << std::hex << trace.m_sequence_hash
+            << ' ' << std::dec << trace.m_changes.size() << ' ' << result.m_rom << '\n';
+
+        for(const auto &change : trace.m_changes)
+        {
+            out << std::dec << change.first << ' ' << std::hex << change.second << '\n';
+        }
+    }
+
+    if(!out.flush()) { throw std::runtime_error("could not write " + path); }
+}
+
+frame_traces read_frame_traces(const std::string &path)
+{
+    std::ifstream in(path);
+    if(!in) { throw std::runtime_error("could not open " + path); }
+
+    std::string line;
+    if(!std::getline(in, line) || line != frame_trace_magic)
+    {
+        throw std::runtime_error(path + " is not a frame trace file");
+    }
+
+    frame_traces traces;
+
+    while(std::getline(in, line))
+    {
+        if(line.empty()) { continue; }
+
+        std::stringstream header(line);
+        std::string tag, name;
+        frame_trace trace;
+        std::size_t changes = 0;
+
+        header >> tag >> std::dec >> trace.m_frames >> std::hex >> trace.m_sequence_hash >> std::dec >> changes;
+        header.get();
+
+        if(!header || tag != "rom" || !std::getline(header, name))
+        {
+            throw std::runtime_error(path + ": malformed line: " + line);
+        }
+
+        trace.m_changes.resize(changes);
+        for(auto &change : trace.m_changes)
+        {
+            if(!(in >> std::dec >> change.first >> std::hex >> change.second))
+            {
+                throw std::runtime_error(path + ": truncated trace for " + name);
+            }
+        }
+
+        in >> std::ws;
+        traces[name] = std::move(trace);
+    }
+
+    return traces;
+}
+
+batch_runner::batch_runner(const batch_options &options) :
+    m_options(options)
+{
+    if(!make_engine(options.m_engine, options.m_cycles_per_tick))
+    {
+        throw std::invalid_argument("unknown engine");
+    }
+
+    std::sort(m_options.m_dump_at.begin(), m_options.m_dump_at.end());
+
+    if(!m_options.m_dump_dir.empty())
+    {
+        m_dumper = std::make_unique<frame_dumper>(m_options.m_dump_dir, m_options.m_dump_format, m_options.m_jobs);
+    }
+
+    if(!m_options.m_golden.empty())
+    {
+        m_golden = read_frame_traces(m_options.m_golden);
+        m_options.m_hash_frames = true;
+    }
+}
+
+std::size_t batch_runner::get_next_dump(const std::size_t &cycle) const
+{
+    std::size_t next = SIZE_MAX;
+
+    auto listed = std::lower_bound(m_options.m_dump_at.begin(), m_options.m_dump_at.end(), cycle);
+    if(listed != m_options.m_dump_at.end()) { next = *listed; }
+
+    if(m_options.m_dump_every > 0)
+    {
+        const std::size_t period = m_options.m_dump_every * std::max<std::uint32_t>(m_options.m_cycles_per_tick, 1);
+        next = std::min(next, std::max<std::size_t>((cycle + period - 1) / period, 1) * period);
+    }
+
+    return next;
+}
+
+//! @brief Turns a ROM path into something that can prefix a file name
+static std::string get_dump_prefix(const std::string &rom)
+{
+    std::string prefix = rom;
+    std::replace(prefix.begin(), prefix.end(), '/', '_');
+
+    prefix.erase(0, prefix.find_first_not_of("._"));
+    return prefix;
+}
+
+batch_result batch_runner::run(const std::string &name, const std::vector<std::uint8_t> &rom) const
+{
+    batch_result result;
+    result.m_rom = name;
+
+    auto image = cpu::make_power_on_state(rom, 0x200);
+    if(!image.has_value())
+    {
+        result.m_error = "ROM does not fit in memory";
+        return result;
+    }
+
+    cpu::seed_rng(*image, m_options.m_seed);
+
+    std::unique_ptr<engine> runner = make_engine(m_options.m_engine, m_options.m_cycles_per_tick);
+
+    // ~12KiB each, keep them off the stack
+    auto target = std::make_unique<cpu>();
+    auto state = std::make_unique<machine_state>();
+
+    target->reset(*image);
+
+    const std::size_t frame_cycles = std::max<std::uint32_t>(m_options.m_cycles_per_tick, 1);
+
+    const frame_trace* golden = nullptr;
+    if(!m_options.m_golden.empty())
+    {
+        auto found = m_golden.find(name);
+        golden = (found != m_golden.end()) ? &found->second : nullptr;
+        result.m_has_golden = (golden != nullptr);
+    }
+
+    // with a golden trace, mismatches decide what gets dumped rather than the dump points
+    const bool scheduled_dumps = m_dumper && m_options.m_golden.empty();
+    std::size_t mismatch_dumps = 0;
+    bool was_mismatched = false;
+
+    // the screen as last hashed, it only needs packing and hashing again if it changed
+    auto hashed_screen = std::make_unique<std::array<bool, 128*64>>();
+    screen_mode hashed_mode = screen_mode::lores_c8;
+    std::uint64_t frame_hash = 0;
+
+    // run from one stopping point to the next: dump points, and frame ends when hashing
+    engine_result ran { 0, engine_stop::none, trap::none };
+    std::size_t search_from = 0;
+
+    auto dump = [&]()
+    {
+        std::stringstream dump_name;
+        dump_name << get_dump_prefix(name) << '-' << std::setw(10) << std::setfill('0') << ran.m_cycles;
+
+        packed_framebuffer frame;
+        pack_framebuffer(target->get_screen_framebuffer(), frame);
+        m_dumper->submit(dump_name.str(), frame, target->get_screen_mode());
+
+        result.m_dumps++;
+    };
+
+    while(true)
+    {
+        const std::size_t next_dump = scheduled_dumps ? get_next_dump(search_from) : SIZE_MAX;
+        const std::size_t next_frame = m_options.m_hash_frames ? (ran.m_cycles / frame_cycles + 1) * frame_cycles
+                                                               : SIZE_MAX;
+        const std::size_t until = std::min({ next_dump, next_frame, m_options.m_max_cycles });
+
+        if(until > ran.m_cycles)
+        {
+            const engine_result span = runner->step(*target, until - ran.m_cycles);
+
+            ran.m_cycles += span.m_cycles;
+            ran.m_stop = span.m_stop;
+            ran.m_trap = span.m_trap;
+
+            if(ran.m_stop != engine_stop::none) { break; }
+        }
+
+        const bool at_frame = (ran.m_cycles == next_frame);
+        const bool at_dump = (ran.m_cycles == next_dump);
+
+        // out of budget before the next stopping point
+        if(!at_frame && !at_dump) { break; }
+
+        if(at_frame)
+        {
+            const std::array<bool, 128*64> &screen = target->get_screen_framebuffer();
+            const screen_mode mode = target->get_screen_mode();
+            frame_trace &trace = result.m_frames;
+
+            if(trace.m_frames == 0 || mode != hashed_mode
+               || std::memcmp(screen.data(), hashed_screen->data(), screen.size()) != 0)
+            {
+                packed_framebuffer frame;
+                pack_framebuffer(screen, frame);
+
+                *hashed_screen = screen;
+                hashed_mode = mode;
+                frame_hash = hash_framebuffer(frame, mode);
+            }
+
+            if(trace.m_changes.empty() || trace.m_changes.back().second != frame_hash)
+            {
+                trace.m_changes.emplace_back(trace.m_frames, frame_hash);
+            }
+
+            trace.m_sequence_hash = hash_combine(trace.m_sequence_hash, frame_hash);
+
+            if(!m_options.m_golden.empty())
+            {
+                const bool mismatched = !golden || trace.m_frames >= golden->m_frames
+                                        || golden->get_hash(trace.m_frames) != frame_hash;
+
+                if(mismatched)
+                {
+                    if(result.m_mismatched_frames++ == 0) { result.m_first_mismatch = trace.m_frames; }
+
+                    if(m_dumper && golden && !was_mismatched && mismatch_dumps < m_options.m_max_mismatch_dumps)
+                    {
+                        dump();
+                        mismatch_dumps++;
+                    }
+                }
+
+                was_mismatched = mismatched;
+            }
+
+            trace.m_frames++;
+        }
+
+        if(at_dump)
+        {
+            dump();
+            search_from = next_dump + 1;
+        }
+    }
+
+    // a golden run that went on longer differs in every frame this one didn't reach
+    if(golden && golden->m_frames > result.m_frames.m_frames)
+    {
+        if(result.m_mismatched_frames == 0) { result.m_first_mismatch = result.m_frames.m_frames; }
+        result.m_mismatched_frames += golden->m_frames - result.m_frames.m_frames;
+    }
+
+    target->save_state(*state);
+
+    result.m_cycles = ran.m_cycles;
+    result.m_stop = ran.m_stop;
+    result.m_trap = ran.m_trap;
+    result.m_pc = state->m_pc;
+    result.m_state_hash = hash_machine_state(*state);
+
+    return result;
+}
+
+std::size_t batch_runner::finish_dumps() const
+{
+    return m_dumper ? m_dumper->finish() : 0;
+}
+
+std::size_t batch_runner::get_dumps_written() const
+{
+    return m_dumper ? m_dumper->get_written() : 0;
+}
+
+std::vector<batch_result> batch_runner::run_corpus(const std::vector<std::string> &paths) const
+{
+    std::vector<batch_result> results(paths.size());
+    std::atomic<std::size_t> next(0);
+
+    auto worker = [&]()
+    {
+        for(std::size_t i = next.fetch_add(1); i < paths.size(); i = next.fetch_add(1))
+        {
+            try
+            {
+                results[i] = run(paths[i], nchip8::read_binary_file(paths[i]));
+            }
+            catch(const std::exception &e)
+            {
+                results[i].m_rom = paths[i];
+                results[i].m_error = e.what();
+            }
+        }
+    };
+
+    std::size_t jobs = m_options.m_jobs;
+    if(jobs == 0) { jobs = std::max(1u, std::thread::hardware_concurrency()); }
+    jobs = std::min(jobs, std::max<std::size_t>(paths.size(), 1));
+
+    std::vector<std::thread> workers;
+    for(std::size_t j = 0; j < jobs; j++)
+    {
+        workers.emplace_back(worker);
+    }
+
+    for(std::thread &t : workers)
+    {
+        t.join();
+    }
+
+    return results;
+}
+
+}
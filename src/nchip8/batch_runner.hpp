@@ -0,0 +1,173 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_BATCH_RUNNER_HPP
+#define NCHIP8_BATCH_RUNNER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cpu.hpp"
+#include "engine.hpp"
+#include "frame_dump.hpp"
+
+namespace nchip8
+{
+
+//! @brief Options for a batch run
+struct batch_options
+{
+    //! Engine to run with, see get_engine_names()
+    std::string m_engine = "burst";
+
+    //! Cycles to run each ROM for
+    std::size_t m_max_cycles = 1000000;
+
+    //! Instructions per 60Hz timer tick, 500Hz / 60
+    std::uint32_t m_cycles_per_tick = 8;
+
+    //! Seeds RND, runs with the same seed are reproducible
+    std::uint32_t m_seed = 1;
+
+    //! Worker threads for run_corpus and for encoding dumps, 0 = one per core
+    std::size_t m_jobs = 0;
+
+    //! Where screen dumps go, empty = no dumps
+    std::string m_dump_dir;
+
+    //! Cycles to dump the screen at
+    std::vector<std::size_t> m_dump_at;
+
+    //! Also dump every Nth 60Hz frame (N * m_cycles_per_tick cycles), 0 = off
+    std::size_t m_dump_every = 0;
+
+    image_format m_dump_format = image_format::pbm;
+
+    //! Hash the screen at every 60Hz frame, see batch_result::m_frames
+    bool m_hash_frames = false;
+
+    //! Frame hashes from an earlier run (see write_frame_traces) to compare against, empty = none.
+    //! Implies m_hash_frames, and with a dump directory, replaces the dump points:
+    //! only frames that start a run of mismatches are dumped
+    std::string m_golden;
+
+    //! At most this many mismatch dumps per ROM
+    std::size_t m_max_mismatch_dumps = 8;
+};
+
+//! @brief The screen over a whole run, as one hash_framebuffer per 60Hz frame
+struct frame_trace
+{
+    //! Every frame hash folded in order with hash_combine, equal runs give equal sequence hashes
+    std::uint64_t m_sequence_hash = 0;
+
+    //! Frames hashed, the first is at m_cycles_per_tick cycles
+    std::size_t m_frames = 0;
+
+    //! (frame, hash) wherever the hash differs from the frame before, starting with frame 0
+    std::vector<std::pair<std::size_t, std::uint64_t>> m_changes;
+
+    //! @brief Returns a frame's hash, 0 if the frame is past the end
+    std::uint64_t get_hash(const std::size_t &frame) const;
+};
+
+//! Frame traces keyed by ROM name
+using frame_traces = std::unordered_map<std::string, frame_trace>;
+
+//! @brief The outcome of running one ROM
+struct batch_result
+{
+    //! The ROM's name, e.g. its path
+    std::string m_rom;
+
+    //! Cycles run, including the one that stopped the engine
+    std::size_t m_cycles = 0;
+
+    //! Why the run ended early, engine_stop::none if it used its whole budget
+    engine_stop m_stop = engine_stop::none;
+
+    //! The fault, if the cpu trapped
+    trap m_trap = trap::none;
+
+    //! PC when the run ended, the faulting instruction if it trapped
+    std::uint16_t m_pc = 0;
+
+    //! hash_machine_state of the final state
+    std::uint64_t m_state_hash = 0;
+
+    //! Screens queued for dumping, named <rom>-<cycle>
+    std::size_t m_dumps = 0;
+
+    //! Only if frames were hashed
+    frame_trace m_frames;
+
+    //! Set if there was a golden trace for this ROM
+    bool m_has_golden = false;
+
+    //! Frames whose hash differs from the golden trace, and the first of them (SIZE_MAX if none).
+    //! A run of a different length differs at every frame past the shorter one
+    std::size_t m_mismatched_frames = 0;
+    std::size_t m_first_mismatch = SIZE_MAX;
+
+    //! Set if the ROM could not be run at all
+    std::string m_error;
+};
+
+//! @brief      Writes the frame traces of a batch as text, one block per ROM
+//! @throws     std::runtime_error if the file can't be written
+void write_frame_traces(const std::string &path, const std::vector<batch_result> &results);
+
+//! @brief      Reads frame traces written by write_frame_traces
+//! @throws     std::runtime_error if the file can't be read or is malformed
+frame_traces read_frame_traces(const std::string &path);
+
+//! @brief      Runs ROMs headless, with no input, for a fixed cycle budget
+//! @details    A ROM that traps is recorded and its worker moves straight on to the next ROM.
+//!             Screen dumps are handed to a frame_dumper, so emulation never waits on encoding or disk.
+//!             With frame hashing, a whole run can be checked against a golden trace by comparing
+//!             m_sequence_hash alone, images are only dumped where the frames differ.
+class batch_runner
+{
+public:
+    //! @throws std::invalid_argument if the engine name is unknown, or the dump format isn't available
+    //! @throws std::runtime_error if the golden trace can't be read
+    explicit batch_runner(const batch_options &options);
+
+    //! @brief      Runs one ROM
+    //! @param name Used to label the result
+    //! @param rom  The ROM, loaded at 0x200
+    batch_result run(const std::string &name, const std::vector<std::uint8_t> &rom) const;
+
+    //! @brief          Runs every ROM, spread over m_jobs threads
+    //! @param paths    ROM file paths
+    //! @returns        One result per path, in the same order
+    std::vector<batch_result> run_corpus(const std::vector<std::string> &paths) const;
+
+    //! @brief      Waits for every queued dump to be written and syncs them
+    //! @returns    The number of dumps that failed to write
+    std::size_t finish_dumps() const;
+
+    //! @brief Returns the number of dumps written so far
+    std::size_t get_dumps_written() const;
+
+private:
+    batch_options m_options;
+
+    //! Only if m_dump_dir is set
+    std::unique_ptr<frame_dumper> m_dumper;
+
+    //! Only if m_golden is set
+    frame_traces m_golden;
+
+    //! @brief Returns the first dump point at or after a cycle, SIZE_MAX if there are none
+    std::size_t get_next_dump(const std::size_t &cycle) const;
+};
+
+}
+
+#endif //NCHIP8_BATCH_RUNNER_HPP
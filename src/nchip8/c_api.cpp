@@ -0,0 +1,292 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "nchip8_c.h"
+#include "cpu.hpp"
+#include "framebuffer.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+
+// the C enums mirror the C++ ones so results convert with a cast
+static_assert(NCHIP8_STOP_ON_FRAME == nchip8::stop_on_frame, "stop flags out of sync");
+static_assert(NCHIP8_STOP_ON_KEY_WAIT == nchip8::stop_on_key_wait, "stop flags out of sync");
+static_assert(NCHIP8_STOP_ON_BREAKPOINT == nchip8::stop_on_breakpoint, "stop flags out of sync");
+static_assert(NCHIP8_STOP_ON_SOUND == nchip8::stop_on_sound, "stop flags out of sync");
+static_assert(NCHIP8_STOP_TRAPPED == static_cast<int>(nchip8::run_stop::trapped), "nchip8_stop out of sync");
+static_assert(NCHIP8_STOP_SOUND == static_cast<int>(nchip8::run_stop::sound), "nchip8_stop out of sync");
+static_assert(NCHIP8_TRAP_PC_OUT_OF_RANGE == static_cast<int>(nchip8::trap::pc_out_of_range), "nchip8_trap out of sync");
+static_assert(NCHIP8_FRAMEBUFFER_PACKED_SIZE == sizeof(nchip8::packed_framebuffer), "packed framebuffer size changed");
+
+struct nchip8_instance
+{
+    nchip8::cpu m_cpu;
+};
+
+namespace
+{
+
+//! @brief Prefixes a saved state so a foreign buffer or one from another build is rejected
+struct state_header
+{
+    std::uint32_t m_magic;
+    std::uint32_t m_size;
+};
+
+constexpr std::uint32_t state_magic = 0x53384E43; // "CN8S"
+
+//! @brief      Checks a serialised machine_state holds nothing a machine couldn't be in
+//! @details    Looks at the raw bytes, before any of them become a bool or an enum
+bool is_valid_state(const std::uint8_t* state)
+{
+    using nchip8::machine_state;
+
+    const std::uint8_t mode = state[offsetof(machine_state, m_screen_mode)];
+    const std::uint8_t trap = state[offsetof(machine_state, m_trap)];
+
+    if(mode > nchip8::screen_mode::hires_sc8 || trap > static_cast<std::uint8_t>(nchip8::trap::pc_out_of_range))
+    {
+        return false;
+    }
+
+    const std::uint8_t* screen = state + offsetof(machine_state, m_screen);
+    for(std::size_t i = 0; i < sizeof(machine_state::m_screen); i++)
+    {
+        if(screen[i] > 1) { return false; }
+    }
+
+    // the timers count forward from m_timer_cycle, and xorshift never leaves zero
+    std::uint64_t cycles, timer_cycle;
+    std::uint32_t rng;
+    std::memcpy(&cycles, state + offsetof(machine_state, m_cycles), sizeof(cycles));
+    std::memcpy(&timer_cycle, state + offsetof(machine_state, m_timer_cycle), sizeof(timer_cycle));
+    std::memcpy(&rng, state + offsetof(machine_state, m_rng), sizeof(rng));
+
+    return timer_cycle <= cycles && rng != 0;
+}
+
+//! @brief Runs f, turning any exception into a status
+template<typename F>
+nchip8_status guarded(F &&f) noexcept
+{
+    try
+    {
+        return f();
+    }
+    catch(...)
+    {
+        return NCHIP8_ERROR_INTERNAL;
+    }
+}
+
+nchip8_run_result run_instance(nchip8_instance &instance, const std::uint64_t &cycles, const std::uint32_t &stop_mask)
+{
+    const nchip8::run_result result = instance.m_cpu.run(cycles, static_cast<std::uint8_t>(stop_mask));
+
+    return nchip8_run_result {
+        result.m_cycles,
+        static_cast<std::uint32_t>(result.m_reason),
+        static_cast<std::uint32_t>(instance.m_cpu.get_trap())
+    };
+}
+
+}
+
+extern "C"
+{
+
+nchip8_instance* nchip8_create(void)
+{
+    try
+    {
+        return new nchip8_instance();
+    }
+    catch(...)
+    {
+        return nullptr;
+    }
+}
+
+void nchip8_destroy(nchip8_instance* instance)
+{
+    delete instance;
+}
+
+nchip8_status nchip8_load_rom(nchip8_instance* instance, const uint8_t* rom, size_t size)
+{
+    if(instance == nullptr || (rom == nullptr && size > 0)) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    return guarded([&]()
+    {
+        instance->m_cpu.reset();
+
+        if(!instance->m_cpu.load_rom(std::vector<std::uint8_t>(rom, rom + size), 0x200))
+        {
+            return NCHIP8_ERROR_ROM_TOO_LARGE;
+        }
+
+        return NCHIP8_OK;
+    });
+}
+
+nchip8_status nchip8_seed_rng(nchip8_instance* instance, uint32_t seed)
+{
+    if(instance == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    instance->m_cpu.seed_rng(seed);
+    return NCHIP8_OK;
+}
+
+nchip8_status nchip8_set_clock_rate(nchip8_instance* instance, uint32_t hz)
+{
+    if(instance == nullptr || hz == 0) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    instance->m_cpu.set_clock_rate(hz);
+    return NCHIP8_OK;
+}
+
+nchip8_status nchip8_set_cycles_per_tick(nchip8_instance* instance, uint32_t cycles_per_tick)
+{
+    if(instance == nullptr || cycles_per_tick == 0) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    instance->m_cpu.set_cycles_per_tick(cycles_per_tick);
+    return NCHIP8_OK;
+}
+
+nchip8_status nchip8_run_cycles(nchip8_instance* instance, uint64_t cycles, uint32_t stop_mask,
+                                nchip8_run_result* result)
+{
+    if(instance == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    return guarded([&]()
+    {
+        const nchip8_run_result ran = run_instance(*instance, cycles, stop_mask);
+        if(result != nullptr) { *result = ran; }
+
+        return NCHIP8_OK;
+    });
+}
+
+nchip8_status nchip8_run_cycles_bulk(nchip8_instance* const* instances, size_t count,
+                                     uint64_t cycles, uint32_t stop_mask,
+                                     nchip8_run_result* results)
+{
+    if(instances == nullptr && count > 0) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    for(std::size_t i = 0; i < count; i++)
+    {
+        if(instances[i] == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+    }
+
+    return guarded([&]()
+    {
+        for(std::size_t i = 0; i < count; i++)
+        {
+            const nchip8_run_result ran = run_instance(*instances[i], cycles, stop_mask);
+            if(results != nullptr) { results[i] = ran; }
+        }
+
+        return NCHIP8_OK;
+    });
+}
+
+nchip8_status nchip8_set_breakpoint(nchip8_instance* instance, uint16_t address, int enabled)
+{
+    if(instance == nullptr || address > 0xFFF) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    if(enabled) { instance->m_cpu.set_breakpoint(address); }
+    else        { instance->m_cpu.clear_breakpoint(address); }
+
+    return NCHIP8_OK;
+}
+
+nchip8_status nchip8_set_keys_mask(nchip8_instance* instance, uint16_t keys)
+{
+    if(instance == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    instance->m_cpu.set_keys_mask(keys);
+    return NCHIP8_OK;
+}
+
+nchip8_status nchip8_get_framebuffer_packed(const nchip8_instance* instance, uint8_t* buffer, size_t size)
+{
+    if(instance == nullptr || buffer == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+    if(size < NCHIP8_FRAMEBUFFER_PACKED_SIZE) { return NCHIP8_ERROR_BUFFER_TOO_SMALL; }
+
+    nchip8::packed_framebuffer packed;
+    nchip8::pack_framebuffer(instance->m_cpu.get_screen_framebuffer(), packed);
+    std::memcpy(buffer, packed.data(), packed.size());
+
+    return NCHIP8_OK;
+}
+
+nchip8_status nchip8_get_screen_size(const nchip8_instance* instance, uint32_t* width, uint32_t* height)
+{
+    if(instance == nullptr || width == nullptr || height == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+
+    const bool hires = instance->m_cpu.get_screen_mode() == nchip8::screen_mode::hires_sc8;
+    *width = hires ? 128 : 64;
+    *height = hires ? 64 : 32;
+
+    return NCHIP8_OK;
+}
+
+nchip8_trap nchip8_get_trap(const nchip8_instance* instance)
+{
+    if(instance == nullptr) { return NCHIP8_TRAP_NONE; }
+
+    return static_cast<nchip8_trap>(instance->m_cpu.get_trap());
+}
+
+size_t nchip8_state_size(void)
+{
+    return sizeof(state_header) + sizeof(nchip8::machine_state);
+}
+
+nchip8_status nchip8_save_state(const nchip8_instance* instance, uint8_t* buffer, size_t size)
+{
+    if(instance == nullptr || buffer == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+    if(size < nchip8_state_size()) { return NCHIP8_ERROR_BUFFER_TOO_SMALL; }
+
+    return guarded([&]()
+    {
+        // the caller's buffer has no alignment guarantee, go through an aligned copy
+        auto state = std::make_unique<nchip8::machine_state>();
+        instance->m_cpu.save_state(*state);
+
+        const state_header header { state_magic, sizeof(nchip8::machine_state) };
+        std::memcpy(buffer, &header, sizeof(header));
+        std::memcpy(buffer + sizeof(header), state.get(), sizeof(nchip8::machine_state));
+
+        return NCHIP8_OK;
+    });
+}
+
+nchip8_status nchip8_load_state(nchip8_instance* instance, const uint8_t* buffer, size_t size)
+{
+    if(instance == nullptr || buffer == nullptr) { return NCHIP8_ERROR_INVALID_ARGUMENT; }
+    if(size < nchip8_state_size()) { return NCHIP8_ERROR_BUFFER_TOO_SMALL; }
+
+    state_header header {};
+    std::memcpy(&header, buffer, sizeof(header));
+
+    if(header.m_magic != state_magic || header.m_size != sizeof(nchip8::machine_state)
+       || !is_valid_state(buffer + sizeof(header)))
+    {
+        return NCHIP8_ERROR_BAD_STATE;
+    }
+
+    return guarded([&]()
+    {
+        auto state = std::make_unique<nchip8::machine_state>();
+        std::memcpy(static_cast<void*>(state.get()), buffer + sizeof(header), sizeof(nchip8::machine_state));
+
+        instance->m_cpu.load_state(*state);
+        return NCHIP8_OK;
+    });
+}
+
+}
@@ -8,170 +8,145 @@
 #include <sstream>
 #include <tuple>
 #include <utility>
-#include <thread>
-#include <chrono>
 #include <algorithm>
-#include <ncurses.h>
 #include <iterator>
+#include <type_traits>
 
 namespace nchip8
 {
 
+// the register file must fit in the first cache line,
+// RAM, the screen and the stack follow on their own lines, then the cold input state and breakpoints
+static_assert(alignof(machine_state) == 64, "machine_state must be cache line aligned");
+static_assert(sizeof(machine_state) == 64 + 0x1000 + 128*64 + 64, "machine_state layout changed");
+static_assert(sizeof(cpu) == sizeof(machine_state) + 64 + 0x1000 / 8, "cpu layout changed");
+
+// reset and snapshots copy the state as one block
+static_assert(std::is_trivially_copyable<machine_state>::value, "machine_state must be trivially copyable");
+
 cpu::cpu()
 {
-    this->setup_op_handlers();
     this->reset();
 }
 
-const std::vector<std::array<std::uint8_t,5>> font = {
-    {0xF0, 0x90, 0x90, 0x90, 0xF0}, // 0
-    {0x20, 0x60, 0x20, 0x20, 0x70}, // 1
-    {0xF0, 0x10, 0xF0, 0x80, 0xF0}, // 2
-    {0xF0, 0x10, 0xF0, 0x10, 0xF0}, // 3
-    {0x90, 0x90, 0xF0, 0x10, 0x10}, // 4
-    {0xF0, 0x80, 0xF0, 0x10, 0xF0}, // 5
-    {0xF0, 0x80, 0xF0, 0x90, 0xF0}, // 6
-    {0xF0, 0x10, 0x20, 0x40, 0x40}, // 7
-    {0xF0, 0x90, 0xF0, 0x90, 0xF0}, // 8
-    {0xF0, 0x90, 0xF0, 0x10, 0xF0}, // 9
-    {0xF0, 0x90, 0xF0, 0x90, 0x90}, // A
-    {0xE0, 0x90, 0xE0, 0x90, 0xE0}, // B
-    {0xF0, 0x80, 0x80, 0x80, 0xF0}, // C
-    {0xE0, 0x90, 0x90, 0x90, 0xE0}, // D
-    {0xF0, 0x80, 0xF0, 0x80, 0xF0}, // E
-    {0xF0, 0x80, 0xF0, 0x80, 0x80}  // F
+// the font sprites, 5 bytes per character, loaded sequentially at 0x000
+static constexpr std::array<std::uint8_t, 16*5> font = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-void cpu::reset()
+const machine_state& cpu::get_power_on_state()
 {
-    // clear registers and memory
-    m_gpr.fill(0);
-    m_ram.fill(0x00);
+    static const machine_state image = []()
+    {
+        // value-initialized, so registers, the stack, RAM and the screen are all zero
+        machine_state state {};
 
-    m_pc = 0x200;
-    m_stack.fill(0x0000); // fill the stack with junk
+        state.m_pc = 0x200;
+        state.m_rng = 0x2545F491;
+        state.m_screen_mode = screen_mode::lores_c8;
+        state.m_trap = trap::none;
 
-    m_dt = 0;
-    m_st = 0;
+        std::copy(font.begin(), font.end(), state.m_ram.begin());
 
-    // copy each byte of the font sprite into memory,
-    // these are loaded sequentially
-    std::uint32_t i = 0;
-    for(std::array<uint8_t,5> character_data : font) {
-        std::copy_n(character_data.begin(), character_data.size(), m_ram.begin() + i);
-        i++;
-    }
+        return state;
+    }();
 
-    m_keys_down.fill(false);
+    return image;
 }
 
-bool cpu::load_rom(const std::vector<std::uint8_t> &rom, const uint16_t& load_addr)
+std::optional<machine_state> cpu::make_power_on_state(const std::vector<std::uint8_t> &rom,
+                                                      const std::uint16_t& load_addr)
 {
-    // Make sure the rom does not exceed typical loading size
-    // Make sure it'l fit into the remainder of memory from it's load point
-    if (rom.size() < 0xE00 && (load_addr + rom.size()) < 0x1000)
+    cpu scratch;
+
+    if(!scratch.load_rom(rom, load_addr))
     {
-        std::copy_n(rom.begin(), rom.size(), m_ram.begin() + load_addr);
-        return true;
+        return std::nullopt;
     }
 
-    return false;
+    return static_cast<const machine_state&>(scratch);
 }
 
-bool cpu::add_op_handler(const cpu::op_handler &handler)
-{
-    auto& root = m_op_tree;
-
-    // add a node to the tree if we don't have one
-    // see: https://en.cppreference.com/w/cpp/container/unordered_map/try_emplace
-    // try_emplace supports perfect forwarding and inserting the nested map ( {} )
-    // doesn't need args for it's constructor, we don't supply them
-    auto [node_0_iter, node_0_success] = root.try_emplace(handler.m_encoding[0]);
-    auto [node_1_iter, node_1_success] = node_0_iter->second.try_emplace(handler.m_encoding[1]);
-    auto [node_2_iter, node_2_success] = node_1_iter->second.try_emplace(handler.m_encoding[2]);
-
-    auto [iter, success] = node_2_iter->second.try_emplace(handler.m_encoding[3], handler);
-
-    return success;
-}
-
-void cpu::setup_op_handlers()
-{
-    add_op_handler(CLS);
-    add_op_handler(RET);
-    // add_op_handler(SYS);
-    add_op_handler(JP);
-    add_op_handler(CALL);
-    add_op_handler(SE_VX_KK);
-    add_op_handler(SNE_VX_KK);
-    add_op_handler(SE_VX_VY);
-    add_op_handler(LD_VX_KK);
-    add_op_handler(ADD_VX_KK);
-    add_op_handler(LD_VX_VY);
-    add_op_handler(OR_VX_VY);
-    add_op_handler(AND_VX_VY);
-    add_op_handler(XOR_VX_VY);
-    add_op_handler(ADD_VX_VY);
-    add_op_handler(SUB_VX_VY);
-    add_op_handler(SHR_VX_VY);
-    add_op_handler(SUBN_VX_VY);
-    add_op_handler(SHL_VX_VY);
-    add_op_handler(SNE_VX_VY);
-    add_op_handler(LD_I_NNN);
-    add_op_handler(JP_V0_NNN);
-    add_op_handler(RND_VX_KK);
-    add_op_handler(DRW_VX_VY_N);
-    add_op_handler(SKP_VX);
-    add_op_handler(SKNP_VX);
-    add_op_handler(LD_VX_DT);
-    add_op_handler(LD_VX_K);
-    add_op_handler(LD_DT_VX);
-    add_op_handler(LD_ST_VX);
-    add_op_handler(ADD_I_VX);
-    add_op_handler(LD_F_VX);
-    add_op_handler(LD_B_VX);
-    add_op_handler(LD_imm_I_VX);
-    add_op_handler(LD_VX_imm_I);
-}
-
-std::optional<cpu::op_handler> cpu::get_op_handler_for_instruction(const std::uint16_t& instruction) const
-{
-    // alias, not really relevant
-    const std::uint16_t &op = instruction;
-
-    // for an instruction 0xABCD
-    // we get each nibble, so nibble0 = 0xA, nibble1 = 0xB
-    std::uint8_t n3 = (op & 0x000F);
-    std::uint8_t n2 = (op & 0x00F0) >> 4;
-    std::uint8_t n1 = (op & 0x0F00) >> 8;
-    std::uint8_t n0 = (op & 0xF000) >> 12;
-
-    const auto &root = m_op_tree;
-
-    if (root.count(n0) > 0)
-    {
-        auto &node0 = m_op_tree.at(n0);
+void cpu::reset()
+{
+    this->reset(get_power_on_state());
+}
 
-        // if we cant find a node that contains the next nibble
-        // and cant find operand data (optional type), there is no handler, return nothing
-        if (!node0.count(n1) && !node0.count(std::nullopt)) return std::nullopt;
+void cpu::reset(const machine_state &image)
+{
+    // one copy of the whole architectural state
+    static_cast<machine_state&>(*this) = image;
 
-        // our next node is either indexed by an instruction nibble or an operand data (optional type)
-        auto &node1 = (node0.count(n1) ? node0.at(n1) : node0.at(std::nullopt));
+    m_keys_down.store(0, std::memory_order_relaxed);
+    m_last_key_down.store(no_key, std::memory_order_relaxed);
 
-        // repeat for next node
-        if (!node1.count(n2) && !node1.count(std::nullopt)) return std::nullopt;
-        auto &node2 = (node1.count(n2) ? node1.at(n2) : node1.at(std::nullopt));
+    // all of RAM may have changed
+    m_ram_written.store(~std::uint64_t(0), std::memory_order_release);
+}
 
-        // repeat for next node
-        if (!node2.count(n3) && !node2.count(std::nullopt)) return std::nullopt;
-        auto &node3 = (node2.count(n3) ? node2.at(n3) : node2.at(std::nullopt));
+void cpu::save_state(machine_state &state) const
+{
+    state = static_cast<const machine_state&>(*this);
 
-        return node3; // the op_handler at the lowest leaf of the tree
+    // snapshots hold the timers' current values
+    state.m_dt = get_dt();
+    state.m_st = get_st();
+    state.m_timer_cycle = m_cycles;
+}
+
+void cpu::load_state(const machine_state &state)
+{
+    static_cast<machine_state&>(*this) = state;
+    m_ram_written.store(~std::uint64_t(0), std::memory_order_release);
+}
+
+void cpu::seed_rng(const std::uint32_t &seed)
+{
+    seed_rng(*this, seed);
+}
+
+void cpu::seed_rng(machine_state &state, const std::uint32_t &seed)
+{
+    state.m_rng = (seed != 0 ? seed : 0x2545F491);
+}
+
+std::uint8_t cpu::next_random()
+{
+    // xorshift32
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 17;
+    m_rng ^= m_rng << 5;
+
+    return m_rng >> 24;
+}
+
+bool cpu::load_rom(const std::vector<std::uint8_t> &rom, const uint16_t& load_addr)
+{
+    // Make sure the rom does not exceed typical loading size
+    // Make sure it'l fit into the remainder of memory from it's load point
+    if (rom.size() < 0xE00 && (load_addr + rom.size()) < 0x1000)
+    {
+        std::copy_n(rom.begin(), rom.size(), m_ram.begin() + load_addr);
+        m_ram_written.store(~std::uint64_t(0), std::memory_order_release);
+        return true;
     }
 
-    // no handler found, invalid instruction :(
-    return std::nullopt;
+    return false;
 }
 
 cpu::operand_data cpu::get_operand_data_from_instruction(const std::uint16_t& instruction) const
@@ -186,48 +161,47 @@ cpu::operand_data cpu::get_operand_data_from_instruction(const std::uint16_t& in
     return operands;
 }
 
-void cpu::execute_op_at_pc()
+const char* to_string(const trap &t)
 {
-    static auto last_clock = std::chrono::high_resolution_clock::now();
-    static bool kill_next_execute = false;
+    switch(t)
+    {
+        case trap::none:                return "none";
+        case trap::illegal_opcode:      return "illegal_opcode";
+        case trap::stack_overflow:      return "stack_overflow";
+        case trap::stack_underflow:     return "stack_underflow";
+        case trap::pc_out_of_range:     return "pc_out_of_range";
+    }
 
-    // used to end execution if an error occurs
-    if(kill_next_execute) return;
+    return "unknown";
+}
 
-    // read the encoded instruction
-    std::uint16_t instruction = this->read_u16(this->m_pc);
+trap cpu::execute_op_at_pc()
+{
+    // a trapped cpu stays stopped until it's reset
+    if(m_trap != trap::none) { return m_trap; }
 
-    // get an operation handler for the instruction at PC
-    std::optional<op_handler> handler = get_op_handler_for_instruction(instruction);
+    // the timers tick from the cycle count, see get_dt
+    count_cycle();
 
-    // if its a valid operation
-    if (handler.has_value())
+    if(m_pc > 0xFFE)
     {
-        // update the delay timer and sleep timer while we're at it
-        // let's check how much time has passed since the last cpu execution
-        auto delta_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::high_resolution_clock::now() - last_clock
-        ).count();
-
-        // if more than a 60th of a second has passed
-        if(delta_duration_ms > (1000/60)) {
-
-            // discover the number of ticks that have passed, aka how many 60ths of a second have passed
-            unsigned long ticks = delta_duration_ms / (1000/60);
-
-            // update the clock
-            last_clock = std::chrono::high_resolution_clock::now();
+        nchip8::log << "pc out of range: " << nchip8::nnn << m_pc << std::endl;
+        m_trap = trap::pc_out_of_range;
+        return m_trap;
+    }
 
-            if(ticks >= m_dt) { m_dt = 0; } else { m_dt -= ticks; }
-            if(ticks >= m_st) { m_st = 0; } else { m_st -= ticks; }
+    // read the encoded instruction
+    std::uint16_t instruction = this->read_u16(this->m_pc);
 
-        }
+    // get an operation handler for the instruction at PC
+    const op_handler* handler = get_op_handler_for_instruction(instruction);
 
-        // if the sound timer is non-zero sound a buzz
-        if(m_st > 0) {
-            // TODO: sound buzz on non-zero sound timer
-        }
+    // blocked on input, the cycle passes and nothing happens until a key is down
+    if(handler == &LD_VX_K && !has_key_latched()) { return trap::none; }
 
+    // if its a valid operation
+    if (handler != nullptr)
+    {
         // save the program counter,
         // we will compare it after execution to see if a jump was performed
         std::uint16_t saved_pc = this->m_pc;
@@ -238,11 +212,18 @@ void cpu::execute_op_at_pc()
         // disassemble and print to log
         nchip8::log << nchip8::nnn << this->m_pc << ' ';
         nchip8::log << " " << nchip8::inst << instruction << " ";
-        handler.value().m_dasm_op(operands,nchip8::log);
+        handler->m_dasm_op(operands,nchip8::log);
         nchip8::log << std::endl;
 
         // execute the operation
-        handler.value().m_execute_op(*this,operands);
+        handler->m_execute_op(*this,operands);
+
+        // handlers that fault leave PC on themselves
+        if(m_trap != trap::none)
+        {
+            nchip8::log << "trap: " << to_string(m_trap) << std::endl;
+            return m_trap;
+        }
 
         // if pc wasnt modified by the operation
         if(saved_pc == this->m_pc)
@@ -251,22 +232,177 @@ void cpu::execute_op_at_pc()
             this->m_pc+=2;
         }
 
-        return;
+        return trap::none;
     }
     else {
         nchip8::log << "unhandled instruction: " << std::hex << instruction << std::endl;
-        kill_next_execute = true;
+        m_trap = trap::illegal_opcode;
+        return m_trap;
     }
 }
 
+const char* to_string(const run_stop &reason)
+{
+    switch(reason)
+    {
+        case run_stop::budget:          return "budget";
+        case run_stop::frame:           return "frame";
+        case run_stop::key_wait:        return "key_wait";
+        case run_stop::breakpoint:      return "breakpoint";
+        case run_stop::halted:          return "halted";
+        case run_stop::trapped:         return "trapped";
+        case run_stop::sound:           return "sound";
+    }
+
+    return "unknown";
+}
+
+run_result cpu::run(const std::size_t &max_cycles, const std::uint8_t &stop_mask)
+{
+    if(m_trap != trap::none) { return { run_stop::trapped, 0 }; }
+
+    for(std::size_t cycle = 0; cycle < max_cycles; cycle++)
+    {
+        // stops that happen before the instruction don't consume its cycle
+        if((stop_mask & stop_on_breakpoint) && cycle > 0 && m_breakpoints[m_pc & 0xFFF])
+        {
+            return { run_stop::breakpoint, cycle };
+        }
+
+        const std::uint16_t instruction = read_u16(m_pc);
+        const op_handler* handler = get_op_handler_for_instruction(instruction);
+
+        const bool waiting_on_key = (handler == &LD_VX_K && !has_key_latched());
+
+        if(waiting_on_key && (stop_mask & stop_on_key_wait)) { return { run_stop::key_wait, cycle }; }
+
+        count_cycle();
+
+        if(m_pc > 0xFFE)            { m_trap = trap::pc_out_of_range; return { run_stop::trapped, cycle + 1 }; }
+        if(handler == nullptr)      { m_trap = trap::illegal_opcode;  return { run_stop::trapped, cycle + 1 }; }
+
+        // the cycle passes without executing, the timers keep running
+        if(waiting_on_key) { continue; }
+
+        const std::uint16_t saved_pc = m_pc;
+        handler->m_execute_op(*this, get_operand_data_from_instruction(instruction));
+
+        if(m_trap != trap::none) { return { run_stop::trapped, cycle + 1 }; }
+
+        if(m_pc == saved_pc)
+        {
+            if(handler == &JP) { return { run_stop::halted, cycle + 1 }; }
+
+            m_pc += 2;
+        }
+
+        if(handler->m_stop & stop_mask)
+        {
+            return { (handler->m_stop & stop_on_sound) ? run_stop::sound : run_stop::frame, cycle + 1 };
+        }
+    }
+
+    return { run_stop::budget, max_cycles };
+}
+
+bool cpu::is_waiting_for_key() const
+{
+    return !has_key_latched() && get_op_handler_for_instruction(read_u16(m_pc)) == &LD_VX_K;
+}
+
+void cpu::idle(const std::size_t &cycles)
+{
+    // the timers catch up whenever they're next read
+    m_cycles += cycles;
+}
+
+std::uint64_t cpu::get_timer_ticks() const
+{
+    // the ticks up to a cycle are cycle * 60 / clock, the same as counting them one cycle at a time
+    return (m_cycles * 60) / m_clock_rate - (m_timer_cycle * 60) / m_clock_rate;
+}
+
+std::uint8_t cpu::get_dt() const
+{
+    const std::uint64_t ticks = get_timer_ticks();
+    return (ticks >= m_dt) ? 0 : m_dt - ticks;
+}
+
+std::uint8_t cpu::get_st() const
+{
+    const std::uint64_t ticks = get_timer_ticks();
+    return (ticks >= m_st) ? 0 : m_st - ticks;
+}
+
+std::uint64_t cpu::get_st_expiry_cycle() const
+{
+    if(m_st == 0) { return m_timer_cycle; }
+
+    // the first cycle the tick that empties it lands on
+    const std::uint64_t last_tick = (m_timer_cycle * 60) / m_clock_rate + m_st;
+    return (last_tick * m_clock_rate + 59) / 60;
+}
+
+void cpu::sync_timers()
+{
+    m_dt = get_dt();
+    m_st = get_st();
+    m_timer_cycle = m_cycles;
+}
+
+void cpu::set_clock_rate(const std::uint32_t &hz)
+{
+    const std::uint32_t clamped = std::max<std::uint32_t>(hz, 1);
+    if(clamped == m_clock_rate) { return; }
+
+    // ticks so far were at the old rate
+    sync_timers();
+    m_clock_rate = clamped;
+}
+
+std::uint32_t cpu::get_clock_rate() const
+{
+    return m_clock_rate;
+}
+
+void cpu::set_cycles_per_tick(const std::uint32_t &cycles_per_tick)
+{
+    set_clock_rate(std::max<std::uint32_t>(cycles_per_tick, 1) * 60);
+}
+
+void cpu::set_breakpoint(const std::uint16_t &address)
+{
+    m_breakpoints.set(address & 0xFFF);
+}
+
+void cpu::clear_breakpoint(const std::uint16_t &address)
+{
+    m_breakpoints.reset(address & 0xFFF);
+}
+
+void cpu::clear_breakpoints()
+{
+    m_breakpoints.reset();
+}
+
+const trap& cpu::get_trap() const
+{
+    return m_trap;
+}
+
+void cpu::clear_trap()
+{
+    m_trap = trap::none;
+}
+
 std::optional<std::string> cpu::dasm_op(const std::uint16_t& address) const
 {
 //    std::uint16_t instruction = this->read_u16(address);
 //
 //    // get an operation handler for the instruction at PC
-//    std::optional<op_handler> handler = get_op_handler_for_instruction(instruction);
+//    const op_handler* handler = get_op_handler_for_instruction(instruction);
 //
-//    if (handler != std::nullopt)
+//    if (handler != nullptr)
 //    {
 //        // now extract the vars from the instruction in order to supply to the handlers
 //        operand_data operands = get_operand_data_from_instruction(instruction);
@@ -274,7 +410,7 @@ std::optional<std::string> cpu::dasm_op(const std::uint16_t& address) const
 //        static std::stringstream dasm;
 //        dasm.clear();
 //
-//        handler.value().m_dasm_op(operands, dasm);
+//        handler->m_dasm_op(operands, dasm);
 //        dasm << '\'
 //
 //        return dasm.str();
@@ -284,13 +420,15 @@ std::optional<std::string> cpu::dasm_op(const std::uint16_t& address) const
 
 std::uint16_t cpu::read_u16(const std::uint16_t &addr) const
 {
-    return (m_ram[addr] << 8 | m_ram[addr + 1]);
+    // addresses wrap at the end of the 4KiB address space
+    return (m_ram[addr & 0xFFF] << 8 | m_ram[(addr + 1) & 0xFFF]);
 }
 
 void cpu::set_u16(const std::uint16_t &addr, const std::uint16_t &val)
 {
-    m_ram[addr] = val >> 8;
-    m_ram[addr + 1] = val & 0x00FF;
+    m_ram[addr & 0xFFF] = val >> 8;
+    m_ram[(addr + 1) & 0xFFF] = val & 0x00FF;
+    mark_ram_written(addr, 2);
 }
 
 const cpu::screen_mode &cpu::get_screen_mode() const
@@ -324,19 +462,79 @@ void cpu::set_screen_xy(const std::uint8_t &x, const std::uint8_t &y, const bool
     m_screen[width*y+x] = set;
 }
 
+std::uint64_t cpu::get_cycles() const
+{
+    return m_cycles;
+}
+
+std::uint16_t cpu::get_pc() const
+{
+    return m_pc;
+}
+
 void cpu::set_key_down(const std::uint8_t &key)
 {
-    m_keys_down.at(key) = true;
-    m_last_key_down = key;
+    m_keys_down.fetch_or(1 << (key & 0xF), std::memory_order_relaxed);
+
+    // release, whoever sees the latch also sees the key down
+    m_last_key_down.store(key & 0xF, std::memory_order_release);
 }
 
 void cpu::set_key_up(const std::uint8_t &key)
 {
-    m_keys_down.at(key) = false;
+    m_keys_down.fetch_and(~(1 << (key & 0xF)), std::memory_order_relaxed);
+
+    // only unlatch if it's still this key
+    std::uint8_t latched = key & 0xF;
+    m_last_key_down.compare_exchange_strong(latched, no_key, std::memory_order_release, std::memory_order_relaxed);
+}
+
+void cpu::set_keys_mask(const std::uint16_t &keys)
+{
+    const std::uint16_t previous = m_keys_down.exchange(keys, std::memory_order_relaxed);
+    const std::uint16_t pressed = keys & ~previous;
+
+    if(pressed != 0)
+    {
+        // highest bit set
+        std::uint8_t key = 15;
+        while(!(pressed & (1 << key))) { key--; }
 
-    if(key == m_last_key_down) {
-        m_last_key_down = std::nullopt;
+        m_last_key_down.store(key, std::memory_order_release);
+        return;
     }
+
+    const std::uint8_t latched = m_last_key_down.load(std::memory_order_relaxed);
+    if(latched != no_key && !(keys & (1 << latched)))
+    {
+        m_last_key_down.store(no_key, std::memory_order_release);
+    }
+}
+
+std::uint16_t cpu::get_keys_mask() const
+{
+    return m_keys_down.load(std::memory_order_relaxed);
+}
+
+std::uint8_t cpu::get_latched_key() const
+{
+    return m_last_key_down.load(std::memory_order_acquire);
+}
+
+void cpu::restore_keys(const std::uint16_t &keys, const std::uint8_t &latched)
+{
+    m_keys_down.store(keys, std::memory_order_relaxed);
+    m_last_key_down.store(latched, std::memory_order_release);
+}
+
+std::uint64_t cpu::take_ram_written()
+{
+    return m_ram_written.exchange(0, std::memory_order_acquire);
+}
+
+bool cpu::has_key_latched() const
+{
+    return m_last_key_down.load(std::memory_order_acquire) != no_key;
 }
 
 }
\ No newline at end of file
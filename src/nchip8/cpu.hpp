@@ -6,47 +6,220 @@
 #define CHIP8_NCURSES_CPU_HPP
 
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
 #include <memory>
-#include <functional>
 #include <string>
-#include <unordered_map>
 #include <optional>
 #include <vector>
 
 namespace nchip8
 {
 
+//! @brief The current resolution mode of the screen
+enum screen_mode : std::uint8_t {
+    lores_c8,   //! CHIP-8 64*32
+    hires_sc8   //! SCHIP-8 128*64
+};
+
+//! @brief Why a cpu stopped executing, see cpu::get_trap
+enum class trap : std::uint8_t
+{
+    none,               //! Running normally
+    illegal_opcode,     //! No op handler for the instruction at PC
+    stack_overflow,     //! CALL with all 15 return slots in use
+    stack_underflow,    //! RET with nothing on the stack
+    pc_out_of_range     //! PC moved past the last instruction in RAM (0xFFE)
+};
+
+//! @brief Returns a printable name for a trap
+const char* to_string(const trap &t);
+
+//! @brief Optional conditions cpu::run stops on, combined into a mask
+//! @details The cycle budget, traps and halts always stop a run
+enum run_stop_condition : std::uint8_t
+{
+    stop_on_frame       = 1 << 0,   //! After a DRW or CLS, the screen changed
+    stop_on_key_wait    = 1 << 1,   //! Before an LD Vx, K that has no key to take
+    stop_on_breakpoint  = 1 << 2,   //! Before the instruction at a breakpoint, see cpu::set_breakpoint
+    stop_on_sound       = 1 << 3    //! After an LD ST, Vx, the buzzer may have started or stopped
+};
+
+//! @brief Why cpu::run returned
+enum class run_stop : std::uint8_t
+{
+    budget,         //! Ran every cycle it was given
+    frame,          //! @see stop_on_frame
+    key_wait,       //! @see stop_on_key_wait, PC is left on the LD Vx, K
+    breakpoint,     //! @see stop_on_breakpoint, PC is left on the breakpoint
+    halted,         //! Jumped to itself, the usual CHIP-8 way of stopping
+    trapped,        //! @see cpu::get_trap
+    sound           //! @see stop_on_sound
+};
+
+//! @brief Returns a printable name for a run_stop
+const char* to_string(const run_stop &reason);
+
+//! @brief What a call to cpu::run did
+struct run_result
+{
+    run_stop m_reason;
+
+    //! Cycles consumed, including the one that stopped the run (if it executed)
+    std::size_t m_cycles;
+};
+
+//! @brief      The architectural state of a CHIP-8 machine
+//! @details    Laid out by access frequency: the register file that nearly every instruction touches
+//!             shares one cache line, RAM and the framebuffer each start on their own line.
+//!             Everything that is not touched per-instruction lives in cpu, after this block.
+struct machine_state
+{
+    //! General Purpose Registers
+    alignas(64) std::array<std::uint8_t, 16> m_gpr;
+
+    //! I register, for storing addresses for some special instructions
+    std::uint16_t m_i;
+
+    //! Program Counter, the address of the current executing instruction
+    std::uint16_t m_pc;
+
+    //! Stack Pointer, the size of the stack, always masked to the 16 entries
+    std::uint8_t m_sp;
+
+    //! Delay Timer as of m_timer_cycle, when this is non-zero, we must subtract 1 from it @ 60Hz
+    std::uint8_t m_dt;
+
+    //! Sound Timer as of m_timer_cycle, when this is non-zero, we must subtract 1 from it @ 60Hz while playing a buzzer
+    std::uint8_t m_st;
+
+    //! State of the xorshift generator used by RND, part of the machine so runs are reproducible
+    std::uint32_t m_rng;
+
+    //! Instructions executed since power-on, the timers tick from this
+    std::uint64_t m_cycles;
+
+    //! The cycle m_dt and m_st hold their values at, they are brought up to date lazily (see cpu::get_dt)
+    std::uint64_t m_timer_cycle;
+
+    //! RAM, every access is masked with 0xFFF so hostile ROMs wrap around instead of escaping it
+    alignas(64) std::array<std::uint8_t, 0x1000> m_ram;
+
+    //! Screen
+    alignas(64) std::array<bool, 128*64> m_screen;
+
+    //! The Stack, only touched by CALL/RET so it stays off the register line
+    alignas(64) std::array<std::uint16_t, 16> m_stack;
+    screen_mode m_screen_mode;
+
+    //! Set when the cpu faults, PC is left on the faulting instruction
+    trap m_trap;
+};
+
 //! The CHIP-8 interpreter core
-class cpu
+//! @details Not polymorphic on purpose, a vptr would push the register file off the first cache line
+class cpu : private machine_state
 {
 public:
     cpu();
 
-    virtual ~cpu() noexcept = default;
+    ~cpu() noexcept = default;
 
     //! @brief  Clears RAM, registers, the stack, screen etc...
+    //! @details Restores the power-on state in a single copy, see get_power_on_state
     void reset();
 
+    //! @brief          Restores a precomputed power-on image instead of the default one
+    //! @param image    e.g. from make_power_on_state, so a ROM does not need reloading on every reset
+    void reset(const machine_state &image);
+
+    //! @brief  Returns the state every cpu starts from:
+    //!         cleared registers, RAM and screen, the font at 0x000 and PC = 0x200
+    static const machine_state& get_power_on_state();
+
+    //! @brief              Builds a power-on image with a ROM already loaded
+    //! @param  rom         A vector of 8-bit ints of the raw rom data
+    //! @param  address     The memory location to load the rom into
+    //! @returns            The image, or std::nullopt if the rom does not fit
+    static std::optional<machine_state> make_power_on_state(const std::vector<std::uint8_t> &rom,
+                                                            const std::uint16_t& address);
+
+    //! @brief          Copies the architectural state out of the cpu, e.g. for a snapshot
+    //! @param state    Where to copy the state to
+    void save_state(machine_state &state) const;
+
+    //! @brief          Restores a state previously saved with save_state
+    //! @details        Unlike reset, key state is left untouched
+    void load_state(const machine_state &state);
+
+    //! @brief      Seeds the generator used by RND
+    //! @param seed Any value, zero is remapped as xorshift would get stuck on it
+    void seed_rng(const std::uint32_t &seed);
+
+    //! @brief          Seeds RND in a saved state or power-on image, the same way seed_rng does
+    //! @param state    The state to seed
+    //! @param seed     Any value, zero is remapped
+    static void seed_rng(machine_state &state, const std::uint32_t &seed);
+
     //! @brief              Loads a ROM into the CPU
     //! @param  rom         A vector of 8-bit ints of the raw rom data
     //! @param  address     The memory location to load the rom into
     //! @returns            true if loading was successful, false otherwise
     bool load_rom(const std::vector<std::uint8_t> &rom, const std::uint16_t& address);
 
-    //! @brief Executes the current instruction at PC, (PC may jump or increment afterwards)
-    void execute_op_at_pc();
+    //! @brief      Executes the current instruction at PC, (PC may jump or increment afterwards)
+    //! @returns    The trap raised, or trap::none. Once trapped, nothing executes until reset or clear_trap
+    trap execute_op_at_pc();
+
+    //! @brief              Executes instructions in a tight loop until the budget runs out or a stop condition is met
+    //! @param max_cycles   Cycle budget, a cycle spent waiting on LD Vx, K counts
+    //! @param stop_mask    run_stop_condition flags, budget, traps and halts always stop
+    //! @returns            Why the run stopped and the cycles it consumed
+    //! @details            Timers tick on cycle counts (see set_clock_rate), so a run is deterministic.
+    //!                     A breakpoint on the first instruction of a run is stepped over, so runs can resume from it.
+    run_result run(const std::size_t &max_cycles, const std::uint8_t &stop_mask = 0);
+
+    //! @brief      Returns true if PC is on an LD Vx, K and no key is down
+    //! @details    The cpu is blocked on input: dispatchers leave PC where it is
+    //!             and the scheduler can stop stepping until set_key_down
+    bool is_waiting_for_key() const;
+
+    //! @brief          Spends cycles without executing anything, e.g. while waiting on a key
+    //! @details        The cycle counter and timers advance exactly as if run() had spent them waiting
+    void idle(const std::size_t &cycles);
+
+    //! @brief Returns the trap that stopped the cpu, trap::none if it is running normally
+    const trap& get_trap() const;
+
+    //! @brief Clears a trap so execution can continue, e.g. after a debugger has patched things up
+    void clear_trap();
 
     //! @brief          Returns a disassembly of the instruction at the supplied address
     //! @param address  The address of the instruction, must be correctly aligned
     //! @returns        Optional of string of disassembled instruction
     std::optional<std::string> dasm_op(const std::uint16_t &address) const;
 
-    //! @brief The current resolution mode of the screen
-    enum screen_mode {
-        lores_c8,   //! CHIP-8 64*32
-        hires_sc8   //! SCHIP-8 128*64
+    //! @brief What can be told about an instruction without running it, see get_op_info
+    struct op_info
+    {
+        std::size_t m_index = 0;            //! The instruction's slot in the decode table, 0 if nothing decodes it
+        const char* m_mnemonic = "???";     //! e.g. "LD Vx, byte"
+        bool m_conditional_skip = false;    //! SE, SNE, SKP and SKNP
+        bool m_jump = false;                //! JP addr and JP V0, addr
     };
 
+    //! @brief              Decodes an instruction with the same table run() uses
+    //! @param instruction  The encoded instruction (i.e 0x1200 - JP 200)
+    //! @details            For tools that sort instructions out, e.g. a trace, so they can't disagree with the core
+    static op_info get_op_info(const std::uint16_t &instruction);
+
+    //! @brief Returns the number of decode table slots, every op_info::m_index is below it
+    static std::size_t get_op_count();
+
+    //! @see nchip8::screen_mode
+    using screen_mode = nchip8::screen_mode;
+
     //! @brief Returns current screen mode
     //! @see cpu::screen_mode
     const screen_mode& get_screen_mode() const;
@@ -60,24 +233,93 @@ public:
     //! @brief Get's the status of a pixel on the screen (on/off)
     bool get_screen_xy(const std::uint8_t&x , const std::uint8_t& y) const;
 
-    //! @brief Set the supplied key as down
+    //! @brief Returns the number of instruction cycles counted since power-on
+    std::uint64_t get_cycles() const;
+
+    //! @brief Returns the address of the next instruction to execute
+    std::uint16_t get_pc() const;
+
+    //! @brief Returns the delay timer as of the current cycle
+    std::uint8_t get_dt() const;
+
+    //! @brief Returns the sound timer as of the current cycle
+    std::uint8_t get_st() const;
+
+    //! @brief      Returns the cycle the sound timer reaches zero on, i.e. when the buzzer stops
+    //! @details    At or before get_cycles() when the buzzer is off. Changes only when LD ST, Vx runs
+    std::uint64_t get_st_expiry_cycle() const;
+
+    //! @brief      Sets the instruction clock the 60Hz timers are counted against
+    //! @details    Tick n lands on the first cycle c with c * 60 / hz >= n, so the timers keep exactly 60Hz
+    //!             of cycles on average even when hz isn't a multiple of 60.
+    //!             Not part of machine_state, so reset and load_state keep it
+    void set_clock_rate(const std::uint32_t &hz);
+
+    //! @see set_clock_rate
+    std::uint32_t get_clock_rate() const;
+
+    //! @brief Sets the clock to a whole number of cycles per 60Hz timer tick, i.e. set_clock_rate(cycles_per_tick * 60)
+    void set_cycles_per_tick(const std::uint32_t &cycles_per_tick);
+
+    //! @brief Stops run() before the instruction at the supplied address, when it's asked to
+    void set_breakpoint(const std::uint16_t &address);
+
+    //! @brief Removes a breakpoint
+    void clear_breakpoint(const std::uint16_t &address);
+
+    //! @brief Removes every breakpoint
+    void clear_breakpoints();
+
+    //! @brief Set the supplied key as down, safe to call from any thread
     void set_key_down(const std::uint8_t& key);
 
-    //! @brief Set key up
+    //! @brief Set key up, safe to call from any thread
     void set_key_up(const std::uint8_t& key);
 
+    //! @brief      Sets all 16 keys at once, bit n = key n down
+    //! @details    One store, for drivers that supply the whole keypad every step.
+    //!             The latch takes the highest newly pressed key, as if they went down one at a time
+    void set_keys_mask(const std::uint16_t &keys);
+
+    //! @brief Returns the keys currently down, bit n = key n
+    std::uint16_t get_keys_mask() const;
+
+    //! @brief The latch (see set_keys_mask) when no key is latched
+    static constexpr std::uint8_t no_key = 0xFF;
+
+    //! @brief Returns the key LD Vx, K would take, no_key if none
+    std::uint8_t get_latched_key() const;
+
+    //! @brief      Puts the keypad back exactly as get_keys_mask and get_latched_key saw it
+    //! @details    Unlike set_keys_mask nothing is pressed, the latch is what it was rather than re-derived.
+    //!             For putting back a snapshot, machine_state doesn't hold the keys
+    void restore_keys(const std::uint16_t &keys, const std::uint8_t &latched);
+
+    //! @brief      Returns which 64 byte blocks of RAM have been written since the last call, and clears them
+    //! @details    Bit n = 0x40 * n to 0x40 * n + 0x3F. Safe to call from any thread, for viewers that only
+    //!             redraw what changed. A write can show up a call late, so check the blocks from the call before too
+    std::uint64_t take_ram_written();
+
     friend class cpu_daemon; //! We allow the daemon watcher to access data in the CPU
+    friend class coverage_engine; //! The fuzzer drives the cpu with its own instrumented dispatch loop
+    friend class reference_engine; //! Headless engines run their own dispatch loops, see engine.hpp
+    friend class cpu_history; //! Rewinds by reloading snapshots and replaying input, see cpu_history.hpp
 
 private:
-    //! @brief The last key that was down
-    std::optional<std::uint8_t> m_last_key_down;
+    //! @brief The last key that went down and is still down, no_key otherwise. Written by the input thread
+    std::atomic<std::uint8_t> m_last_key_down;
 
-    //! @brief array indexed by key code (0x0-0xF),
-    std::array<bool,16> m_keys_down;
+    //! @brief Bit n set = key n (0x0-0xF) down. Written by the input thread
+    std::atomic<std::uint16_t> m_keys_down;
 
-    //! Screen
-    std::array<bool, 128*64> m_screen;
-    screen_mode m_screen_mode;
+    //! @brief RAM blocks written since take_ram_written, see mark_ram_written
+    std::atomic<std::uint64_t> m_ram_written { ~std::uint64_t(0) };
+
+    //! @brief Instruction clock in Hz, the timers tick every m_clock_rate / 60 cycles
+    std::uint32_t m_clock_rate = 500;
+
+    //! @brief Breakpoints for run(), one bit per address
+    std::bitset<0x1000> m_breakpoints;
 
     //! @brief Set screen mode of CPU
     void set_screen_mode(const screen_mode& mode);
@@ -85,30 +327,25 @@ private:
     //! @brief Set's the status of a pixel on the screen
     void set_screen_xy(const std::uint8_t& x, const std::uint8_t& y, const bool& set);
 
-    //! RAM
-    std::array<std::uint8_t, 0x1000> m_ram;
+    //! @brief      Notes that bytes of RAM (no more than 64) have just been written, for take_ram_written
+    //! @details    Only a load when the blocks are already marked, which is nearly always
+    void mark_ram_written(const std::uint16_t &address, const std::uint16_t &bytes);
 
-    //! General Purpose Registers
-    std::array<std::uint8_t, 16> m_gpr;
+    //! @brief      Counts one instruction cycle
+    //! @details    The timers are not touched, they tick from the cycle count and are only worked out when read
+    void count_cycle();
 
+    //! @brief Returns the number of 60Hz ticks since m_timer_cycle
+    std::uint64_t get_timer_ticks() const;
 
-    //! I register, for storing addresses for some special instructions
-    std::uint16_t m_i;
-
-    //! Program Counter, the address of the current executing instruction
-    std::uint16_t m_pc;
-
-    //! Stack Pointer, the size of the stack
-    std::uint8_t m_sp;
-
-    //! Delay Timer, when this is non-zero, we must subtract 1 from it @ 60Hz
-    std::uint8_t m_dt;
+    //! @brief Brings m_dt and m_st up to the current cycle, before they're written
+    void sync_timers();
 
-    //! Sound Timer, when this is non-zero, we must subtract 1 from it @ 60Hz while playing a buzzer
-    std::uint8_t m_st;
+    //! @brief  Returns the next value from the RND generator
+    std::uint8_t next_random();
 
-    //! The Stack
-    std::array<std::uint16_t, 16> m_stack;
+    //! @brief  Returns true if a key is latched for LD Vx, K
+    bool has_key_latched() const;
 
     //! @brief          Reads a 16-bit value at the specified address
     //! @param address  The address
@@ -148,11 +385,12 @@ private:
 
     //! @brief  A function type that when executed,
     //!         should process the instruction operation and update the relevant parts of the CPU
-    using func_execute_op = std::function<void(cpu &, const operand_data &)>;
+    //!         (a plain function pointer, so handlers can be constant-initialized)
+    using func_execute_op = void (*)(cpu &, const operand_data &);
 
     //! @brief  A function that when called,
     //!         returns the disassembly string of the instruction
-    using func_dasm_op = std::function<void(const operand_data &, std::stringstream &)>;
+    using func_dasm_op = void (*)(const operand_data &, std::stringstream &);
 
     //! @brief Container type to hold both functions that could process an instruction
     //!        both an execution and a disassembly routine
@@ -167,77 +405,85 @@ private:
 
         //! @see func_dasm_op
         func_dasm_op m_dasm_op;
+
+        //! run_stop_condition flags that end a run after this instruction, e.g. stop_on_frame for DRW
+        std::uint8_t m_stop = 0;
     };
 
     friend class op_handler; //! We allow operations to access data in CPU (i.e its private members)
 
-    //! @brief      The operation handler tree
-    //!             4 nested maps, indexed by each nibble of the instruction
-    //!             e.g. 0xABCD, m_op_tree[A][B][C][D]
-    //!
-    //! @details    4bit nibbles in this case are using an 8bit type
-    //!             Operand data is indexed as optional (std::nullopt)
-    std::unordered_map<std::optional<std::uint8_t>,
-            std::unordered_map<std::optional<std::uint8_t>,
-                    std::unordered_map<std::optional<std::uint8_t>,
-                            std::unordered_map<std::optional<std::uint8_t>,
-                                    op_handler>>>> m_op_tree;
-
     //! @brief          Returns the operation handler for an instruction
     //! @param address  The encoded instruction (i.e 0X1200 - JP 200)
-    //! @returns        Optional of operation handler if successful, std::nullopt if false
-    std::optional<op_handler> get_op_handler_for_instruction(const std::uint16_t &instruction) const;
+    //! @returns        Pointer to the operation handler if successful, nullptr if not
+    //! @details        Decoding uses a table that is built at compile time and shared
+    //!                 by every cpu instance, see op_handlers.cpp
+    static const op_handler* get_op_handler_for_instruction(const std::uint16_t &instruction);
 
-    //! @brief          Add an operation handler for an instruction into the handler tree
-    //! @param handler  Handler structure, containing an execute and disassembly function
-    bool add_op_handler(const op_handler &handler);
+    //! @see op_handlers.cpp
+    struct decode_table;
+
+    //! The decode table used by get_op_handler_for_instruction
+    static const decode_table op_decode_table;
 
     /* Begin operation handlers
        Why are these not stored inside an array? We want to alias them.
        Rationale: Easier to write unit tests
                   if we can simply call instructions by name
                   as the instruction name will match the test name */
-    static op_handler CLS;          // 00E0 - CLS
-    static op_handler RET;          // 00EE - RET
-    static op_handler SYS;          // 0nnn - SYS addr
-    static op_handler JP;           // 1nnn - JP addr
-    static op_handler CALL;         // 2nnn - CALL addr
-    static op_handler SE_VX_KK;     // 3xkk - SE Vx, byte
-    static op_handler SNE_VX_KK;    // 4xkk - SNE Vx, byte
-    static op_handler SE_VX_VY;     // 5xy0 - SE Vx, Vy
-    static op_handler LD_VX_KK;     // 6xkk - LD Vx, byte
-    static op_handler ADD_VX_KK;    // 7xkk - ADD Vx, byte
-    static op_handler LD_VX_VY;     // 8xy0 - LD Vx, Vy
-    static op_handler OR_VX_VY;     // 8xy1 - OR Vx, Vy
-    static op_handler AND_VX_VY;    // 8xy2 - AND Vx, Vy
-    static op_handler XOR_VX_VY;    // 8xy3 - XOR Vx, Vy
-    static op_handler ADD_VX_VY;    // 8xy4 - ADD Vx, Vy
-    static op_handler SUB_VX_VY;    // 8xy5 - SUB Vx, Vy
-    static op_handler SHR_VX_VY;    // 8xy6 - SHR Vx {, Vy}
-    static op_handler SUBN_VX_VY;   // 8xy7 - SUBN Vx, Vy
-    static op_handler SHL_VX_VY;    // 8xyE - SHL Vx {, Vy}
-    static op_handler SNE_VX_VY;    // 9xy0 - SNE Vx, Vy
-    static op_handler LD_I_NNN;     // Annn - LD I, addr
-    static op_handler JP_V0_NNN;    // Bnnn - JP V0, addr
-    static op_handler RND_VX_KK;    // Cxkk - RND Vx, byte
-    static op_handler DRW_VX_VY_N;  // Dxyn - DRW Vx, Vy, nibble
-    static op_handler SKP_VX;       // Ex9E - SKP Vx
-    static op_handler SKNP_VX;      // ExA1 - SKNP Vx
-    static op_handler LD_VX_DT;     // Fx07 - LD Vx, DT
-    static op_handler LD_VX_K;      // Fx0A - LD Vx, K
-    static op_handler LD_DT_VX;     // Fx15 - LD DT, Vx
-    static op_handler LD_ST_VX;     // Fx18 - LD ST, Vx
-    static op_handler ADD_I_VX;     // Fx1E - ADD I, Vx
-    static op_handler LD_F_VX;      // Fx29 - LD F, Vx
-    static op_handler LD_B_VX;      // Fx33 - LD B, Vx
-    static op_handler LD_imm_I_VX;  // Fx55 - LD [I], Vx
-    static op_handler LD_VX_imm_I;  // Fx65 - LD Vx,
+    static const op_handler CLS;          // 00E0 - CLS
+    static const op_handler RET;          // 00EE - RET
+    static const op_handler SYS;          // 0nnn - SYS addr
+    static const op_handler JP;           // 1nnn - JP addr
+    static const op_handler CALL;         // 2nnn - CALL addr
+    static const op_handler SE_VX_KK;     // 3xkk - SE Vx, byte
+    static const op_handler SNE_VX_KK;    // 4xkk - SNE Vx, byte
+    static const op_handler SE_VX_VY;     // 5xy0 - SE Vx, Vy
+    static const op_handler LD_VX_KK;     // 6xkk - LD Vx, byte
+    static const op_handler ADD_VX_KK;    // 7xkk - ADD Vx, byte
+    static const op_handler LD_VX_VY;     // 8xy0 - LD Vx, Vy
+    static const op_handler OR_VX_VY;     // 8xy1 - OR Vx, Vy
+    static const op_handler AND_VX_VY;    // 8xy2 - AND Vx, Vy
+    static const op_handler XOR_VX_VY;    // 8xy3 - XOR Vx, Vy
+    static const op_handler ADD_VX_VY;    // 8xy4 - ADD Vx, Vy
+    static const op_handler SUB_VX_VY;    // 8xy5 - SUB Vx, Vy
+    static const op_handler SHR_VX_VY;    // 8xy6 - SHR Vx {, Vy}
+    static const op_handler SUBN_VX_VY;   // 8xy7 - SUBN Vx, Vy
+    static const op_handler SHL_VX_VY;    // 8xyE - SHL Vx {, Vy}
+    static const op_handler SNE_VX_VY;    // 9xy0 - SNE Vx, Vy
+    static const op_handler LD_I_NNN;     // Annn - LD I, addr
+    static const op_handler JP_V0_NNN;    // Bnnn - JP V0, addr
+    static const op_handler RND_VX_KK;    // Cxkk - RND Vx, byte
+    static const op_handler DRW_VX_VY_N;  // Dxyn - DRW Vx, Vy, nibble
+    static const op_handler SKP_VX;       // Ex9E - SKP Vx
+    static const op_handler SKNP_VX;      // ExA1 - SKNP Vx
+    static const op_handler LD_VX_DT;     // Fx07 - LD Vx, DT
+    static const op_handler LD_VX_K;      // Fx0A - LD Vx, K
+    static const op_handler LD_DT_VX;     // Fx15 - LD DT, Vx
+    static const op_handler LD_ST_VX;     // Fx18 - LD ST, Vx
+    static const op_handler ADD_I_VX;     // Fx1E - ADD I, Vx
+    static const op_handler LD_F_VX;      // Fx29 - LD F, Vx
+    static const op_handler LD_B_VX;      // Fx33 - LD B, Vx
+    static const op_handler LD_imm_I_VX;  // Fx55 - LD [I], Vx
+    static const op_handler LD_VX_imm_I;  // Fx65 - LD Vx,
     /* End operation handlers */
+};
 
-    //! @brief Add all the CHIP-8 operation handlers to the operation tree
-    void setup_op_handlers();
+inline void cpu::count_cycle()
+{
+    ++m_cycles;
+}
 
-};
+inline void cpu::mark_ram_written(const std::uint16_t &address, const std::uint16_t &bytes)
+{
+    // at most two blocks, and the write can wrap from the last one to the first
+    const std::uint64_t blocks = (std::uint64_t(1) << ((address & 0xFFF) >> 6))
+                                 | (std::uint64_t(1) << (((address + bytes - 1) & 0xFFF) >> 6));
+
+    if((m_ram_written.load(std::memory_order_relaxed) & blocks) != blocks)
+    {
+        m_ram_written.fetch_or(blocks, std::memory_order_release);
+    }
+}
 
 }
 
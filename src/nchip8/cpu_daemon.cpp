@@ -3,7 +3,14 @@
 //
 
 #include "cpu_daemon.hpp"
+#include "audio.hpp"
 #include "io.hpp"
+#include "recorder.hpp"
+#include "trace_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
 
 namespace nchip8
 {
@@ -25,6 +32,7 @@ cpu_daemon::cpu_daemon() :
         if(loaded)
         {
             nchip8::log << "[cpu_daemon] rom loaded" << '\n';
+            m_history.clear();
             msg.m_callback();
             return;
         }
@@ -36,12 +44,65 @@ cpu_daemon::cpu_daemon() :
     {
         nchip8::log << "[cpu_daemon] reset cpu " << '\n';
 
-        // reset cpu
+        // reset cpu, interactive sessions get a fresh RND sequence every time
         m_cpu.reset();
+        m_cpu.seed_rng(std::random_device{}());
+        m_keys_down = 0;
+        m_last_key_down = cpu::no_key;
+        m_history.clear();
         msg.m_callback();
 
     });
 
+    auto set_breakpoint = [this](const cpu_message &msg)
+    {
+        if(msg.m_data.size() != 2)
+        {
+            msg.m_on_error();
+            return;
+        }
+
+        const std::uint16_t address = (msg.m_data[0] << 8) | msg.m_data[1];
+
+        if(msg.m_type == cpu_message_type::SetBreakpoint)   { m_cpu.set_breakpoint(address); }
+        else                                                { m_cpu.clear_breakpoint(address); }
+
+        msg.m_callback();
+    };
+
+    this->register_message_handler(cpu_message_type::SetBreakpoint, set_breakpoint);
+    this->register_message_handler(cpu_message_type::ClearBreakpoint, set_breakpoint);
+
+    // going back pauses, the debugger is looking at the past, running would start a new future from it
+    auto go_back = [this](const cpu_message &msg)
+    {
+        set_cpu_state(cpu_state::paused);
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t from = m_cpu.get_cycles();
+
+        const bool went_back = (msg.m_type == cpu_message_type::ReverseStep) ? m_history.step_back(m_cpu)
+                                                                              : m_history.continue_back(m_cpu);
+
+        const auto took = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        if(!went_back)
+        {
+            nchip8::log << "[cpu_daemon] can't go back from cycle " << std::dec << from << '\n';
+            msg.m_on_error();
+            return;
+        }
+
+        m_breakpoint_cycle = m_cpu.get_cycles();
+
+        nchip8::log << "[cpu_daemon] went back to cycle " << std::dec << m_cpu.get_cycles() << " at "
+                    << nchip8::nnn << m_cpu.m_pc << " in " << std::dec << took.count() << "us" << '\n';
+        msg.m_callback();
+    };
+
+    this->register_message_handler(cpu_message_type::ReverseStep, go_back);
+    this->register_message_handler(cpu_message_type::ReverseContinue, go_back);
+
 
     nchip8::log << "[cpu_daemon] starting cpu thread" << '\n';
     m_cpu_thread = std::thread(&cpu_daemon::cpu_thread, this);
@@ -49,6 +110,12 @@ cpu_daemon::cpu_daemon() :
 
 cpu_daemon::~cpu_daemon()
 {
+    {
+        std::unique_lock<std::mutex> lock(m_cpu_thread_mutex);
+        m_die = true;
+    }
+
+    m_cpu_thread_wake.notify_all();
     m_cpu_thread.join();
 }
 
@@ -59,27 +126,108 @@ cpu_daemon::cpu_state cpu_daemon::get_cpu_state() const
 
 void cpu_daemon::set_cpu_state(const cpu_daemon::cpu_state &state)
 {
-    m_cpu_state = state;
+    {
+        std::unique_lock<std::mutex> lock(m_cpu_thread_mutex);
+        m_cpu_state = state;
+    }
+
+    m_cpu_thread_wake.notify_all();
+}
+
+trap cpu_daemon::get_trap() const
+{
+    return m_cpu.get_trap();
 }
 
+bool cpu_daemon::is_runnable() const
+{
+    return m_cpu_state == cpu_state::running && m_cpu.get_trap() == trap::none;
+}
+
+bool cpu_daemon::is_blocked_on_input() const
+{
+    // while a timer is running the bursts carry on, so it keeps counting down
+    return m_cpu.is_waiting_for_key() && m_last_key_down == cpu::no_key && m_cpu.get_dt() == 0 && m_cpu.get_st() == 0;
+}
 
 void cpu_daemon::cpu_thread()
 {
-    bool die = false;
+    // instructions run in bursts, one per 60Hz frame
+    const auto frame = std::chrono::microseconds(1000000 / 60);
+    auto next_frame = std::chrono::steady_clock::now();
+
+    // clock speed / 60 is rarely whole, the remainder (in 60ths of a cycle) carries over to the next burst
+    std::size_t cycle_credit = 0;
 
-    while(!die)
+    // the last frame published, and who to, a new recorder gets the current frame straight away
+    packed_framebuffer published {};
+    const frame_recorder* published_to = nullptr;
+
+    // the buzzer as last pushed to the audio thread, when it runs out, and the cycle it was last pushed at
+    bool buzzing = false;
+    std::uint64_t buzz_end = 0;
+    std::uint64_t sounded_at = 0;
+
+    // pushes what the buzzer did since it was last pushed, up to the current cycle,
+    // the mark at the end of a burst goes out even if nothing changed so the audio thread's timeline moves on
+    auto push_sound = [&](audio_synth &audio, const std::uint32_t &speed, const bool &mark)
     {
-        if(m_cpu_state == cpu_state::running)
+        const std::uint64_t now = m_cpu.get_cycles();
+
+        // a reset or a state load, the old timeline has gone
+        if(now < sounded_at && buzzing)
         {
-            m_cpu.execute_op_at_pc();
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000 / m_clock_speed));
+            audio.push_edge(now, speed, false);
+            buzzing = false;
         }
 
+        // it ran out on its own before now
+        if(buzzing && buzz_end <= now)
+        {
+            audio.push_edge(buzz_end, speed, false);
+            buzzing = false;
+        }
+
+        const bool on = (m_cpu.get_st() > 0);
+        if(mark || on != buzzing) { audio.push_edge(now, speed, on); }
+
+        buzzing = on;
+        buzz_end = m_cpu.get_st_expiry_cycle();
+        sounded_at = now;
+    };
+
+    while(true)
+    {
         std::unique_lock<std::mutex> lock(m_cpu_thread_mutex);
-        while(!m_unhandled_messages.empty())
+
+        auto has_work = [this]() { return m_die || !m_unhandled_messages.empty(); };
+
+        if(is_runnable() && !is_blocked_on_input())
+        {
+            // sleep until the next burst is due, messages wake us early
+            m_cpu_thread_wake.wait_until(lock, next_frame, has_work);
+        }
+        else
+        {
+            // nothing to execute, sleep until there is a message, a key or the state changes
+            m_cpu_thread_wake.wait(lock, [&]() { return has_work() || (is_runnable() && !is_blocked_on_input()); });
+        }
+
+        if(m_die) { return; }
+
+        // take the queue and handle it unlocked, handlers may call back into the daemon (e.g. set_cpu_state)
+        std::queue<cpu_message> messages;
+        std::swap(messages, m_unhandled_messages);
+
+        const std::shared_ptr<frame_recorder> recorder = m_recorder;
+        const std::shared_ptr<audio_synth> audio = m_audio;
+        const std::shared_ptr<trace_writer> tracer = m_tracer;
+        lock.unlock();
+
+        while(!messages.empty())
         {
             // get front of queue
-            const auto &msg = m_unhandled_messages.front();
+            const auto &msg = messages.front();
 
             // does the message have message handlers? is it of the correct type?
             if (!m_message_handlers.at(msg.m_type).empty())
@@ -93,7 +241,93 @@ void cpu_daemon::cpu_thread()
                 }
             }
 
-            m_unhandled_messages.pop();
+            messages.pop();
+        }
+
+        if(!is_runnable()) { continue; }
+
+        const auto now = std::chrono::steady_clock::now();
+        if(now < next_frame) { continue; }
+
+        // don't try to catch up after a pause or a long stall
+        if(now - next_frame > frame * 4) { next_frame = now; }
+        next_frame += frame;
+
+        cycle_credit += m_clock_speed;
+        const std::size_t budget = cycle_credit / 60;
+        cycle_credit %= 60;
+
+        const std::size_t speed = m_clock_speed;
+        m_cpu.set_clock_rate(speed);
+
+        // keys only reach the cpu here, between bursts, so the history replays them on the cycle they arrived
+        m_cpu.m_keys_down.store(m_keys_down, std::memory_order_relaxed);
+        m_cpu.m_last_key_down.store(m_last_key_down, std::memory_order_release);
+        m_history.record(m_cpu);
+
+        // with audio, every LD ST, Vx ends a run so its edge lands on the right cycle
+        const std::uint8_t stops = stop_on_key_wait | (audio ? stop_on_sound : 0)
+                                   | (m_cpu.m_breakpoints.any() ? stop_on_breakpoint : 0);
+
+        // and with a tracer, every instruction does
+        const std::size_t slice = tracer ? 1 : budget;
+
+        std::size_t ran = 0;
+        run_result result { run_stop::budget, 0 };
+
+        do
+        {
+            // a run steps over a breakpoint it starts on, which is only right when resuming from it
+            if((stops & stop_on_breakpoint) && m_cpu.get_cycles() != m_breakpoint_cycle && m_cpu.m_breakpoints[m_cpu.m_pc & 0xFFF])
+            {
+                result = { run_stop::breakpoint, 0 };
+                break;
+            }
+
+            const std::uint16_t pc = m_cpu.m_pc;
+            const std::uint16_t opcode = m_cpu.read_u16(pc);
+
+            result = m_cpu.run(std::min(slice, budget - ran), stops);
+            ran += result.m_cycles;
+
+            if(tracer && result.m_cycles > 0) { tracer->record(pc, opcode, m_cpu.get_cycles()); }
+            if(result.m_reason == run_stop::sound) { push_sound(*audio, speed, false); }
+        }
+        while((result.m_reason == run_stop::sound || result.m_reason == run_stop::budget) && ran < budget);
+
+        if(result.m_reason == run_stop::key_wait)
+        {
+            // the rest of the burst is spent waiting, the timers keep counting down
+            m_cpu.idle(budget - ran);
+        }
+        else if(result.m_reason == run_stop::breakpoint)
+        {
+            nchip8::log << "[cpu_daemon] breakpoint at " << nchip8::nnn << m_cpu.m_pc
+                        << " on cycle " << std::dec << m_cpu.get_cycles() << '\n';
+
+            m_breakpoint_cycle = m_cpu.get_cycles();
+            set_cpu_state(cpu_state::paused);
+        }
+        else if(result.m_reason == run_stop::trapped)
+        {
+            nchip8::log << "[cpu_daemon] cpu trapped (" << to_string(m_cpu.get_trap()) << ") at "
+                        << nchip8::nnn << m_cpu.m_pc << ", waiting for reset" << '\n';
+        }
+
+        // moves the audio thread's timeline on to the end of the burst
+        if(audio) { push_sound(*audio, speed, true); }
+
+        if(recorder)
+        {
+            packed_framebuffer frame;
+            pack_framebuffer(m_cpu.get_screen_framebuffer(), frame);
+
+            if(recorder.get() != published_to || frame != published)
+            {
+                recorder->publish(frame, m_cpu.get_screen_mode());
+                published = frame;
+                published_to = recorder.get();
+            }
         }
     }
 }
@@ -104,6 +338,8 @@ void cpu_daemon::send_message(const cpu_message &message)
     // push our message
     m_unhandled_messages.push(message);
 
+    lock.unlock();
+    m_cpu_thread_wake.notify_all();
 }
 
 void cpu_daemon::register_message_handler(const cpu_message_type &type, const cpu_message_handler &hdl)
@@ -112,6 +348,24 @@ void cpu_daemon::register_message_handler(const cpu_message_type &type, const cp
     m_message_handlers.at(type).push_back(hdl);
 }
 
+void cpu_daemon::set_recorder(const std::shared_ptr<frame_recorder> &recorder)
+{
+    std::unique_lock<std::mutex> lock(m_cpu_thread_mutex);
+    m_recorder = recorder;
+}
+
+void cpu_daemon::set_audio(const std::shared_ptr<audio_synth> &audio)
+{
+    std::unique_lock<std::mutex> lock(m_cpu_thread_mutex);
+    m_audio = audio;
+}
+
+void cpu_daemon::set_tracer(const std::shared_ptr<trace_writer> &tracer)
+{
+    std::unique_lock<std::mutex> lock(m_cpu_thread_mutex);
+    m_tracer = tracer;
+}
+
 const cpu::screen_mode &cpu_daemon::get_screen_mode() const
 {
     return m_cpu.get_screen_mode();
@@ -152,24 +406,47 @@ const std::array<std::uint16_t, 16> cpu_daemon::get_stack() const
     return m_cpu.m_stack;
 }
 
+const std::array<std::uint8_t, 0x1000>& cpu_daemon::get_ram() const
+{
+    return m_cpu.m_ram;
+}
+
+std::uint64_t cpu_daemon::take_ram_written()
+{
+    return m_cpu.take_ram_written();
+}
+
 const std::uint8_t cpu_daemon::get_dt() const
 {
-    return m_cpu.m_dt;
+    return m_cpu.get_dt();
 }
 
 const std::uint8_t cpu_daemon::get_st() const
 {
-    return m_cpu.m_st;
+    return m_cpu.get_st();
 }
 
 void cpu_daemon::set_key_down(const std::uint8_t &key)
 {
-    m_cpu.set_key_down(key);
+    // the same as cpu::set_key_down, the cpu thread copies both across
+    m_keys_down.fetch_or(1 << (key & 0xF), std::memory_order_relaxed);
+    m_last_key_down.store(key & 0xF, std::memory_order_release);
+
+    // a cpu blocked on LD Vx, K resumes, passing through the mutex so the
+    // wake-up can't land between the cpu thread checking the latch and going to sleep
+    {
+        std::unique_lock<std::mutex> lock(m_cpu_thread_mutex);
+    }
+
+    m_cpu_thread_wake.notify_all();
 }
 
 void cpu_daemon::set_key_up(const std::uint8_t &key)
 {
-    m_cpu.set_key_up(key);
+    m_keys_down.fetch_and(~(1 << (key & 0xF)), std::memory_order_relaxed);
+
+    std::uint8_t latched = key & 0xF;
+    m_last_key_down.compare_exchange_strong(latched, cpu::no_key, std::memory_order_release, std::memory_order_relaxed);
 }
 
 void cpu_daemon::set_cpu_clockspeed(const size_t &speed)
@@ -6,6 +6,7 @@
 #define CHIP8_NCURSES_CPU_DAEMON_HPP
 
 
+#include <atomic>
 #include <thread>
 #include <vector>
 #include <mutex>
@@ -13,13 +14,19 @@
 #include <queue>
 #include <functional>
 #include <condition_variable>
+#include <memory>
 
 #include "cpu.hpp"
+#include "cpu_history.hpp"
 #include "cpu_message.hpp"
 
 namespace nchip8
 {
 
+class audio_synth;
+class frame_recorder;
+class trace_writer;
+
 //! @brief  The cpu_daemon creates the cpu thread,
 //!         passes messages to the cpu and controls it's state
 //!         e.g. calling for an instruction to be executed or not
@@ -52,11 +59,29 @@ public:
     //! @returns cpu_state
     cpu_state get_cpu_state() const;
 
-    //! @brief Set cpu_state
+    //! @brief Set cpu_state, wakes the cpu thread if it is parked
     void set_cpu_state(const cpu_state &);
 
+    //! @brief      Returns the trap that stopped the cpu, trap::none if it is running normally
+    //! @details    A trapped cpu thread parks until the cpu is reset (see cpu_message_type::Reset)
+    trap get_trap() const;
+
     void set_cpu_clockspeed(const size_t&);
 
+    //! @brief      Publishes frames to a recorder, nullptr stops
+    //! @details    The cpu thread hands it every burst's screen that differs from the last one published,
+    //!             frame_recorder::publish never blocks
+    void set_recorder(const std::shared_ptr<frame_recorder> &recorder);
+
+    //! @brief      Plays the buzzer through an audio_synth, nullptr stops
+    //! @details    The cpu thread stops each burst at every LD ST, Vx so the buzzer's edges are pushed
+    //!             with the cycle they happened on, audio_synth::push_edge never blocks
+    void set_audio(const std::shared_ptr<audio_synth> &audio);
+
+    //! @brief      Records every instruction executed to a trace, nullptr stops
+    //! @details    While tracing, bursts run an instruction at a time, trace_writer::record never waits on the disk
+    void set_tracer(const std::shared_ptr<trace_writer> &tracer);
+
     //! @brief Returns current screen mode
     //! @see cpu::screen_mode
     const cpu::screen_mode& get_screen_mode() const;
@@ -70,7 +95,11 @@ public:
     //! @brief Get's the status of a pixel on the screen (on/off)
     bool get_screen_xy(const std::uint8_t&x , const std::uint8_t& y) const;
 
+    //! @brief      Sets a key as down, safe to call from any thread
+    //! @details    It reaches the cpu at the start of the next burst, never during one, so the history can replay it
     void set_key_down(const std::uint8_t& key);
+
+    //! @brief Sets a key as up, @see set_key_down
     void set_key_up(const std::uint8_t &key);
 
     //! @brief Returns a reference to the general purpose cpu registers (i.e V0-V15)
@@ -94,17 +123,26 @@ public:
     //! @brief Get stack
     const std::array<std::uint16_t, 16> get_stack() const;
 
+    //! @brief Returns a reference to RAM
+    const std::array<std::uint8_t, 0x1000>& get_ram() const;
+
+    //! @see cpu::take_ram_written
+    std::uint64_t take_ram_written();
+
 
     
 private:
     //! The number of times a second we execute a CPU cycle
-    std::size_t m_clock_speed = 500;
+    std::atomic<std::size_t> m_clock_speed = 500;
 
     //! CPU instance
     cpu m_cpu;
 
     //! Current cpu state, e.g. paused, running
-    cpu_state m_cpu_state;
+    std::atomic<cpu_state> m_cpu_state;
+
+    //! Set by the destructor to end the cpu thread
+    bool m_die = false;
 
     //! Thread object for void cpu_thread()
     std::thread m_cpu_thread;
@@ -115,6 +153,37 @@ private:
     //! Locked when the message queue is being processed/operated on
     std::mutex m_cpu_thread_mutex;
 
+    //! The cpu thread waits on this while it's paused or trapped, notified on messages, state changes and exit
+    std::condition_variable m_cpu_thread_wake;
+
+    //! @brief Returns true if the cpu thread should be executing instructions
+    bool is_runnable() const;
+
+    //! Keys as the input thread last set them, the cpu thread hands them to the cpu at the start of each burst.
+    //! Same meaning as cpu::m_keys_down and cpu::m_last_key_down
+    std::atomic<std::uint16_t> m_keys_down { 0 };
+    std::atomic<std::uint8_t> m_last_key_down { cpu::no_key };
+
+    //! Snapshots and input since, to go back in time with, cpu thread only
+    cpu_history m_history;
+
+    //! The cycle the cpu was last stopped at a breakpoint (or gone back to) on, resuming steps over it.
+    //! cpu thread only
+    std::uint64_t m_breakpoint_cycle = 0;
+
+    //! @brief      Returns true if the cpu is waiting on LD Vx, K with nothing else to do
+    //! @details    The cpu thread parks until set_key_down instead of running empty bursts
+    bool is_blocked_on_input() const;
+
+    //! Where frames are published, guarded by m_cpu_thread_mutex
+    std::shared_ptr<frame_recorder> m_recorder;
+
+    //! Where the buzzer is played, guarded by m_cpu_thread_mutex
+    std::shared_ptr<audio_synth> m_audio;
+
+    //! Where executed instructions are recorded, guarded by m_cpu_thread_mutex
+    std::shared_ptr<trace_writer> m_tracer;
+
     //! The list of messages that still need to be processed by the cpu thread
     std::queue<cpu_message> m_unhandled_messages;
 
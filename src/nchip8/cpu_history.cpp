@@ -0,0 +1,273 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "cpu_history.hpp"
+
+#include <algorithm>
+
+namespace nchip8
+{
+
+void cpu_history::clear()
+{
+    m_snapshots.clear();
+    m_events.clear();
+    m_first_event = 0;
+    m_input.reset();
+    m_was_waiting = false;
+}
+
+void cpu_history::record(const cpu &c)
+{
+    const cpu_input input = get_input(c);
+    const std::uint64_t cycle = c.get_cycles();
+
+    if(m_input != input)
+    {
+        m_events.push_back({ cycle, input });
+        m_input = input;
+    }
+
+    const bool waiting = c.is_waiting_for_key();
+    const bool was_waiting = m_was_waiting;
+    m_was_waiting = waiting;
+
+    if(!m_snapshots.empty() && cycle - m_snapshots.back().m_state.m_cycles < snapshot_interval) { return; }
+
+    // a wait that started since the last call may have started on this very cycle, a replay from here couldn't
+    // tell whether a breakpoint on the LD Vx, K was reached now or earlier: take the snapshot next time instead
+    if(waiting && !was_waiting) { return; }
+
+    m_snapshots.emplace_back();
+    c.save_state(m_snapshots.back().m_state);
+    m_snapshots.back().m_input = input;
+    m_snapshots.back().m_next_event = m_first_event + m_events.size();
+
+    if(m_snapshots.size() > max_snapshots)
+    {
+        m_snapshots.pop_front();
+
+        // nothing before the oldest snapshot can be replayed any more
+        while(!m_events.empty() && m_first_event < m_snapshots.front().m_next_event)
+        {
+            m_events.pop_front();
+            m_first_event++;
+        }
+    }
+}
+
+std::optional<std::uint64_t> cpu_history::get_oldest_cycle() const
+{
+    if(m_snapshots.empty()) { return std::nullopt; }
+
+    return m_snapshots.front().m_state.m_cycles;
+}
+
+std::size_t cpu_history::get_memory_usage() const
+{
+    return m_snapshots.size() * sizeof(snapshot) + m_events.size() * sizeof(input_event);
+}
+
+bool cpu_history::seek(cpu &c, const std::uint64_t &cycle)
+{
+    const std::optional<std::size_t> from = find_snapshot(cycle);
+    if(!from.has_value() || cycle > c.get_cycles()) { return false; }
+
+    snapshot saved;
+    c.save_state(saved.m_state);
+    saved.m_input = get_input(c);
+
+    const replay_result end = replay(c, *from, cycle);
+
+    if(!end.m_reached)
+    {
+        set_input(c, saved.m_input);
+        c.load_state(saved.m_state);
+        return false;
+    }
+
+    truncate(c, end);
+    return true;
+}
+
+bool cpu_history::step_back(cpu &c)
+{
+    const std::uint64_t now = c.get_cycles();
+    if(now == 0) { return false; }
+
+    snapshot saved;
+    c.save_state(saved.m_state);
+    saved.m_input = get_input(c);
+
+    std::uint64_t target = now - 1;
+    replay_result end {};
+
+    while(true)
+    {
+        const std::optional<std::size_t> from = find_snapshot(target);
+        if(from.has_value()) { end = replay(c, *from, target); }
+
+        if(!from.has_value() || !end.m_reached)
+        {
+            set_input(c, saved.m_input);
+            c.load_state(saved.m_state);
+            return false;
+        }
+
+        // landed in the wait the cpu was already in, which looks the same all the way through:
+        // go to the instruction before it. Stepping back off the LD Vx, K itself lands on it
+        if(!end.m_waiting_since.has_value() || *end.m_waiting_since == 0 || c.m_pc != saved.m_state.m_pc) { break; }
+
+        target = *end.m_waiting_since - 1;
+    }
+
+    truncate(c, end);
+    return true;
+}
+
+bool cpu_history::continue_back(cpu &c)
+{
+    const std::uint64_t now = c.get_cycles();
+    const std::optional<std::size_t> last = (now > 0) ? find_snapshot(now - 1) : std::nullopt;
+
+    if(!last.has_value()) { return false; }
+
+    snapshot saved;
+    c.save_state(saved.m_state);
+    saved.m_input = get_input(c);
+
+    // the span after each snapshot, latest first, until one reaches a breakpoint
+    std::vector<std::uint64_t> reached;
+
+    for(std::size_t from = *last + 1; from-- > 0;)
+    {
+        std::uint64_t end_cycle = now;
+        if(from + 1 < m_snapshots.size()) { end_cycle = std::min(end_cycle, m_snapshots[from + 1].m_state.m_cycles); }
+
+        reached.clear();
+        replay(c, from, end_cycle, &reached);
+
+        if(!reached.empty())
+        {
+            const replay_result end = replay(c, from, reached.back());
+            truncate(c, end);
+            return true;
+        }
+    }
+
+    set_input(c, saved.m_input);
+    c.load_state(saved.m_state);
+    return false;
+}
+
+cpu_input cpu_history::get_input(const cpu &c)
+{
+    return { c.m_keys_down.load(std::memory_order_relaxed),
+             c.m_last_key_down.load(std::memory_order_relaxed),
+             c.m_clock_rate };
+}
+
+void cpu_history::set_input(cpu &c, const cpu_input &input)
+{
+    c.set_clock_rate(input.m_clock_rate);
+    c.m_keys_down.store(input.m_keys, std::memory_order_relaxed);
+    c.m_last_key_down.store(input.m_latched_key, std::memory_order_release);
+}
+
+std::optional<std::size_t> cpu_history::find_snapshot(const std::uint64_t &cycle) const
+{
+    // snapshots are in cycle order, the first one after the cycle follows the one wanted
+    const auto after = std::upper_bound(m_snapshots.begin(), m_snapshots.end(), cycle,
+        [](const std::uint64_t &c, const snapshot &s) { return c < s.m_state.m_cycles; });
+
+    if(after == m_snapshots.begin()) { return std::nullopt; }
+
+    return std::distance(m_snapshots.begin(), after) - 1;
+}
+
+cpu_history::replay_result cpu_history::replay(cpu &c, const std::size_t &from, const std::uint64_t &target,
+                                               std::vector<std::uint64_t>* breakpoints) const
+{
+    const snapshot &start = m_snapshots.at(from);
+
+    // the clock rate first, changing it brings the timers of the state being replaced up to date
+    set_input(c, start.m_input);
+    c.load_state(start.m_state);
+
+    const std::uint64_t last_event = m_first_event + m_events.size();
+    const std::uint8_t stops = stop_on_key_wait | (breakpoints ? stop_on_breakpoint : 0);
+
+    replay_result result { true, std::nullopt, start.m_next_event };
+
+    // false while the cpu sits on the same LD Vx, K, so a breakpoint there is only reached once,
+    // a snapshot is never taken on the cycle a wait starts (see record) so one in a wait is past its arrival
+    bool arrived = !c.is_waiting_for_key();
+
+    while(true)
+    {
+        // input arrives between runs, on the cycle it did originally
+        for(; result.m_next_event < last_event; result.m_next_event++)
+        {
+            const input_event &event = m_events[result.m_next_event - m_first_event];
+            if(event.m_cycle > c.m_cycles) { break; }
+
+            set_input(c, event.m_input);
+        }
+
+        if(breakpoints && arrived && c.m_cycles < target && c.m_breakpoints[c.m_pc & 0xFFF])
+        {
+            breakpoints->push_back(c.m_cycles);
+        }
+
+        if(c.m_cycles >= target) { break; }
+
+        std::uint64_t limit = target;
+        if(result.m_next_event < last_event)
+        {
+            limit = std::min(limit, m_events[result.m_next_event - m_first_event].m_cycle);
+        }
+
+        const run_result ran = c.run(limit - c.m_cycles, stops);
+
+        arrived = true;
+        if(ran.m_cycles > 0) { result.m_waiting_since.reset(); }
+
+        if(ran.m_reason == run_stop::key_wait)
+        {
+            // the same as the cpu thread, the cycles until the next input pass waiting
+            if(!result.m_waiting_since.has_value()) { result.m_waiting_since = c.m_cycles; }
+
+            c.idle(limit - c.m_cycles);
+            arrived = false;
+        }
+        else if(ran.m_reason == run_stop::trapped)
+        {
+            result.m_reached = false;
+            break;
+        }
+    }
+
+    return result;
+}
+
+void cpu_history::truncate(const cpu &c, const replay_result &end)
+{
+    const std::uint64_t now = c.get_cycles();
+
+    while(!m_snapshots.empty() && (m_snapshots.back().m_state.m_cycles > now
+                                   || m_snapshots.back().m_next_event > end.m_next_event))
+    {
+        m_snapshots.pop_back();
+    }
+
+    while(!m_events.empty() && m_first_event + m_events.size() > end.m_next_event)
+    {
+        m_events.pop_back();
+    }
+
+    m_input = get_input(c);
+    m_was_waiting = false;
+}
+
+}
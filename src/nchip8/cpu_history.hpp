@@ -0,0 +1,144 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_CPU_HISTORY_HPP
+#define NCHIP8_CPU_HISTORY_HPP
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "cpu.hpp"
+
+namespace nchip8
+{
+
+//! @brief Everything from outside the machine that a run depends on: the keypad, and the clock rate
+struct cpu_input
+{
+    std::uint16_t m_keys;
+    std::uint8_t m_latched_key;
+    std::uint32_t m_clock_rate;
+
+    bool operator==(const cpu_input &other) const
+    {
+        return m_keys == other.m_keys && m_latched_key == other.m_latched_key
+               && m_clock_rate == other.m_clock_rate;
+    }
+
+    bool operator!=(const cpu_input &other) const { return !(*this == other); }
+};
+
+//! @brief      Lets a cpu go back in time
+//! @details    A run is deterministic given its starting state and its input, so the history keeps a
+//!             snapshot every snapshot_interval cycles and a log of every change of input since the
+//!             oldest one. Going back to a cycle reloads the nearest snapshot before it and re-executes
+//!             forward with cpu::run, headless, replaying the input on the cycles it arrived on.
+//!             That only holds if input reaches the cpu between runs, never during one (see cpu_daemon).
+//!
+//!             Snapshots are a fixed number of cycles apart, so going back costs at most that many cycles
+//!             of re-execution whatever the clock speed, and there are at most max_snapshots of them,
+//!             so memory is bounded. The oldest are forgotten first.
+class cpu_history
+{
+public:
+    //! Cycles between snapshots, the most re-executed to reach any cycle
+    static constexpr std::uint64_t snapshot_interval = 1 << 15;
+
+    //! Snapshots kept, about 13KiB each: 26MiB, 67M cycles
+    static constexpr std::size_t max_snapshots = 2048;
+
+    //! @brief Forgets everything, e.g. after a reset or a ROM load breaks the timeline
+    void clear();
+
+    //! @brief      Notes the cpu's input and takes a snapshot if one is due
+    //! @details    Call between runs, after any new input has been handed to the cpu
+    void record(const cpu &c);
+
+    //! @brief Returns the oldest cycle that can be gone back to, nullopt if there's no history yet
+    std::optional<std::uint64_t> get_oldest_cycle() const;
+
+    //! @brief Returns the memory held by snapshots and the input log
+    std::size_t get_memory_usage() const;
+
+    //! @brief          Takes the cpu back to how it was on an earlier cycle
+    //! @details        Everything after it is forgotten, from there on the cpu makes new history
+    //! @returns        False, with the cpu untouched, if the cycle isn't in the history
+    bool seek(cpu &c, const std::uint64_t &cycle);
+
+    //! @brief      Takes the cpu back to before the last instruction it executed
+    //! @details    Cycles spent waiting on LD Vx, K are stepped over along with the wait
+    //! @returns    False, with the cpu untouched, if that's older than the history
+    bool step_back(cpu &c);
+
+    //! @brief      Takes the cpu back to the last time it reached a breakpoint (see cpu::set_breakpoint)
+    //! @details    Searches back a snapshot at a time, so the cost grows with how far back that was
+    //! @returns    False, with the cpu untouched, if no breakpoint was reached in the history
+    bool continue_back(cpu &c);
+
+private:
+    //! @brief A change of input, applied before the cycle after m_cycle runs
+    struct input_event
+    {
+        std::uint64_t m_cycle;
+        cpu_input m_input;
+    };
+
+    //! @brief The whole machine at a cycle, and where in the log it carries on from
+    struct snapshot
+    {
+        machine_state m_state;
+        cpu_input m_input;
+
+        //! Index of the first event after this snapshot, counted from the first event ever logged
+        std::uint64_t m_next_event;
+    };
+
+    //! @brief How a replay went
+    struct replay_result
+    {
+        //! False if the cpu stopped (trapped) before the target
+        bool m_reached;
+
+        //! The cycle the cpu started waiting on LD Vx, K, if it was still waiting at the target
+        std::optional<std::uint64_t> m_waiting_since;
+
+        //! Index of the first event not applied
+        std::uint64_t m_next_event;
+    };
+
+    std::deque<snapshot> m_snapshots;
+    std::deque<input_event> m_events;
+
+    //! Index of m_events.front(), counted from the first event ever logged
+    std::uint64_t m_first_event = 0;
+
+    //! The input as of the last event, to log only changes
+    std::optional<cpu_input> m_input;
+
+    //! Whether the cpu was waiting on LD Vx, K at the last record
+    bool m_was_waiting = false;
+
+    //! @brief Returns the input the cpu has
+    static cpu_input get_input(const cpu &c);
+
+    //! @brief Hands input to the cpu
+    static void set_input(cpu &c, const cpu_input &input);
+
+    //! @brief Returns the index of the latest snapshot at or before a cycle, nullopt if there isn't one
+    std::optional<std::size_t> find_snapshot(const std::uint64_t &cycle) const;
+
+    //! @brief              Reloads a snapshot and re-executes up to a cycle
+    //! @param breakpoints  If given, every cycle a breakpoint was reached on before the target is appended
+    replay_result replay(cpu &c, const std::size_t &from, const std::uint64_t &target,
+                         std::vector<std::uint64_t>* breakpoints = nullptr) const;
+
+    //! @brief Forgets everything after a replay's end, the cpu's timeline carries on from there
+    void truncate(const cpu &c, const replay_result &end);
+};
+
+}
+
+#endif //NCHIP8_CPU_HISTORY_HPP
@@ -5,6 +5,7 @@
 #ifndef NCHIP8_CPU_MESSAGE_HPP
 #define NCHIP8_CPU_MESSAGE_HPP
 
+#include <cstdint>
 #include <functional>
 #include <vector>
 
@@ -16,6 +17,10 @@ enum cpu_message_type : std::uint8_t
 {
     Reset,              //! Resets the cpu. Clear registers & ram, PC = 0x200   m_data: none
     LoadROM,            //! Writes a rom to cpu memory.                         m_data: vector of ROM binary
+    SetBreakpoint,      //! Pauses the cpu before the instruction at an address. m_data: address, high byte first
+    ClearBreakpoint,    //! Removes a breakpoint.                               m_data: address, high byte first
+    ReverseStep,        //! Pauses and goes back one instruction, m_on_error if that's before the history.  m_data: none
+    ReverseContinue,    //! Pauses and goes back to the last breakpoint reached, m_on_error if there's none. m_data: none
     _last               // Used to find amount of messages, keep at end of enum
 };
 
@@ -0,0 +1,304 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "differential.hpp"
+#include "hash.hpp"
+#include "io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace nchip8
+{
+
+//! @brief Describes the first field that differs between two states
+static std::string describe_difference(const machine_state &a, const machine_state &b)
+{
+    std::stringstream ss;
+
+    for(std::size_t r = 0; r < a.m_gpr.size(); r++)
+    {
+        if(a.m_gpr[r] != b.m_gpr[r])
+        {
+            ss << nchip8::V << r << ' ' << nchip8::kk << std::uint16_t(a.m_gpr[r])
+               << " != " << nchip8::kk << std::uint16_t(b.m_gpr[r]);
+            return ss.str();
+        }
+    }
+
+    if(a.m_pc != b.m_pc) { ss << "PC " << nchip8::nnn << a.m_pc << " != " << nchip8::nnn << b.m_pc; return ss.str(); }
+    if(a.m_i != b.m_i)   { ss << "I " << nchip8::nnn << a.m_i << " != " << nchip8::nnn << b.m_i; return ss.str(); }
+    if(a.m_sp != b.m_sp) { ss << "SP " << std::dec << +a.m_sp << " != " << +b.m_sp; return ss.str(); }
+    if(a.m_dt != b.m_dt) { ss << "DT " << std::dec << +a.m_dt << " != " << +b.m_dt; return ss.str(); }
+    if(a.m_st != b.m_st) { ss << "ST " << std::dec << +a.m_st << " != " << +b.m_st; return ss.str(); }
+    if(a.m_rng != b.m_rng) { return "RND state"; }
+    if(a.m_cycles != b.m_cycles) { ss << "cycles " << std::dec << a.m_cycles << " != " << b.m_cycles; return ss.str(); }
+    if(a.m_stack != b.m_stack) { return "stack"; }
+
+    auto ram = std::mismatch(a.m_ram.begin(), a.m_ram.end(), b.m_ram.begin());
+    if(ram.first != a.m_ram.end())
+    {
+        ss << "RAM[" << nchip8::nnn << (ram.first - a.m_ram.begin()) << "] "
+           << nchip8::kk << std::uint16_t(*ram.first) << " != " << nchip8::kk << std::uint16_t(*ram.second);
+        return ss.str();
+    }
+
+    auto pixel = std::mismatch(a.m_screen.begin(), a.m_screen.end(), b.m_screen.begin());
+    if(pixel.first != a.m_screen.end())
+    {
+        ss << "screen pixel " << std::dec << (pixel.first - a.m_screen.begin());
+        return ss.str();
+    }
+
+    if(a.m_screen_mode != b.m_screen_mode) { return "screen mode"; }
+    if(a.m_trap != b.m_trap) { ss << "trap " << to_string(a.m_trap) << " != " << to_string(b.m_trap); return ss.str(); }
+
+    return "stop reason";
+}
+
+//! @brief The scripted input: keys held from a cycle onwards
+struct key_change
+{
+    std::size_t m_cycle;
+    std::uint16_t m_keys;
+};
+
+static std::vector<key_change> make_key_schedule(const std::uint32_t &seed, const std::size_t &max_cycles)
+{
+    std::vector<key_change> schedule;
+    std::uint32_t state = seed ? seed : 1;
+
+    auto next = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    for(std::size_t cycle = 0; cycle < max_cycles; cycle += 1 + (next() % 2000))
+    {
+        // half the time nothing is held, otherwise a single key
+        const std::uint32_t roll = next();
+        schedule.push_back({ cycle, std::uint16_t((roll & 1) ? (1 << ((roll >> 1) & 0xF)) : 0) });
+    }
+
+    return schedule;
+}
+
+//! @brief Returns the keys held at a cycle
+static std::uint16_t keys_at(const std::vector<key_change> &schedule, const std::size_t &cycle)
+{
+    auto it = std::upper_bound(schedule.begin(), schedule.end(), cycle,
+        [](const std::size_t &c, const key_change &change) { return c < change.m_cycle; });
+
+    return (it == schedule.begin()) ? 0 : std::prev(it)->m_keys;
+}
+
+//! @brief Returns the cycle the keys next change at, or SIZE_MAX
+static std::size_t next_key_change(const std::vector<key_change> &schedule, const std::size_t &cycle)
+{
+    auto it = std::upper_bound(schedule.begin(), schedule.end(), cycle,
+        [](const std::size_t &c, const key_change &change) { return c < change.m_cycle; });
+
+    return (it == schedule.end()) ? SIZE_MAX : it->m_cycle;
+}
+
+differential_runner::differential_runner(const differential_options &options) :
+    m_options(options)
+{
+    if(!make_engine(options.m_engine_a, options.m_cycles_per_tick) ||
+       !make_engine(options.m_engine_b, options.m_cycles_per_tick))
+    {
+        throw std::invalid_argument("unknown engine");
+    }
+
+    m_options.m_checkpoint = std::max<std::size_t>(m_options.m_checkpoint, 1);
+}
+
+differential_result differential_runner::compare(const std::string &name, const std::vector<std::uint8_t> &rom) const
+{
+    differential_result result;
+    result.m_rom = name;
+
+    auto image = cpu::make_power_on_state(rom, 0x200);
+    if(!image.has_value())
+    {
+        result.m_error = "ROM does not fit in memory";
+        return result;
+    }
+
+    cpu::seed_rng(*image, m_options.m_seed);
+
+    const std::vector<key_change> schedule = make_key_schedule(m_options.m_seed, m_options.m_max_cycles);
+
+    std::unique_ptr<engine> engine_a = make_engine(m_options.m_engine_a, m_options.m_cycles_per_tick);
+    std::unique_ptr<engine> engine_b = make_engine(m_options.m_engine_b, m_options.m_cycles_per_tick);
+
+    // ~12KiB each, keep them off the stack
+    auto a = std::make_unique<cpu>();
+    auto b = std::make_unique<cpu>();
+    auto agreed_a = std::make_unique<machine_state>(*image);
+    auto agreed_b = std::make_unique<machine_state>(*image);
+    auto state_a = std::make_unique<machine_state>();
+    auto state_b = std::make_unique<machine_state>();
+
+    a->reset(*image);
+    b->reset(*image);
+
+    // machine_state doesn't hold the keypad, a checkpoint keeps each engine's keys and latch beside it
+    struct keypad { std::uint16_t m_keys; std::uint8_t m_latched; };
+    keypad agreed_keys_a { 0, cpu::no_key };
+    keypad agreed_keys_b { 0, cpu::no_key };
+
+    std::size_t agreed_cycle = 0;
+    std::size_t cycle = 0;
+
+    // runs both engines from cycle to target, following the key schedule,
+    // returns false as soon as they stop differently
+    auto run_span = [&](const std::size_t &target, engine_result &ra, engine_result &rb)
+    {
+        ra = rb = { 0, engine_stop::none, trap::none };
+
+        while(cycle < target)
+        {
+            const std::size_t span = std::min(target, next_key_change(schedule, cycle)) - cycle;
+            const std::uint16_t keys = keys_at(schedule, cycle);
+
+            a->set_keys_mask(keys);
+            b->set_keys_mask(keys);
+
+            ra = engine_a->step(*a, span);
+            rb = engine_b->step(*b, span);
+
+            if(ra.m_cycles != rb.m_cycles || ra.m_stop != rb.m_stop) { return false; }
+
+            cycle += ra.m_cycles;
+            if(ra.m_stop != engine_stop::none) { break; }
+        }
+
+        return true;
+    };
+
+    bool diverged = false;
+    engine_result ra {}, rb {};
+
+    while(cycle < m_options.m_max_cycles)
+    {
+        const std::size_t target = std::min(cycle + m_options.m_checkpoint, m_options.m_max_cycles);
+
+        const bool same_stop = run_span(target, ra, rb);
+
+        a->save_state(*state_a);
+        b->save_state(*state_b);
+
+        if(!same_stop || hash_machine_state(*state_a) != hash_machine_state(*state_b))
+        {
+            diverged = true;
+            break;
+        }
+
+        result.m_rolling_hash = hash_combine(result.m_rolling_hash, hash_machine_state(*state_a));
+
+        std::swap(agreed_a, state_a);
+        std::swap(agreed_b, state_b);
+        agreed_keys_a = { a->get_keys_mask(), a->get_latched_key() };
+        agreed_keys_b = { b->get_keys_mask(), b->get_latched_key() };
+        agreed_cycle = cycle;
+
+        if(ra.m_stop != engine_stop::none) { break; }
+    }
+
+    if(!diverged)
+    {
+        result.m_match = true;
+        result.m_cycles = cycle;
+        result.m_stop_a = ra.m_stop;
+        result.m_stop_b = rb.m_stop;
+        return result;
+    }
+
+    // bisect: back to the last checkpoint that agreed, then one instruction at a time
+    a->load_state(*agreed_a);
+    b->load_state(*agreed_b);
+    a->restore_keys(agreed_keys_a.m_keys, agreed_keys_a.m_latched);
+    b->restore_keys(agreed_keys_b.m_keys, agreed_keys_b.m_latched);
+    cycle = agreed_cycle;
+
+    while(cycle <= m_options.m_max_cycles)
+    {
+        // the checkpoint buffer is free now, use it to see what is about to execute
+        a->save_state(*agreed_a);
+
+        result.m_pc = agreed_a->m_pc;
+        result.m_instruction = (agreed_a->m_ram[result.m_pc & 0xFFF] << 8) | agreed_a->m_ram[(result.m_pc + 1) & 0xFFF];
+
+        const bool same_stop = run_span(cycle + 1, ra, rb);
+
+        a->save_state(*state_a);
+        b->save_state(*state_b);
+
+        if(!same_stop || hash_machine_state(*state_a) != hash_machine_state(*state_b))
+        {
+            result.m_cycles = cycle;
+            result.m_stop_a = ra.m_stop;
+            result.m_stop_b = rb.m_stop;
+            result.m_difference = describe_difference(*state_a, *state_b);
+            return result;
+        }
+
+        // both stopped the same way on the same state before reaching the checkpoint that disagreed
+        if(ra.m_stop != engine_stop::none) { break; }
+    }
+
+    // only reachable if an engine is not deterministic
+    result.m_cycles = cycle;
+    result.m_difference = "engines are not deterministic";
+    return result;
+}
+
+std::vector<differential_result> differential_runner::compare_corpus(const std::vector<std::string> &paths) const
+{
+    std::vector<differential_result> results(paths.size());
+    std::atomic<std::size_t> next(0);
+
+    auto worker = [&]()
+    {
+        for(std::size_t i = next.fetch_add(1); i < paths.size(); i = next.fetch_add(1))
+        {
+            try
+            {
+                results[i] = compare(paths[i], nchip8::read_binary_file(paths[i]));
+            }
+            catch(const std::exception &e)
+            {
+                results[i].m_rom = paths[i];
+                results[i].m_error = e.what();
+            }
+        }
+    };
+
+    std::size_t jobs = m_options.m_jobs;
+    if(jobs == 0) { jobs = std::max(1u, std::thread::hardware_concurrency()); }
+    jobs = std::min(jobs, std::max<std::size_t>(paths.size(), 1));
+
+    std::vector<std::thread> workers;
+    for(std::size_t j = 0; j < jobs; j++)
+    {
+        workers.emplace_back(worker);
+    }
+
+    for(std::thread &t : workers)
+    {
+        t.join();
+    }
+
+    return results;
+}
+
+}
@@ -0,0 +1,97 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_DIFFERENTIAL_HPP
+#define NCHIP8_DIFFERENTIAL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "engine.hpp"
+
+namespace nchip8
+{
+
+//! @brief Options for a differential run
+struct differential_options
+{
+    //! Engines to compare, see get_engine_names()
+    std::string m_engine_a = "reference";
+    std::string m_engine_b = "coverage";
+
+    //! Cycles between state comparisons
+    std::size_t m_checkpoint = 1000;
+
+    //! Cycles to run each ROM for
+    std::size_t m_max_cycles = 1000000;
+
+    //! Instructions per 60Hz timer tick, 500Hz / 60
+    std::uint32_t m_cycles_per_tick = 8;
+
+    //! Seeds both RND and the scripted key input
+    std::uint32_t m_seed = 1;
+
+    //! Worker threads for compare_corpus, 0 = one per core
+    std::size_t m_jobs = 0;
+};
+
+//! @brief The outcome of comparing two engines on one ROM
+struct differential_result
+{
+    //! The ROM's name, e.g. its path
+    std::string m_rom;
+
+    //! True if the engines agreed all the way
+    bool m_match = false;
+
+    //! Cycles run, or the cycle the engines diverged on
+    std::size_t m_cycles = 0;
+
+    //! How each engine stopped (at the divergence if there was one)
+    engine_stop m_stop_a = engine_stop::none;
+    engine_stop m_stop_b = engine_stop::none;
+
+    //! Rolling hash of the reference (a) engine's state at every checkpoint
+    std::uint64_t m_rolling_hash = 0;
+
+    //! The diverging instruction and its address, if there was a divergence
+    std::uint16_t m_pc = 0;
+    std::uint16_t m_instruction = 0;
+
+    //! First piece of state that differed, e.g. "V3 0x12 != 0x13"
+    std::string m_difference;
+
+    //! Set if the ROM could not be run at all
+    std::string m_error;
+};
+
+//! @brief      Runs two engines in lockstep on the same ROM and input
+//! @details    State hashes are compared every m_checkpoint cycles.
+//!             On a mismatch both engines are restored to the last checkpoint that agreed
+//!             and single-stepped to the exact instruction where they diverge.
+class differential_runner
+{
+public:
+    //! @throws std::invalid_argument if either engine name is unknown
+    explicit differential_runner(const differential_options &options);
+
+    //! @brief      Compares the engines on one ROM
+    //! @param name Used to label the result
+    //! @param rom  The ROM, loaded at 0x200
+    differential_result compare(const std::string &name, const std::vector<std::uint8_t> &rom) const;
+
+    //! @brief          Compares the engines on every ROM, spread over m_jobs threads
+    //! @param paths    ROM file paths
+    //! @returns        One result per path, in the same order
+    std::vector<differential_result> compare_corpus(const std::vector<std::string> &paths) const;
+
+private:
+    differential_options m_options;
+};
+
+}
+
+#endif //NCHIP8_DIFFERENTIAL_HPP
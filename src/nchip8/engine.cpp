@@ -0,0 +1,161 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "engine.hpp"
+#include "fuzzer.hpp"
+
+#include <algorithm>
+
+namespace nchip8
+{
+
+reference_engine::reference_engine(const std::uint32_t &cycles_per_tick) :
+    m_cycles_per_tick(std::max<std::uint32_t>(cycles_per_tick, 1))
+{
+
+}
+
+const char* reference_engine::get_name() const
+{
+    return "reference";
+}
+
+engine_result reference_engine::step(cpu &target, const std::size_t &cycles)
+{
+    cpu& c = target;
+
+    if(c.m_trap != trap::none) { return { 0, engine_stop::fault, c.m_trap }; }
+
+    c.set_cycles_per_tick(m_cycles_per_tick);
+
+    for(std::size_t cycle = 0; cycle < cycles; cycle++)
+    {
+        c.count_cycle();
+
+        if(c.m_pc > 0xFFE)
+        {
+            c.m_trap = trap::pc_out_of_range;
+            return { cycle + 1, engine_stop::fault, c.m_trap };
+        }
+
+        const std::uint16_t instruction = c.read_u16(c.m_pc);
+        const cpu::op_handler* handler = cpu::get_op_handler_for_instruction(instruction);
+
+        if(handler == nullptr)
+        {
+            c.m_trap = trap::illegal_opcode;
+            return { cycle + 1, engine_stop::fault, c.m_trap };
+        }
+
+        // waiting on a key, the cycle passes without executing
+        if(handler == &cpu::LD_VX_K && !c.has_key_latched()) { continue; }
+
+        const std::uint16_t saved_pc = c.m_pc;
+        handler->m_execute_op(c, c.get_operand_data_from_instruction(instruction));
+
+        if(c.m_trap != trap::none) { return { cycle + 1, engine_stop::fault, c.m_trap }; }
+
+        if(c.m_pc == saved_pc)
+        {
+            if(handler == &cpu::JP) { return { cycle + 1, engine_stop::halted, trap::none }; }
+
+            c.m_pc += 2;
+        }
+    }
+
+    return { cycles, engine_stop::none, trap::none };
+}
+
+//! @brief cpu::run, the burst loop the interactive and batch schedulers use
+class burst_engine : public engine
+{
+public:
+    explicit burst_engine(const std::uint32_t &cycles_per_tick) :
+        m_cycles_per_tick(cycles_per_tick)
+    {
+
+    }
+
+    const char* get_name() const override
+    {
+        return "burst";
+    }
+
+    engine_result step(cpu &target, const std::size_t &cycles) override
+    {
+        target.set_cycles_per_tick(m_cycles_per_tick);
+
+        const run_result result = target.run(cycles);
+
+        if(result.m_reason == run_stop::halted)     { return { result.m_cycles, engine_stop::halted, trap::none }; }
+        if(result.m_reason == run_stop::trapped)    { return { result.m_cycles, engine_stop::fault, target.get_trap() }; }
+
+        return { result.m_cycles, engine_stop::none, trap::none };
+    }
+
+private:
+    std::uint32_t m_cycles_per_tick;
+};
+
+//! @brief The fuzzer's instrumented engine, so its dispatch loop gets checked too
+class instrumented_engine : public engine
+{
+public:
+    explicit instrumented_engine(const std::uint32_t &cycles_per_tick) :
+        m_cycles_per_tick(cycles_per_tick),
+        m_map{}
+    {
+
+    }
+
+    const char* get_name() const override
+    {
+        return "coverage";
+    }
+
+    engine_result step(cpu &target, const std::size_t &cycles) override
+    {
+        coverage_engine engine(target, m_map, m_cycles_per_tick);
+
+        // keep the keys the caller set, the engine applies them per event
+        const std::uint16_t keys = engine.get_keys();
+
+        std::vector<fuzz_input_event> events;
+        for(std::size_t left = cycles; left > 0; )
+        {
+            const std::uint16_t chunk = std::min<std::size_t>(left, 0xFFFF);
+            events.push_back({ keys, chunk });
+            left -= chunk;
+        }
+
+        const std::uint64_t start = target.get_cycles();
+        const fuzz_outcome outcome = engine.run(events);
+        const std::size_t ran = target.get_cycles() - start;
+
+        if(outcome == fuzz_outcome::halted)     { return { ran, engine_stop::halted, trap::none }; }
+        if(outcome == fuzz_outcome::trapped)    { return { ran, engine_stop::fault, target.get_trap() }; }
+
+        return { ran, engine_stop::none, trap::none };
+    }
+
+private:
+    std::uint32_t m_cycles_per_tick;
+    coverage_map m_map;
+};
+
+std::unique_ptr<engine> make_engine(const std::string &name, const std::uint32_t &cycles_per_tick)
+{
+    if(name == "reference") { return std::make_unique<reference_engine>(cycles_per_tick); }
+    if(name == "coverage")  { return std::make_unique<instrumented_engine>(cycles_per_tick); }
+    if(name == "burst")     { return std::make_unique<burst_engine>(cycles_per_tick); }
+
+    return nullptr;
+}
+
+std::vector<std::string> get_engine_names()
+{
+    return { "reference", "coverage", "burst" };
+}
+
+}
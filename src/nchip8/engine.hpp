@@ -0,0 +1,84 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_ENGINE_HPP
+#define NCHIP8_ENGINE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+
+namespace nchip8
+{
+
+//! @brief Why an engine stopped before running every cycle it was asked for
+enum class engine_stop : std::uint8_t
+{
+    none,       //! Ran every cycle
+    halted,     //! Jumped to itself, the usual CHIP-8 way of stopping
+    fault       //! The cpu trapped, see engine_result::m_trap
+};
+
+//! @brief What a call to engine::step did
+struct engine_result
+{
+    //! Cycles consumed, including the one that stopped the engine
+    std::size_t m_cycles;
+
+    engine_stop m_stop;
+
+    //! Why the cpu trapped, trap::none unless m_stop is fault
+    trap m_trap;
+};
+
+//! @brief      An execution engine, a way of running a cpu forward
+//! @details    Every engine must give the same results as op_handlers.cpp for the same input,
+//!             see differential.hpp. Engines are headless: they never log, and tick the timers
+//!             from the cpu's cycle counter rather than wall time.
+//!             A cycle spent waiting on LD Vx, K counts as a cycle.
+//!             Faults are raised as cpu traps, so a trapped cpu stays stopped across engines.
+class engine
+{
+public:
+    virtual ~engine() = default;
+
+    //! @brief Returns the name the engine is created by, see make_engine
+    virtual const char* get_name() const = 0;
+
+    //! @brief          Runs the target for up to the supplied number of cycles
+    //! @param target   The cpu to run
+    //! @param cycles   Cycles to run for
+    virtual engine_result step(cpu &target, const std::size_t &cycles) = 0;
+};
+
+//! @brief  The reference engine, the same fetch/decode/execute as cpu::execute_op_at_pc
+class reference_engine : public engine
+{
+public:
+    //! @param cycles_per_tick  Instructions per 60Hz timer tick
+    explicit reference_engine(const std::uint32_t &cycles_per_tick);
+
+    const char* get_name() const override;
+
+    engine_result step(cpu &target, const std::size_t &cycles) override;
+
+private:
+    std::uint32_t m_cycles_per_tick;
+};
+
+//! @brief                  Creates an engine by name
+//! @param name             One of get_engine_names()
+//! @param cycles_per_tick  Instructions per 60Hz timer tick
+//! @returns                The engine, or nullptr if the name is unknown
+std::unique_ptr<engine> make_engine(const std::string &name, const std::uint32_t &cycles_per_tick);
+
+//! @brief Returns the names make_engine accepts
+std::vector<std::string> get_engine_names();
+
+}
+
+#endif //NCHIP8_ENGINE_HPP
@@ -0,0 +1,263 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "frame_dump.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef NCHIP8_HAVE_PNG
+#include <png.h>
+#endif
+
+namespace nchip8
+{
+
+//! Encoded bytes a worker holds before writing them out
+static constexpr std::size_t batch_limit = 1 << 20;
+
+bool is_image_format_available(const image_format &format)
+{
+#ifdef NCHIP8_HAVE_PNG
+    return format == image_format::pbm || format == image_format::png;
+#else
+    return format == image_format::pbm;
+#endif
+}
+
+const char* get_image_extension(const image_format &format)
+{
+    return (format == image_format::png) ? "png" : "pbm";
+}
+
+#ifdef NCHIP8_HAVE_PNG
+static void encode_png(const packed_framebuffer &frame, const unsigned &width, const unsigned &height,
+                       std::vector<std::uint8_t> &out)
+{
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+
+    if(!info)
+    {
+        png_destroy_write_struct(&png, nullptr);
+        throw std::runtime_error("could not create a PNG encoder");
+    }
+
+    // libpng reports errors by longjmp, nothing between here and the end needs unwinding
+    if(setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, &info);
+        throw std::runtime_error("PNG encoding failed");
+    }
+
+    png_set_write_fn(png, &out,
+        [](png_structp p, png_bytep data, png_size_t size)
+        {
+            auto* buffer = static_cast<std::vector<std::uint8_t>*>(png_get_io_ptr(p));
+            buffer->insert(buffer->end(), data, data + size);
+        },
+        nullptr);
+
+    // 1-bit greyscale is the packed framebuffer as is, row by row
+    png_set_IHDR(png, info, width, height, 1, PNG_COLOR_TYPE_GRAY,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    for(unsigned y = 0; y < height; y++)
+    {
+        png_write_row(png, const_cast<png_bytep>(frame.data() + y * width / 8));
+    }
+
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+}
+#endif
+
+void encode_image(const packed_framebuffer &frame, const screen_mode &mode, const image_format &format,
+                  std::vector<std::uint8_t> &out)
+{
+    const unsigned width = (mode == screen_mode::hires_sc8) ? 128 : 64;
+    const unsigned height = (mode == screen_mode::hires_sc8) ? 64 : 32;
+
+    out.clear();
+
+    if(format == image_format::png)
+    {
+#ifdef NCHIP8_HAVE_PNG
+        encode_png(frame, width, height, out);
+        return;
+#else
+        throw std::runtime_error("built without PNG support");
+#endif
+    }
+
+    // P4: header, then rows MSB first, the same layout as the packed framebuffer but 1 = black
+    const std::string header = "P4\n" + std::to_string(width) + ' ' + std::to_string(height) + '\n';
+    out.assign(header.begin(), header.end());
+
+    for(std::size_t i = 0; i < width * height / 8; i++)
+    {
+        out.push_back(~frame[i]);
+    }
+}
+
+frame_dumper::frame_dumper(const std::string &directory, const image_format &format, std::size_t jobs) :
+    m_directory(directory),
+    m_format(format),
+    m_written(0),
+    m_failed(0)
+{
+    if(!is_image_format_available(format))
+    {
+        throw std::invalid_argument(std::string("image format not built in: ") + get_image_extension(format));
+    }
+
+    if(jobs == 0) { jobs = std::max(1u, std::thread::hardware_concurrency()); }
+
+    for(std::size_t j = 0; j < jobs; j++)
+    {
+        m_workers.emplace_back(&frame_dumper::worker, this);
+    }
+}
+
+frame_dumper::~frame_dumper()
+{
+    finish();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for(std::thread &t : m_workers)
+    {
+        t.join();
+    }
+}
+
+void frame_dumper::submit(const std::string &name, const packed_framebuffer &frame, const screen_mode &mode)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobs.push(dump_job { m_directory + '/' + name + '.' + get_image_extension(m_format), frame, mode });
+        m_in_flight++;
+    }
+
+    m_wake.notify_one();
+}
+
+std::size_t frame_dumper::finish()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_in_flight == 0; });
+
+    const bool unsynced = (m_unsynced > 0);
+    m_unsynced = 0;
+    lock.unlock();
+
+    if(!unsynced) { return m_failed; }
+
+    // one sync for everything rather than one per file
+    const int dir = ::open(m_directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if(dir >= 0)
+    {
+        ::syncfs(dir);
+        ::fsync(dir);
+        ::close(dir);
+    }
+
+    return m_failed;
+}
+
+std::size_t frame_dumper::get_written() const
+{
+    return m_written;
+}
+
+void frame_dumper::worker()
+{
+    std::vector<encoded_file> batch;
+    std::size_t batch_bytes = 0;
+
+    while(true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // the queue has run dry, write what's been encoded before sleeping
+        if(m_jobs.empty() && !batch.empty())
+        {
+            lock.unlock();
+            write_batch(batch);
+            batch_bytes = 0;
+            continue;
+        }
+
+        m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+        if(m_jobs.empty()) { return; }
+
+        dump_job job = std::move(m_jobs.front());
+        m_jobs.pop();
+        lock.unlock();
+
+        encoded_file file { std::move(job.m_path), {} };
+
+        try
+        {
+            encode_image(job.m_frame, job.m_mode, m_format, file.m_data);
+        }
+        catch(const std::exception &)
+        {
+            // an empty file marks the failure, write_batch counts it
+            file.m_data.clear();
+        }
+
+        batch_bytes += file.m_data.size();
+        batch.push_back(std::move(file));
+
+        if(batch_bytes >= batch_limit)
+        {
+            write_batch(batch);
+            batch_bytes = 0;
+        }
+    }
+}
+
+void frame_dumper::write_batch(std::vector<encoded_file> &batch)
+{
+    for(const encoded_file &file : batch)
+    {
+        bool ok = !file.m_data.empty();
+
+        const int fd = ok ? ::open(file.m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+        ok = ok && fd >= 0;
+
+        for(std::size_t offset = 0; ok && offset < file.m_data.size();)
+        {
+            const ssize_t wrote = ::write(fd, file.m_data.data() + offset, file.m_data.size() - offset);
+            ok = wrote > 0;
+            offset += ok ? wrote : 0;
+        }
+
+        if(fd >= 0) { ::close(fd); }
+
+        if(ok)  { m_written++; }
+        else    { m_failed++; }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_in_flight -= batch.size();
+        m_unsynced += batch.size();
+    }
+
+    m_done.notify_all();
+    batch.clear();
+}
+
+}
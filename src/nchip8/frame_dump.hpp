@@ -0,0 +1,120 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_FRAME_DUMP_HPP
+#define NCHIP8_FRAME_DUMP_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu.hpp"
+#include "framebuffer.hpp"
+
+namespace nchip8
+{
+
+//! @brief Image formats a framebuffer can be dumped as, lit pixels are white in both
+enum class image_format : std::uint8_t
+{
+    pbm,        //! Binary PBM (P4)
+    png         //! 1-bit greyscale PNG, only if built with libpng
+};
+
+//! @brief Returns true if the format can be written by this build
+bool is_image_format_available(const image_format &format);
+
+//! @brief File extension for a format, without the dot
+const char* get_image_extension(const image_format &format);
+
+//! @brief      Encodes the visible part of a framebuffer as an image
+//! @param out  Replaced with the file contents
+//! @throws     std::runtime_error if the format isn't available or encoding fails
+void encode_image(const packed_framebuffer &frame, const screen_mode &mode, const image_format &format,
+                  std::vector<std::uint8_t> &out);
+
+//! @brief      Writes framebuffers to image files from a pool of worker threads
+//! @details    submit() only queues a copy of the frame, encoding and writing happen on the workers,
+//!             so emulation threads never wait on either. Each worker writes its files in batches,
+//!             and nothing is synced until finish(), which syncs the whole output once.
+class frame_dumper
+{
+public:
+    //! @param directory    Where images are written, must exist
+    //! @param jobs         Worker threads, 0 = one per core
+    //! @throws             std::invalid_argument if the format isn't available
+    frame_dumper(const std::string &directory, const image_format &format, std::size_t jobs);
+
+    //! @brief Writes anything still queued, syncs, and stops the workers
+    virtual ~frame_dumper();
+
+    //! @brief      Queues a frame to be written as <directory>/<name>.<extension>
+    //! @details    Thread safe
+    void submit(const std::string &name, const packed_framebuffer &frame, const screen_mode &mode);
+
+    //! @brief      Blocks until every submitted frame is written, then syncs them to disk (if anything was written)
+    //! @returns    The number of files that failed to encode or write so far
+    std::size_t finish();
+
+    //! @brief Returns the number of files written so far
+    std::size_t get_written() const;
+
+private:
+    //! @brief A frame waiting to be encoded
+    struct dump_job
+    {
+        std::string m_path;
+        packed_framebuffer m_frame;
+        screen_mode m_mode;
+    };
+
+    //! @brief An encoded image waiting to be written
+    struct encoded_file
+    {
+        std::string m_path;
+        std::vector<std::uint8_t> m_data;
+    };
+
+    std::string m_directory;
+    image_format m_format;
+
+    //! Guards the queue, m_in_flight and m_stop
+    std::mutex m_mutex;
+
+    //! Workers wait on this for jobs
+    std::condition_variable m_wake;
+
+    //! finish() waits on this for m_in_flight to reach 0
+    std::condition_variable m_done;
+
+    std::queue<dump_job> m_jobs;
+
+    //! Submitted but not yet on disk
+    std::size_t m_in_flight = 0;
+
+    //! Files written since the last sync
+    std::size_t m_unsynced = 0;
+
+    bool m_stop = false;
+
+    std::atomic<std::size_t> m_written;
+    std::atomic<std::size_t> m_failed;
+
+    std::vector<std::thread> m_workers;
+
+    //! @brief Encodes jobs, writing them out when the batch is big enough or the queue runs dry
+    void worker();
+
+    //! @brief Writes and clears a batch
+    void write_batch(std::vector<encoded_file> &batch);
+};
+
+}
+
+#endif //NCHIP8_FRAME_DUMP_HPP
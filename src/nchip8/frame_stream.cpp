@@ -0,0 +1,255 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "frame_stream.hpp"
+#include "io.hpp"
+#include "lz4_block.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace nchip8
+{
+
+static void write_header(const frame_header &header, std::vector<std::uint8_t> &out)
+{
+    out.push_back(header.m_version);
+    out.push_back(header.m_flags);
+    out.push_back(header.m_width);
+    out.push_back(header.m_height);
+
+    for(unsigned shift = 0; shift < 32; shift += 8)
+    {
+        out.push_back((header.m_sequence >> shift) & 0xFF);
+    }
+}
+
+static frame_header read_header(const std::uint8_t *message)
+{
+    frame_header header;
+    header.m_version = message[0];
+    header.m_flags = message[1];
+    header.m_width = message[2];
+    header.m_height = message[3];
+    header.m_sequence = message[4] | (message[5] << 8) | (message[6] << 16) | (std::uint32_t(message[7]) << 24);
+
+    return header;
+}
+
+void frame_encoder::encode(const packed_framebuffer &frame, const screen_mode &mode, const bool &keyframe,
+                           std::vector<std::uint8_t> &out)
+{
+    frame_header header;
+    header.m_flags = keyframe ? frame_header::keyframe : 0;
+    header.m_width = (mode == screen_mode::hires_sc8) ? 128 : 64;
+    header.m_height = (mode == screen_mode::hires_sc8) ? 64 : 32;
+    header.m_sequence = m_sequence++;
+
+    packed_framebuffer delta;
+    for(std::size_t i = 0; i < frame.size(); i++)
+    {
+        delta[i] = keyframe ? frame[i] : (frame[i] ^ m_previous[i]);
+    }
+
+    m_previous = frame;
+
+    out.clear();
+    write_header(header, out);
+    lz4_compress(delta.data(), delta.size(), out);
+}
+
+std::uint32_t frame_encoder::get_sequence() const
+{
+    return m_sequence;
+}
+
+bool frame_decoder::decode(const std::uint8_t *message, const std::size_t &size)
+{
+    if(size < frame_header::size) { return false; }
+
+    const frame_header header = read_header(message);
+    if(header.m_version != frame_header::current_version) { return false; }
+
+    // readers index the frame by these, anything else would run off the end of it
+    const bool lores = (header.m_width == 64 && header.m_height == 32);
+    const bool hires = (header.m_width == 128 && header.m_height == 64);
+    if(!lores && !hires) { return false; }
+
+    const bool keyframe = (header.m_flags & frame_header::keyframe);
+
+    // a delta only makes sense on top of the frame before it
+    if(!keyframe && (!m_synced || header.m_sequence != m_header.m_sequence + 1)) { return false; }
+
+    packed_framebuffer delta;
+    if(!lz4_decompress(message + frame_header::size, size - frame_header::size, delta.data(), delta.size()))
+    {
+        return false;
+    }
+
+    for(std::size_t i = 0; i < m_frame.size(); i++)
+    {
+        m_frame[i] = keyframe ? delta[i] : (m_frame[i] ^ delta[i]);
+    }
+
+    m_header = header;
+    m_synced = true;
+    return true;
+}
+
+const packed_framebuffer& frame_decoder::get_frame() const
+{
+    return m_frame;
+}
+
+const frame_header& frame_decoder::get_header() const
+{
+    return m_header;
+}
+
+frame_server::frame_server(std::shared_ptr<cpu_daemon> &cpu, const std::string &path) :
+    m_cpu_daemon(cpu),
+    m_path(path)
+{
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+
+    if(path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("frame stream socket path is too long");
+    }
+
+    std::strcpy(address.sun_path, path.c_str());
+
+    m_listen_fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(m_listen_fd < 0) { throw std::runtime_error("could not create the frame stream socket"); }
+
+    ::unlink(path.c_str());
+
+    if(::bind(m_listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+       ::listen(m_listen_fd, 8) != 0 ||
+       ::pipe(m_wake_pipe) != 0)
+    {
+        ::close(m_listen_fd);
+        throw std::runtime_error("could not listen on " + path);
+    }
+
+    nchip8::log << "[stream] serving frames on " << path << '\n';
+
+    m_server_thread = std::thread(&frame_server::server_thread, this);
+}
+
+frame_server::~frame_server()
+{
+    const char wake = 0;
+    ::write(m_wake_pipe[1], &wake, 1);
+    m_server_thread.join();
+
+    for(const viewer &v : m_viewers) { ::close(v.m_fd); }
+
+    ::close(m_listen_fd);
+    ::close(m_wake_pipe[0]);
+    ::close(m_wake_pipe[1]);
+    ::unlink(m_path.c_str());
+}
+
+void frame_server::server_thread()
+{
+    using clock = std::chrono::steady_clock;
+
+    auto next_frame = clock::now();
+    packed_framebuffer last_sent {};
+
+    while(true)
+    {
+        pollfd fds[2] = {
+            { m_listen_fd, POLLIN, 0 },
+            { m_wake_pipe[0], POLLIN, 0 }
+        };
+
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - clock::now()).count();
+
+        if(::poll(fds, 2, std::max<int>(wait, 0)) < 0 && errno != EINTR) { return; }
+
+        if(fds[1].revents != 0) { return; }
+
+        if(fds[0].revents & POLLIN)
+        {
+            for(int fd = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC); fd >= 0;
+                fd = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC))
+            {
+                m_viewers.push_back(viewer { fd });
+            }
+        }
+
+        if(clock::now() >= next_frame)
+        {
+            next_frame += std::chrono::microseconds(1000000 / 60);
+
+            // don't try to catch up after a stall
+            if(next_frame < clock::now()) { next_frame = clock::now(); }
+
+            broadcast(last_sent);
+        }
+    }
+}
+
+void frame_server::broadcast(packed_framebuffer &last_sent)
+{
+    if(m_viewers.empty()) { return; }
+
+    packed_framebuffer frame;
+    pack_framebuffer(m_cpu_daemon->get_screen_framebuffer(), frame);
+
+    const bool changed = (frame != last_sent);
+    const bool any_keyframe = std::any_of(m_viewers.begin(), m_viewers.end(),
+        [](const viewer &v) { return v.m_needs_keyframe; });
+
+    if(!changed && !any_keyframe) { return; }
+
+    const screen_mode mode = m_cpu_daemon->get_screen_mode();
+
+    // viewers in sync get a delta, the rest a keyframe with the same sequence number
+    std::vector<std::uint8_t> delta, keyframe;
+    frame_encoder keyframe_encoder = m_encoder;
+
+    m_encoder.encode(frame, mode, false, delta);
+    if(any_keyframe) { keyframe_encoder.encode(frame, mode, true, keyframe); }
+
+    last_sent = frame;
+
+    for(auto it = m_viewers.begin(); it != m_viewers.end();)
+    {
+        const std::vector<std::uint8_t> &message = it->m_needs_keyframe ? keyframe : delta;
+
+        if(::send(it->m_fd, message.data(), message.size(), MSG_DONTWAIT | MSG_NOSIGNAL) >= 0)
+        {
+            it->m_needs_keyframe = false;
+        }
+        else if(errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            // no room, this frame is lost so the next one has to stand alone
+            it->m_needs_keyframe = true;
+        }
+        else
+        {
+            // gone
+            ::close(it->m_fd);
+            it = m_viewers.erase(it);
+            continue;
+        }
+
+        it++;
+    }
+}
+
+}
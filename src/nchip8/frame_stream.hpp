@@ -0,0 +1,134 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_FRAME_STREAM_HPP
+#define NCHIP8_FRAME_STREAM_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu_daemon.hpp"
+#include "framebuffer.hpp"
+
+namespace nchip8
+{
+
+//! @brief      Header of a frame message, followed by an LZ4 block of the 1 KiB packed framebuffer
+//! @details    8 bytes on the wire, multi-byte fields little endian.
+//!             A keyframe carries the framebuffer itself, every other frame carries it XORed with the
+//!             previous frame in the stream, which is almost all zeros and compresses to a few bytes.
+struct frame_header
+{
+    static constexpr std::uint8_t current_version = 1;
+    static constexpr std::size_t size = 8;
+
+    //! m_flags bits
+    static constexpr std::uint8_t keyframe = 1;
+
+    std::uint8_t m_version = current_version;
+    std::uint8_t m_flags = 0;
+
+    //! Screen size in pixels, 64x32 or 128x64
+    std::uint8_t m_width = 0;
+    std::uint8_t m_height = 0;
+
+    //! Frames sent so far, deltas apply to the frame numbered one less
+    std::uint32_t m_sequence = 0;
+};
+
+//! @brief Encodes framebuffers into frame messages
+class frame_encoder
+{
+public:
+    //! @brief          Encodes a frame against the previous one passed in
+    //! @param keyframe Encode against nothing, so a viewer can start from this frame
+    //! @param out      Replaced with the message
+    void encode(const packed_framebuffer &frame, const screen_mode &mode, const bool &keyframe,
+                std::vector<std::uint8_t> &out);
+
+    //! @brief Returns the sequence number the next frame will get
+    std::uint32_t get_sequence() const;
+
+private:
+    packed_framebuffer m_previous {};
+    std::uint32_t m_sequence = 0;
+};
+
+//! @brief Rebuilds framebuffers from frame messages
+class frame_decoder
+{
+public:
+    //! @brief      Applies a message
+    //! @returns    False if it is malformed, isn't 64x32 or 128x64 (the only sizes a packed_framebuffer holds),
+    //!             or is a delta that doesn't follow the last frame decoded (nothing changes, wait for the next keyframe)
+    bool decode(const std::uint8_t *message, const std::size_t &size);
+
+    //! @brief Returns the last frame decoded
+    const packed_framebuffer& get_frame() const;
+
+    //! @brief Returns the header of the last frame decoded
+    const frame_header& get_header() const;
+
+private:
+    packed_framebuffer m_frame {};
+    frame_header m_header;
+
+    //! False until the first keyframe
+    bool m_synced = false;
+};
+
+//! @brief      Serves the screen of a cpu_daemon to viewers on a unix socket
+//! @details    SOCK_SEQPACKET, one message per frame, sent at 60Hz when the screen has changed.
+//!             A viewer whose socket is full misses frames and is sent a keyframe once it has room again,
+//!             so a slow viewer never holds up the others. See tools/view.cpp for a client.
+class frame_server
+{
+public:
+    //! @param cpu  The screen to serve
+    //! @param path Where to create the socket, an existing socket there is replaced
+    //! @throws     std::runtime_error if the socket can't be created
+    frame_server(std::shared_ptr<cpu_daemon> &cpu, const std::string &path);
+
+    //! @brief Stops serving and removes the socket
+    virtual ~frame_server();
+
+private:
+    //! @brief A connected viewer
+    struct viewer
+    {
+        int m_fd;
+
+        //! Set on connect and after a dropped frame
+        bool m_needs_keyframe = true;
+    };
+
+    std::shared_ptr<cpu_daemon> m_cpu_daemon;
+
+    std::string m_path;
+
+    int m_listen_fd = -1;
+
+    //! Written to by the destructor to wake the server thread, [0] is the read end
+    int m_wake_pipe[2] = { -1, -1 };
+
+    std::vector<viewer> m_viewers;
+
+    frame_encoder m_encoder;
+
+    //! Thread object for void server_thread()
+    std::thread m_server_thread;
+
+    //! @brief Accepts viewers and sends frames until the destructor wakes it
+    void server_thread();
+
+    //! @brief Sends the current screen to every viewer if it has changed or someone needs a keyframe
+    void broadcast(packed_framebuffer &last_sent);
+};
+
+}
+
+#endif //NCHIP8_FRAME_STREAM_HPP
@@ -0,0 +1,30 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "framebuffer.hpp"
+
+#include <cstring>
+
+namespace nchip8
+{
+
+void pack_framebuffer(const std::array<bool, 128*64> &screen, packed_framebuffer &packed)
+{
+    static_assert(sizeof(bool) == 1, "pixels are packed eight bools to a word");
+
+    for(std::size_t byte = 0; byte < packed.size(); byte++)
+    {
+        // eight pixels as one little endian word of 0/1 bytes, the multiply moves pixel n to
+        // bit 63 - n with nothing carrying into the top byte
+        std::uint64_t pixels;
+        std::memcpy(&pixels, screen.data() + byte * 8, sizeof(pixels));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        pixels = __builtin_bswap64(pixels);
+#endif
+
+        packed[byte] = (pixels * 0x8040201008040201ull) >> 56;
+    }
+}
+
+}
@@ -0,0 +1,26 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_FRAMEBUFFER_HPP
+#define NCHIP8_FRAMEBUFFER_HPP
+
+#include <array>
+#include <cstdint>
+
+namespace nchip8
+{
+
+//! @brief      The screen at one bit per pixel, 1 KiB
+//! @details    Same order as cpu::get_screen_framebuffer, most significant bit first:
+//!             rows of 128 pixels in hires, rows of 64 in lores (only the first 256 bytes are used)
+using packed_framebuffer = std::array<std::uint8_t, 128*64 / 8>;
+
+//! @brief          Packs a framebuffer down to one bit per pixel
+//! @param screen   e.g. cpu::get_screen_framebuffer()
+//! @param packed   Where to write the packed pixels
+void pack_framebuffer(const std::array<bool, 128*64> &screen, packed_framebuffer &packed);
+
+}
+
+#endif //NCHIP8_FRAMEBUFFER_HPP
@@ -0,0 +1,497 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "fuzzer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <sstream>
+#include <thread>
+
+namespace nchip8
+{
+
+const char* to_string(const fuzz_outcome &outcome)
+{
+    switch(outcome)
+    {
+        case fuzz_outcome::completed:               return "completed";
+        case fuzz_outcome::halted:                  return "halted";
+        case fuzz_outcome::stalled:                 return "stalled";
+        case fuzz_outcome::hung:                    return "hung";
+        case fuzz_outcome::trapped:                 return "trapped";
+    }
+
+    return "unknown";
+}
+
+const char* to_string(const fuzz_finding &finding)
+{
+    return (finding.m_outcome == fuzz_outcome::trapped) ? to_string(finding.m_trap) : to_string(finding.m_outcome);
+}
+
+coverage_engine::coverage_engine(cpu &target, coverage_map &map, const std::uint32_t &cycles_per_tick,
+                                 const std::size_t &hang_cycles) :
+    m_cpu(target),
+    m_map(map),
+    m_cycles_per_tick(std::max<std::uint32_t>(cycles_per_tick, 1)),
+    m_hang_cycles(hang_cycles)
+{
+
+}
+
+void coverage_engine::set_keys(const std::uint16_t &keys)
+{
+    m_cpu.set_keys_mask(keys);
+}
+
+std::uint16_t coverage_engine::get_keys() const
+{
+    return m_cpu.get_keys_mask();
+}
+
+void coverage_engine::restore_keys(const std::uint16_t &keys, const std::uint8_t &latched)
+{
+    m_cpu.restore_keys(keys, latched);
+}
+
+std::uint8_t coverage_engine::get_latched_key() const
+{
+    return m_cpu.get_latched_key();
+}
+
+std::uint16_t coverage_engine::get_last_pc() const
+{
+    return m_cpu.m_pc;
+}
+
+std::uint16_t coverage_engine::get_loop_pc() const
+{
+    return m_loop_pc;
+}
+
+fuzz_outcome coverage_engine::run(const std::vector<fuzz_input_event> &events)
+{
+    cpu& c = m_cpu;
+
+    if(c.m_trap != trap::none) { return fuzz_outcome::trapped; }
+
+    c.set_cycles_per_tick(m_cycles_per_tick);
+
+    // instructions since the last edge this map hadn't seen
+    std::size_t quiet = 0;
+    m_loop_pc = 0xFFFF;
+
+    for(const fuzz_input_event &event : events)
+    {
+        set_keys(event.m_keys);
+
+        for(std::size_t cycle = 0; cycle < event.m_cycles; cycle++)
+        {
+            // timers, in instructions rather than wall time
+            c.count_cycle();
+
+            if(c.m_pc > 0xFFE)
+            {
+                c.m_trap = trap::pc_out_of_range;
+                return fuzz_outcome::trapped;
+            }
+
+            const std::uint16_t instruction = c.read_u16(c.m_pc);
+            const cpu::op_handler* handler = cpu::get_op_handler_for_instruction(instruction);
+
+            if(handler == nullptr)
+            {
+                c.m_trap = trap::illegal_opcode;
+                return fuzz_outcome::trapped;
+            }
+
+            const cpu::operand_data operands = c.get_operand_data_from_instruction(instruction);
+
+            // LD Vx, K would spin forever, spend the cycle waiting instead
+            if(handler == &cpu::LD_VX_K && !c.has_key_latched()) { continue; }
+
+            // (previous PC, PC) edge
+            const std::uint32_t edge = ((m_prev_pc * 40503u) ^ c.m_pc) & 0xFFFF;
+            const std::uint64_t bit = std::uint64_t(1) << (edge & 63);
+            m_prev_pc = c.m_pc;
+
+            if(m_map[edge >> 6] & bit)
+            {
+                // looping over old edges, the lowest PC is the loop's head whichever point it's caught at
+                m_loop_pc = std::min(m_loop_pc, c.m_pc);
+
+                if(m_hang_cycles > 0 && ++quiet >= m_hang_cycles) { return fuzz_outcome::hung; }
+            }
+            else
+            {
+                m_map[edge >> 6] |= bit;
+                quiet = 0;
+                m_loop_pc = 0xFFFF;
+            }
+
+            const std::uint16_t saved_pc = c.m_pc;
+            handler->m_execute_op(c, operands);
+
+            if(c.m_trap != trap::none) { return fuzz_outcome::trapped; }
+
+            if(c.m_pc == saved_pc)
+            {
+                // jump to itself, nothing else can happen
+                if(handler == &cpu::JP) { return fuzz_outcome::halted; }
+
+                c.m_pc += 2;
+            }
+        }
+    }
+
+    // out of input, was the program left waiting on a key?
+    if(c.m_pc <= 0xFFE)
+    {
+        const cpu::op_handler* handler = cpu::get_op_handler_for_instruction(c.read_u16(c.m_pc));
+        if(handler == &cpu::LD_VX_K && !c.has_key_latched()) { return fuzz_outcome::stalled; }
+    }
+
+    return fuzz_outcome::completed;
+}
+
+//! @brief Small, fast generator for the mutators, one per worker
+class fuzz_random
+{
+public:
+    explicit fuzz_random(const std::uint64_t &seed) : m_state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+
+    std::uint64_t next()
+    {
+        // xorshift64
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        return m_state;
+    }
+
+    //! @brief Returns a value in [0, bound)
+    std::size_t below(const std::size_t &bound)
+    {
+        return bound ? next() % bound : 0;
+    }
+
+private:
+    std::uint64_t m_state;
+};
+
+static fuzz_input_event random_event(fuzz_random &random)
+{
+    fuzz_input_event event {};
+
+    // mostly single keys or nothing, games rarely want chords
+    switch(random.below(4))
+    {
+        case 0:  event.m_keys = 0; break;
+        case 1:
+        case 2:  event.m_keys = 1 << random.below(16); break;
+        default: event.m_keys = random.next() & 0xFFFF; break;
+    }
+
+    event.m_cycles = 1 + random.below(600);
+    return event;
+}
+
+static void mutate_events(std::vector<fuzz_input_event> &events, fuzz_random &random, const std::size_t &max_cycles)
+{
+    const std::size_t mutations = 1 + random.below(4);
+
+    for(std::size_t i = 0; i < mutations; i++)
+    {
+        switch(events.empty() ? 0 : random.below(5))
+        {
+            case 0: // insert
+                events.insert(events.begin() + random.below(events.size() + 1), random_event(random));
+                break;
+
+            case 1: // delete
+                events.erase(events.begin() + random.below(events.size()));
+                break;
+
+            case 2: // flip a key
+                events[random.below(events.size())].m_keys ^= 1 << random.below(16);
+                break;
+
+            case 3: // change a duration
+                events[random.below(events.size())].m_cycles = 1 + random.below(600);
+                break;
+
+            default: // replace
+                events[random.below(events.size())] = random_event(random);
+                break;
+        }
+    }
+
+    // keep each execution inside its budget
+    std::size_t total = 0;
+    for(std::size_t i = 0; i < events.size(); i++)
+    {
+        total += events[i].m_cycles;
+
+        if(total > max_cycles)
+        {
+            events.resize(i);
+            break;
+        }
+    }
+}
+
+//! @brief Returns the PC that identifies a finding, so one bug is reported once
+static std::uint16_t get_finding_pc(const fuzz_outcome &outcome, const coverage_engine &engine)
+{
+    return (outcome == fuzz_outcome::hung) ? engine.get_loop_pc() : engine.get_last_pc();
+}
+
+//! @brief      Input that presses every key in turn for hang_cycles instructions in total
+//! @details    A run that gets through all of it without a new edge ignores the whole keypad
+static std::vector<fuzz_input_event> make_hang_probe(const std::size_t &hang_cycles)
+{
+    const std::uint16_t hold = std::min<std::size_t>(hang_cycles / 16 + 1, 0xFFFF);
+
+    std::vector<fuzz_input_event> probe;
+    for(std::uint16_t key = 0; key < 16; key++)
+    {
+        probe.push_back({ std::uint16_t(1 << key), hold });
+    }
+
+    return probe;
+}
+
+fuzzer::fuzzer(const std::vector<std::uint8_t> &rom, const fuzzer_options &options) :
+    m_options(options),
+    m_rom_size(rom.size()),
+    m_coverage{},
+    m_executions(0)
+{
+    auto image = cpu::make_power_on_state(rom, 0x200);
+
+    if(!image.has_value())
+    {
+        throw std::invalid_argument("ROM does not fit in memory");
+    }
+
+    m_power_on = image.value();
+    cpu::seed_rng(m_power_on, options.m_seed);
+
+    // start from power-on with an empty input
+    m_corpus.push_back(corpus_entry {
+        std::make_shared<const machine_state>(m_power_on), 0, cpu::no_key, {}, {}, {}
+    });
+}
+
+void fuzzer::run()
+{
+    std::size_t jobs = m_options.m_jobs;
+    if(jobs == 0) { jobs = std::max(1u, std::thread::hardware_concurrency()); }
+
+    std::vector<std::thread> workers;
+    for(std::size_t id = 0; id < jobs; id++)
+    {
+        workers.emplace_back(&fuzzer::worker, this, id);
+    }
+
+    for(std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void fuzzer::worker(const std::size_t &id)
+{
+    fuzz_random random((std::uint64_t(m_options.m_seed) << 32) | (id + 1));
+
+    cpu target;
+    coverage_map local {};
+
+    while(m_executions.fetch_add(1) < m_options.m_iterations)
+    {
+        corpus_entry entry;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            entry = m_corpus[random.below(m_corpus.size())];
+        }
+
+        std::vector<fuzz_input_event> tail = entry.m_tail;
+        mutate_events(tail, random, m_options.m_max_cycles);
+
+        bool patched = false;
+        if(m_options.m_mutate_rom && m_rom_size > 0 && random.below(4) == 0)
+        {
+            entry.m_patches.emplace_back(0x200 + random.below(m_rom_size), random.next() & 0xFF);
+            patched = true;
+        }
+
+        // a new ROM patch has to apply from power-on
+        if(patched)
+        {
+            auto image = std::make_shared<machine_state>(m_power_on);
+            for(const auto &[address, value] : entry.m_patches) { image->m_ram[address] = value; }
+
+            entry.m_snapshot = std::move(image);
+            entry.m_keys = 0;
+            entry.m_latched_key = cpu::no_key;
+            entry.m_prefix.clear();
+        }
+
+        // restore the snapshot, and the keypad exactly, re-pressing the keys would latch one the replay might not
+        target.reset(*entry.m_snapshot);
+
+        local.fill(0);
+        coverage_engine engine(target, local, m_options.m_cycles_per_tick, m_options.m_hang_cycles);
+        engine.restore_keys(entry.m_keys, entry.m_latched_key);
+
+        const fuzz_outcome outcome = engine.run(tail);
+
+        // crashes, and runs that stopped making progress
+        if(outcome != fuzz_outcome::completed)
+        {
+            fuzz_finding finding {
+                outcome, target.get_trap(), get_finding_pc(outcome, engine), entry.m_prefix, entry.m_patches
+            };
+
+            finding.m_events.insert(finding.m_events.end(), tail.begin(), tail.end());
+            add_finding(std::move(finding));
+        }
+
+        if(merge_coverage(local))
+        {
+            // keep the input, and a deeper entry that starts where this one ended
+            auto snapshot = std::make_shared<machine_state>();
+            target.save_state(*snapshot);
+
+            corpus_entry deeper;
+            deeper.m_snapshot = std::move(snapshot);
+            deeper.m_keys = engine.get_keys();
+            deeper.m_latched_key = engine.get_latched_key();
+            deeper.m_prefix = entry.m_prefix;
+            deeper.m_prefix.insert(deeper.m_prefix.end(), tail.begin(), tail.end());
+            deeper.m_patches = entry.m_patches;
+
+            // somewhere new, entering an endless loop looks like this too: see if any key gets the program out
+            if(outcome == fuzz_outcome::completed && m_options.m_hang_cycles > 0)
+            {
+                const std::vector<fuzz_input_event> probe = make_hang_probe(m_options.m_hang_cycles);
+
+                if(engine.run(probe) == fuzz_outcome::hung)
+                {
+                    fuzz_finding finding {
+                        fuzz_outcome::hung, trap::none, engine.get_loop_pc(), deeper.m_prefix, entry.m_patches
+                    };
+
+                    finding.m_events.insert(finding.m_events.end(), probe.begin(), probe.end());
+                    add_finding(std::move(finding));
+                }
+            }
+
+            entry.m_tail = std::move(tail);
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_corpus.push_back(std::move(entry));
+
+            if(outcome != fuzz_outcome::trapped && outcome != fuzz_outcome::halted)
+            {
+                m_corpus.push_back(std::move(deeper));
+            }
+        }
+    }
+}
+
+bool fuzzer::merge_coverage(const coverage_map &local)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    bool found_new = false;
+    for(std::size_t i = 0; i < m_coverage.size(); i++)
+    {
+        if(local[i] & ~m_coverage[i])
+        {
+            found_new = true;
+            m_coverage[i] |= local[i];
+        }
+    }
+
+    return found_new;
+}
+
+void fuzzer::add_finding(fuzz_finding finding)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for(const fuzz_finding &existing : m_findings)
+    {
+        if(existing.m_outcome == finding.m_outcome && existing.m_trap == finding.m_trap
+           && existing.m_pc == finding.m_pc)
+        {
+            return;
+        }
+    }
+
+    m_findings.push_back(std::move(finding));
+    write_finding(m_findings.back(), m_findings.size() - 1);
+}
+
+void fuzzer::write_finding(const fuzz_finding &finding, const std::size_t &index) const
+{
+    if(m_options.m_output_dir.empty()) { return; }
+
+    std::stringstream name;
+    name << m_options.m_output_dir << '/' << std::dec << index << '-' << to_string(finding)
+         << "-pc" << std::hex << finding.m_pc << ".txt";
+
+    std::ofstream out(name.str());
+
+    // one line per event: keys (hex mask) then instructions held, patches as: patch address value
+    out << "# " << to_string(finding) << " at " << std::hex << std::showbase << finding.m_pc << '\n';
+    out << "# seed " << std::dec << m_options.m_seed << ", " << m_options.m_cycles_per_tick << " cycles per tick\n";
+
+    for(const auto &[address, value] : finding.m_patches)
+    {
+        out << "patch " << std::hex << address << ' ' << std::uint16_t(value) << '\n';
+    }
+
+    for(const fuzz_input_event &event : finding.m_events)
+    {
+        out << std::hex << std::noshowbase << std::setw(4) << std::setfill('0') << event.m_keys
+            << ' ' << std::dec << event.m_cycles << '\n';
+    }
+}
+
+std::size_t fuzzer::get_executions() const
+{
+    return std::min(m_executions.load(), m_options.m_iterations);
+}
+
+std::size_t fuzzer::get_edges() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    std::size_t edges = 0;
+    for(const std::uint64_t &word : m_coverage)
+    {
+        edges += __builtin_popcountll(word);
+    }
+
+    return edges;
+}
+
+std::size_t fuzzer::get_corpus_size() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_corpus.size();
+}
+
+std::vector<fuzz_finding> fuzzer::get_findings() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_findings;
+}
+
+}
@@ -0,0 +1,229 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_FUZZER_HPP
+#define NCHIP8_FUZZER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpu.hpp"
+
+namespace nchip8
+{
+
+//! @brief One step of fuzzer input, a set of keys held down for a number of instructions
+struct fuzz_input_event
+{
+    //! Bit n set = key n down
+    std::uint16_t m_keys;
+
+    //! How many instructions the keys are held for
+    std::uint16_t m_cycles;
+};
+
+//! @brief Why an instrumented run ended
+enum class fuzz_outcome : std::uint8_t
+{
+    completed,              //! Ran out of input
+    halted,                 //! Jumped to itself, the usual CHIP-8 way of stopping
+    stalled,                //! Waiting on LD Vx, K with no input left
+    hung,                   //! Ran hang_cycles instructions without reaching an edge new to the run
+    trapped                 //! The cpu trapped, see cpu::get_trap
+};
+
+//! @brief Returns a printable name for an outcome
+const char* to_string(const fuzz_outcome &outcome);
+
+//! @brief Edge coverage, one bit per hashed (previous PC, PC) pair
+using coverage_map = std::array<std::uint64_t, (1 << 16) / 64>;
+
+//! @brief      The instrumented execution engine
+//! @details    A dedicated dispatch loop over the cpu's handlers that records edges into a coverage map
+//!             and never logs. Faults are the cpu's own traps, so a run stops exactly where
+//!             execute_op_at_pc would. Memory accesses wrap (see op_handlers.cpp), so only control flow can fault.
+//!             Timers tick every cycles_per_tick instructions so runs are fully deterministic.
+//!             A cycle spent waiting on LD Vx, K still counts, the timers keep running.
+class coverage_engine
+{
+public:
+    //! @param target           The cpu to drive
+    //! @param map              Where edges are recorded, not cleared by the engine
+    //! @param cycles_per_tick  Instructions per 60Hz timer tick
+    //! @param hang_cycles      Instructions without an edge new to the map before a run counts as hung, 0 = never
+    coverage_engine(cpu &target, coverage_map &map, const std::uint32_t &cycles_per_tick,
+                    const std::size_t &hang_cycles = 0);
+
+    //! @brief          Runs the cpu from its current state over the supplied input
+    //! @returns        Why the run ended
+    fuzz_outcome run(const std::vector<fuzz_input_event> &events);
+
+    //! @brief Sets the cpu keys from a mask
+    void set_keys(const std::uint16_t &keys);
+
+    //! @brief Returns the keys currently held, as a mask
+    std::uint16_t get_keys() const;
+
+    //! @see cpu::restore_keys
+    void restore_keys(const std::uint16_t &keys, const std::uint8_t &latched);
+
+    //! @see cpu::get_latched_key
+    std::uint8_t get_latched_key() const;
+
+    //! @brief Returns the PC of the instruction the last run ended on
+    std::uint16_t get_last_pc() const;
+
+    //! @brief Returns the lowest PC executed since the last new edge, for a hung run the head of its loop
+    std::uint16_t get_loop_pc() const;
+
+private:
+    cpu& m_cpu;
+    coverage_map& m_map;
+    std::uint32_t m_cycles_per_tick;
+    std::size_t m_hang_cycles;
+
+    //! Lowest PC since the last new edge
+    std::uint16_t m_loop_pc = 0xFFFF;
+
+    //! The PC executed before the current one, the other half of each edge
+    std::uint16_t m_prev_pc = 0;
+};
+
+//! @brief Options for a fuzzing session
+struct fuzzer_options
+{
+    //! Worker threads, 0 = one per core
+    std::size_t m_jobs = 0;
+
+    //! Total executions across all workers
+    std::size_t m_iterations = 100000;
+
+    //! Upper bound on instructions per execution
+    std::size_t m_max_cycles = 20000;
+
+    //! Instructions per 60Hz timer tick, 500Hz / 60
+    std::uint32_t m_cycles_per_tick = 8;
+
+    //! Instructions without a new edge before a run is reported as hung, 0 = don't report hangs
+    std::size_t m_hang_cycles = 10000;
+
+    //! Also mutate ROM bytes, not just key input
+    bool m_mutate_rom = false;
+
+    //! Seed for the mutators, runs with the same seed and one job are reproducible
+    std::uint32_t m_seed = 1;
+
+    //! Directory findings are written into, empty = don't write
+    std::string m_output_dir;
+};
+
+//! @brief A crash or hang found by the fuzzer
+struct fuzz_finding
+{
+    //! trapped, halted, stalled or hung
+    fuzz_outcome m_outcome;
+
+    //! trap::none unless m_outcome is trapped
+    trap m_trap;
+
+    //! PC the fault happened at, the halting JP, the LD Vx, K waited on, or the head of the hung loop
+    std::uint16_t m_pc;
+
+    //! Input from power-on that reproduces it
+    std::vector<fuzz_input_event> m_events;
+
+    //! ROM bytes changed from the original, (address, value)
+    std::vector<std::pair<std::uint16_t, std::uint8_t>> m_patches;
+};
+
+//! @brief Returns a printable name for a finding, the trap for a crash, otherwise the outcome
+const char* to_string(const fuzz_finding &finding);
+
+//! @brief      Coverage-guided fuzzer over key input (and optionally ROM bytes)
+//! @details    Inputs that reach new edges are kept in a corpus together with a snapshot of the machine
+//!             taken where their mutable tail starts, so each execution restores a snapshot
+//!             instead of replaying its whole prefix from reset.
+class fuzzer
+{
+public:
+    //! @param rom      The ROM to fuzz, loaded at 0x200
+    //! @param options  @see fuzzer_options
+    //! @throws std::invalid_argument if the ROM does not fit in memory
+    fuzzer(const std::vector<std::uint8_t> &rom, const fuzzer_options &options);
+
+    //! @brief Runs the session, blocking until m_iterations executions have completed
+    void run();
+
+    //! @brief Returns the number of executions so far
+    std::size_t get_executions() const;
+
+    //! @brief Returns the number of edges seen so far
+    std::size_t get_edges() const;
+
+    //! @brief Returns the number of corpus entries
+    std::size_t get_corpus_size() const;
+
+    //! @brief Returns the unique findings (by outcome, trap and PC)
+    std::vector<fuzz_finding> get_findings() const;
+
+private:
+    //! @brief A kept input
+    struct corpus_entry
+    {
+        //! State after m_prefix has run, shared between entries that branch off the same point
+        std::shared_ptr<const machine_state> m_snapshot;
+
+        //! Keys held at the snapshot, and the key latched, which a power-on replay of m_prefix would leave
+        std::uint16_t m_keys;
+        std::uint8_t m_latched_key;
+
+        //! Input already baked into the snapshot
+        std::vector<fuzz_input_event> m_prefix;
+
+        //! Input that runs from the snapshot, this is what gets mutated
+        std::vector<fuzz_input_event> m_tail;
+
+        //! ROM patches, applied at power-on
+        std::vector<std::pair<std::uint16_t, std::uint8_t>> m_patches;
+    };
+
+    fuzzer_options m_options;
+
+    //! Power-on image with the ROM loaded
+    machine_state m_power_on;
+
+    //! Size of the ROM, ROM mutations stay inside it
+    std::size_t m_rom_size;
+
+    //! Guards everything below
+    mutable std::mutex m_mutex;
+
+    coverage_map m_coverage;
+    std::vector<corpus_entry> m_corpus;
+    std::vector<fuzz_finding> m_findings;
+
+    std::atomic<std::size_t> m_executions;
+
+    //! @brief Worker thread body
+    void worker(const std::size_t &id);
+
+    //! @brief Merges a run's coverage, returns true if it found new edges
+    bool merge_coverage(const coverage_map &local);
+
+    //! @brief Records a finding if its (outcome, trap, PC) is new, writing it to the output directory
+    void add_finding(fuzz_finding finding);
+
+    //! @brief Writes a finding to m_output_dir
+    void write_finding(const fuzz_finding &finding, const std::size_t &index) const;
+};
+
+}
+
+#endif //NCHIP8_FUZZER_HPP
@@ -14,15 +14,19 @@
 #include <thread>
 #include <chrono>
 #include <algorithm>
-#include <unordered_map>
+
+#include <unistd.h>
 
 namespace nchip8
 {
 
-gui::gui(std::shared_ptr<cpu_daemon>& cpu) :
-    m_cpu_daemon(cpu)
+gui::gui(std::shared_ptr<cpu_daemon>& cpu, const std::size_t &max_output_rate) :
+    m_cpu_daemon(cpu),
+    m_output(std::make_unique<output_throttle>(STDOUT_FILENO, max_output_rate))
 {
     this->rebuild_windows();
+
+    m_input = std::make_unique<key_input>(m_cpu_daemon, STDIN_FILENO);
 }
 
 gui::~gui()
@@ -91,6 +95,17 @@ void gui::rebuild_windows()
     wattron(m_reg_window.get(), A_BOLD);
     wattron(m_reg_window.get(), COLOR_PAIR(0));
 
+    // 30 x 28 beside the registers, newwin gives nothing if the terminal is too narrow
+    m_mem_window = std::shared_ptr<::WINDOW>(::newwin(28, 30, 0, 80), ::wdelch);
+    if(m_mem_window)
+    {
+        wattron(m_mem_window.get(), A_BOLD);
+        wattron(m_mem_window.get(), COLOR_PAIR(0));
+    }
+
+    // the new window is blank, every row needs drawing
+    m_mem_rows.fill(no_row);
+
 }
 
 void gui::update_windows_on_resize()
@@ -110,35 +125,28 @@ void gui::update_windows_on_resize()
     }
 }
 
-/**
- *
- * Typical CHIP-8 keypad was to look like this:
-    1	2   3	C
-    4	5	6	D
-    7	8	9	E
-    A	0	B	F
-
-    Let's do our best to map it to a modern keyboard
- */
-const std::unordered_map<int, std::uint8_t> gui::key_mapping = {
-    {'1',0x1}, {'2',0x2}, {'3',0x3}, {'4', 0xC},
-    {'q',0x4}, {'w',0x5}, {'e',0x6}, {'r', 0xD},
-    {'a',0x7}, {'s',0x8}, {'d',0x9}, {'f', 0xE},
-    {'z',0xA}, {'x',0x0}, {'c',0xB}, {'v', 0xF},
-};
-
 void gui::loop()
 {
     bool die = false;
 
     while (!die)
     {
-        // do gui tasks
-        update_keys();
+        // do gui tasks, keys are handled by m_input's thread
         update_windows_on_resize();
         update_log_on_global_log_change();
         update_screen_window();
         update_reg_window();
+        update_mem_window();
+
+        // everything above was only staged, write it out in one go unless the terminal is behind
+        if(m_output->begin_frame())
+        {
+            ::doupdate();
+            m_output->end_frame();
+        }
+
+        // Ctrl+C, when the terminal sends it as a key, the destructors put the terminal back
+        die = m_input->is_quit_requested();
 
         // gui aims to be at 60fps
         std::this_thread::sleep_for(std::chrono::milliseconds(1000/60));
@@ -154,7 +162,7 @@ void gui::update_log_on_global_log_change()
     {
         m_gui_log.push_back(line);
         log_updated = true;
-        line.empty();
+        line.clear();
     }
 
     nchip8::log.str(""); nchip8::log.clear();
@@ -191,7 +199,7 @@ void gui::update_log_window()
     }
 
     ::wborder(m_log_window.get(), 0, 0, 0, 0, 0, 0, 0, 0);
-    ::wrefresh(m_log_window.get());
+    ::wnoutrefresh(m_log_window.get());
 }
 
 // interpolates a screen string from the current frame to the previous one
@@ -291,7 +299,7 @@ void gui::update_screen_window()
 
     mvwaddwstr(m_screen_window.get(), 1, 1, this_scr.c_str());
     ::wborder(m_screen_window.get(), 0, 0, 0, 0, 0, 0, 0, 0);
-    ::wrefresh(m_screen_window.get());
+    ::wnoutrefresh(m_screen_window.get());
 
 }
 
@@ -329,48 +337,139 @@ void gui::update_reg_window()
     mvwaddstr(m_reg_window.get(), 23, 1, row.str().c_str());
     row.str(""); row.clear();
 
+    // frames not sent because the terminal was behind
+    row << "DRP " << std::dec << m_output->get_frames_dropped();
+    mvwaddstr(m_reg_window.get(), 25, 1, row.str().c_str());
+    row.str(""); row.clear();
+
     ::wborder(m_reg_window.get(), 0, 0, 0, 0, 0, 0, 0, 0);
-    ::wrefresh(m_reg_window.get());
+    ::wnoutrefresh(m_reg_window.get());
 }
 
-void gui::update_keys()
+//! Frames a written byte stays highlighted in the memory window
+static constexpr std::uint64_t mem_highlight_frames = 30;
+
+void gui::update_mem_window()
 {
-    // key chars are stored lowercase,
-    // tolower will pass thru non-characters as-well (e.g. 0->0)
-    int c = getch();
-    int char_lowered = std::tolower(c);
-
-    // if we didnt get a bad char and there is a valid mapping
-    // tell the cpu the key is down
-    if(c != ERR && key_mapping.count(char_lowered))
+    if(!m_cpu_daemon){ return; }
+
+    m_frame++;
+
+    const std::array<std::uint8_t, 0x1000> &ram = m_cpu_daemon->get_ram();
+
+    // compare only blocks written since the last frame, and the ones from the frame before that
+    // as a write can land after its block was taken
+    const std::uint64_t written = m_cpu_daemon->take_ram_written();
+    const std::uint64_t check = written | m_ram_written_before;
+    m_ram_written_before = written;
+
+    // until the pane has been drawn once, nothing counts as recently written
+    const std::uint64_t changed_on = (m_frame > 1) ? m_frame : 0;
+
+    for(std::size_t block = 0; block < 64; block++)
     {
-        // tell the cpu the key is down
-        m_cpu_daemon->set_key_down(key_mapping.at(char_lowered));
+        if(!(check & (std::uint64_t(1) << block))){ continue; }
+
+        for(std::size_t addr = block * 0x40; addr < (block + 1) * 0x40; addr++)
+        {
+            if(ram[addr] != m_ram_drawn[addr])
+            {
+                m_ram_drawn[addr] = ram[addr];
+                m_ram_changed[addr] = changed_on;
+            }
+        }
     }
 
-    // curses does not have a method of knowing if multiple keys are pressed
-    // we achieve multiple key inputs by giving each key a score
-    // every frame we decrement the score
-    // if the score is zero, the key is no longer considered pressed
-    m_keys[char_lowered] = 3;
+    if(!m_mem_window){ return; }
+
+    const std::uint16_t sp = m_cpu_daemon->get_sp();
+    const std::array<std::uint16_t, 16> stack = m_cpu_daemon->get_stack();
+
+    // the stack isn't in RAM here, so follow where the top return address points instead,
+    // CALL moves SP up before storing, so that is stack[sp] and sp = 0 means nothing has been called
+    struct section { const char* m_name; std::uint16_t m_addr; bool m_shown; };
+    const section sections[3] = {
+        { "PC",  static_cast<std::uint16_t>(m_cpu_daemon->get_pc() & 0xFFF), true },
+        { " I",  static_cast<std::uint16_t>(m_cpu_daemon->get_i() & 0xFFF), true },
+        { "RET", static_cast<std::uint16_t>(sp > 0 ? stack.at(sp & 0xF) & 0xFFF : 0), sp > 0 }
+    };
 
-    for(auto& [key, key_score] : m_keys)
+    std::stringstream row;
+    bool drawn = false;
+
+    for(std::size_t s = 0; s < 3; s++)
     {
-        if(key_score > 0)
+        const int top = 1 + s * 8;
+
+        // the label row, keyed on the address it names
+        const std::uint16_t label = sections[s].m_shown ? sections[s].m_addr : 0x1000;
+        if(m_mem_rows[s * 8] != label)
+        {
+            m_mem_rows[s * 8] = label;
+
+            row << sections[s].m_name << " ";
+            if(sections[s].m_shown) { row << nchip8::nnn << sections[s].m_addr; }
+            else                    { row << "---"; }
+
+            mvwaddstr(m_mem_window.get(), top, 1, std::string(28, ' ').c_str());
+            mvwaddstr(m_mem_window.get(), top, 1, row.str().c_str());
+            row.str(""); row.clear();
+            drawn = true;
+        }
+
+        // 7 rows of 8 bytes, they stay put while the address is in them (e.g. a loop), otherwise it's in the 4th
+        std::uint16_t first = m_mem_rows[s * 8 + 1];
+        if(first >= 0x1000 || sections[s].m_addr < first || sections[s].m_addr >= first + 7 * 8)
         {
-            key_score--;
+            first = std::min(std::max((sections[s].m_addr & ~7) - 24, 0), 0x1000 - 7 * 8);
         }
-        else // key press has departed
+
+        for(std::size_t r = 0; r < 7; r++)
         {
-            // bring the key back up (if it has a valid mapping)
-            if(key_mapping.count(key)) {
-                m_cpu_daemon->set_key_up(key_mapping.at(key));
+            const std::uint16_t base = sections[s].m_shown ? first + r * 8 : no_row - 1;
+            const int y = top + 1 + r;
+
+            // redraw when the row moves, a byte in it changed, or a highlight ran out
+            bool dirty = (m_mem_rows[s * 8 + 1 + r] != base);
+            for(std::size_t b = 0; !dirty && base < 0x1000 && b < 8; b++)
+            {
+                const std::uint64_t changed = m_ram_changed[base + b];
+                dirty = changed != 0 && (changed == m_frame || changed + mem_highlight_frames == m_frame);
             }
 
-            // erase from tracker
-            m_keys.erase(key);
+            if(!dirty){ continue; }
+
+            m_mem_rows[s * 8 + 1 + r] = base;
+            drawn = true;
+
+            mvwaddstr(m_mem_window.get(), y, 1, std::string(28, ' ').c_str());
+            if(base >= 0x1000){ continue; }
+
+            row << std::hex << std::noshowbase << std::setfill('0') << std::setw(3) << base << ":";
+            mvwaddstr(m_mem_window.get(), y, 1, row.str().c_str());
+            row.str(""); row.clear();
+
+            for(std::size_t b = 0; b < 8; b++)
+            {
+                const std::uint64_t changed = m_ram_changed[base + b];
+                const bool recent = changed != 0 && m_frame - changed < mem_highlight_frames;
+
+                row << std::hex << std::noshowbase << std::setfill('0') << std::setw(2)
+                    << static_cast<std::uint16_t>(ram[base + b]);
+
+                if(recent){ wattron(m_mem_window.get(), A_REVERSE); }
+                mvwaddstr(m_mem_window.get(), y, 6 + b * 3, row.str().c_str());
+                if(recent){ wattroff(m_mem_window.get(), A_REVERSE); }
+
+                row.str(""); row.clear();
+            }
         }
     }
+
+    if(!drawn){ return; }
+
+    ::wborder(m_mem_window.get(), 0, 0, 0, 0, 0, 0, 0, 0);
+    ::wnoutrefresh(m_mem_window.get());
 }
 
 }
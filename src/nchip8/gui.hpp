@@ -5,13 +5,15 @@
 #ifndef CHIP8_NCURSES_GUI_HPP
 #define CHIP8_NCURSES_GUI_HPP
 
+#include <array>
 #include <curses.h>
 #include <sstream>
 #include <vector>
 #include <memory>
-#include <unordered_map>
 
 #include "cpu_daemon.hpp"
+#include "key_input.hpp"
+#include "output_throttle.hpp"
 
 namespace nchip8
 {
@@ -23,7 +25,8 @@ public:
     //!
     //! @param cpu  shared_ptr to the cpu_daemon
     //!             that the GUI will display the screen, disassembly & status of
-    gui(std::shared_ptr<cpu_daemon>& cpu);
+    //! @param max_output_rate  Cap on bytes per second written to the terminal, 0 = unlimited
+    gui(std::shared_ptr<cpu_daemon>& cpu, const std::size_t &max_output_rate = 0);
 
     virtual ~gui();
 
@@ -44,6 +47,7 @@ private:
     std::shared_ptr<::WINDOW> m_screen_window   = nullptr;
     std::shared_ptr<::WINDOW> m_log_window      = nullptr;
     std::shared_ptr<::WINDOW> m_reg_window      = nullptr;
+    std::shared_ptr<::WINDOW> m_mem_window      = nullptr;
 
     //! @brief  Rebuilds window when a size change is detected
     void update_windows_on_resize();
@@ -64,21 +68,35 @@ private:
     //! @brief  Update the register preview window, showing all the values of the CPU registers
     void update_reg_window();
 
+    //! @brief      Update the memory window, RAM around PC, I and the top return address
+    //! @details    Only rows whose bytes or addresses changed are redrawn, and only the 64 byte blocks
+    //!             the cpu reports as written are compared, bytes written recently are highlighted
+    void update_mem_window();
+
+    //! Frames drawn, the clock for highlights
+    std::uint64_t m_frame = 0;
+
+    //! RAM as last compared, and the frame each byte last changed on (0 = before the pane was first drawn)
+    std::array<std::uint8_t, 0x1000> m_ram_drawn {};
+    std::array<std::uint64_t, 0x1000> m_ram_changed {};
+
+    //! Blocks taken from the cpu on the frame before, compared again in case a write was late
+    std::uint64_t m_ram_written_before = 0;
+
+    //! The address each row of the memory window shows, no_row = nothing drawn yet
+    static constexpr std::uint16_t no_row = 0xFFFF;
+    std::array<std::uint16_t, 24> m_mem_rows;
+
     //! @brief Redraw's all the windows to the current terminal height and width
     void rebuild_windows();
 
-    //! @brief Update keys
-    void update_keys();
-
-    //! @brief  Map what ncurses chracters to what keypad key
-    static const std::unordered_map<int, std::uint8_t> key_mapping;
+    //! @brief  Reads the keyboard from the terminal on its own thread, ncurses' getch is never used,
+    //!         so the gui loop only draws
+    std::unique_ptr<key_input> m_input;
 
-    //! @brief The current keys that have been pressed
-    //! @details  Because ncurses only tells us the current key that is pushed
-    //!           and we want to have multi-key input into the cpu
-    //!           we assign each pushed key a score of 100 that is decremented at 60Hz
-    //!           when this reaches 0 the key is considered no longer pushed
-    std::unordered_map<int, std::uint8_t> m_keys;
+    //! @brief  Windows are only staged with wnoutrefresh, this decides which frames
+    //!         actually go out with doupdate when the terminal is falling behind
+    std::unique_ptr<output_throttle> m_output;
 
 };
 
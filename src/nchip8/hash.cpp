@@ -0,0 +1,128 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "hash.hpp"
+
+#include <cstring>
+
+namespace nchip8
+{
+
+static constexpr std::uint64_t hash_prime = 0x9E3779B97F4A7C15ull;
+
+static inline std::uint64_t hash_mix(std::uint64_t hash, const std::uint64_t &word)
+{
+    hash = (hash ^ word) * hash_prime;
+    return hash ^ (hash >> 32);
+}
+
+std::uint64_t hash_bytes(const void *data, const std::size_t &size, const std::uint64_t &seed)
+{
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    std::uint64_t hash = hash_mix(seed, size);
+
+    std::size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = hash_mix(hash, word);
+    }
+
+    // whatever is left over, zero padded
+    if(i < size)
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes + i, size - i);
+        hash = hash_mix(hash, word);
+    }
+
+    return hash;
+}
+
+//! Lanes of hash_framebuffer, one 64-byte stripe per step
+static constexpr std::size_t hash_lanes = 8;
+
+static constexpr std::uint64_t hash_lane_keys[hash_lanes] = {
+    0xBE4BA423396CFEB8ull, 0x1CAD21F72C81017Cull, 0xDB979083E96DD4DEull, 0x1F67B3B7A4A44072ull,
+    0x78E5C0CC4EE679CBull, 0x2172FFCC7DD05A82ull, 0x8E2443F7744608B8ull, 0x4C263A81E69035E0ull
+};
+
+//! Four lanes, one AVX2 register or two SSE2 ones
+typedef std::uint64_t hash_vector __attribute__((vector_size(32)));
+
+// the whole framebuffer is 16 stripes, small enough that one accumulate pass with no scrambling is enough
+__attribute__((target_clones("avx2", "default")))
+static void hash_stripes(const std::uint8_t *data, const std::size_t &stripes, std::uint64_t (&acc)[hash_lanes])
+{
+    hash_vector acc_lo, acc_hi, key_lo, key_hi;
+    std::memcpy(&acc_lo, acc, sizeof(acc_lo));
+    std::memcpy(&acc_hi, acc + 4, sizeof(acc_hi));
+    std::memcpy(&key_lo, hash_lane_keys, sizeof(key_lo));
+    std::memcpy(&key_hi, hash_lane_keys + 4, sizeof(key_hi));
+
+    const hash_vector low_half = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+
+    for(std::size_t stripe = 0; stripe < stripes; stripe++)
+    {
+        hash_vector lo, hi;
+        std::memcpy(&lo, data + stripe * 64, sizeof(lo));
+        std::memcpy(&hi, data + stripe * 64 + 32, sizeof(hi));
+
+        // a different key every stripe, like xxh3's sliding secret, or equal flips in different stripes would cancel
+        const std::uint64_t stripe_key = stripe * hash_prime;
+        const hash_vector keyed_lo = lo ^ (key_lo + stripe_key);
+        const hash_vector keyed_hi = hi ^ (key_hi + stripe_key);
+
+        // 32x32->64 multiplies, the raw words added to the other half's lanes keep what they lose
+        acc_lo += (keyed_lo & low_half) * (keyed_lo >> 32) + hi;
+        acc_hi += (keyed_hi & low_half) * (keyed_hi >> 32) + lo;
+    }
+
+    std::memcpy(acc, &acc_lo, sizeof(acc_lo));
+    std::memcpy(acc + 4, &acc_hi, sizeof(acc_hi));
+}
+
+std::uint64_t hash_framebuffer(const packed_framebuffer &frame, const screen_mode &mode)
+{
+    // lores only shows the first quarter
+    const std::size_t visible = (mode == screen_mode::hires_sc8) ? frame.size() : frame.size() / 4;
+
+    std::uint64_t acc[hash_lanes];
+    for(std::size_t lane = 0; lane < hash_lanes; lane++) { acc[lane] = hash_lane_keys[lane] * (mode + 1); }
+
+    hash_stripes(frame.data(), visible / (hash_lanes * 8), acc);
+
+    std::uint64_t hash = hash_mix(visible, mode);
+    for(const std::uint64_t &lane : acc) { hash = hash_mix(hash, lane); }
+
+    return hash_combine(hash, 0);
+}
+
+std::uint64_t hash_combine(const std::uint64_t &hash, const std::uint64_t &value)
+{
+    return hash_mix(hash_mix(hash, value), hash_prime);
+}
+
+std::uint64_t hash_machine_state(const machine_state &s)
+{
+    // registers first, packed so padding is never read
+    const std::uint64_t registers[] = {
+        std::uint64_t(s.m_i) | (std::uint64_t(s.m_pc) << 16) | (std::uint64_t(s.m_sp) << 32) |
+            (std::uint64_t(s.m_dt) << 40) | (std::uint64_t(s.m_st) << 48) | (std::uint64_t(s.m_screen_mode) << 56),
+        std::uint64_t(s.m_trap),
+        s.m_rng,
+        s.m_cycles
+    };
+
+    std::uint64_t hash = hash_bytes(s.m_gpr.data(), s.m_gpr.size());
+    hash = hash_bytes(registers, sizeof(registers), hash);
+    hash = hash_bytes(s.m_stack.data(), s.m_stack.size() * sizeof(s.m_stack[0]), hash);
+    hash = hash_bytes(s.m_ram.data(), s.m_ram.size(), hash);
+    hash = hash_bytes(s.m_screen.data(), s.m_screen.size(), hash);
+
+    return hash;
+}
+
+}
@@ -0,0 +1,38 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_HASH_HPP
+#define NCHIP8_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu.hpp"
+#include "framebuffer.hpp"
+
+namespace nchip8
+{
+
+//! @brief      Fast non-cryptographic 64-bit hash, a word at a time
+//! @param data Bytes to hash
+//! @param size Number of bytes
+//! @param seed Previous hash when chaining several buffers together
+std::uint64_t hash_bytes(const void *data, const std::size_t &size, const std::uint64_t &seed = 0);
+
+//! @brief Folds a value into a running hash, order dependent
+std::uint64_t hash_combine(const std::uint64_t &hash, const std::uint64_t &value);
+
+//! @brief      Hashes the visible part of a packed framebuffer and the screen mode
+//! @details    Eight independent lanes in the style of xxh3's accumulate loop, so the compiler can keep
+//!             them in vector registers, built for AVX2 as well where the CPU has it.
+//!             Equal pictures always hash equal, whatever is left in the hidden part in lores.
+std::uint64_t hash_framebuffer(const packed_framebuffer &frame, const screen_mode &mode);
+
+//! @brief          Hashes a machine's registers, RAM, framebuffer and trap
+//! @details        Each field is hashed explicitly, so padding never changes the result
+std::uint64_t hash_machine_state(const machine_state &state);
+
+}
+
+#endif //NCHIP8_HASH_HPP
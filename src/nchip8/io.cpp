@@ -4,6 +4,9 @@
 
 #include "io.hpp"
 
+#include <fstream>
+#include <stdexcept>
+
 namespace nchip8
 {
 
@@ -34,4 +37,32 @@ std::ostream& kk(std::ostream& out)
     return out << std::showbase << std::setfill('0') << std::setw(2) << std::hex;
 }
 
+std::vector<std::uint8_t> read_binary_file(const std::string &path)
+{
+    std::ifstream input_file(path, std::ios::binary | std::ios::in);
+
+    if (!input_file) {
+        throw std::invalid_argument("Could not open " + path + "!");
+    }
+
+    // read in file
+    std::vector<std::uint8_t> input_data;
+
+    if(!input_file.eof() && !input_file.fail())
+    {
+        // seek to end of file, to get it's size
+        input_file.seekg(0, std::ios_base::end);
+
+        auto size = input_file.tellg();
+        input_data.resize(size);
+
+        // move file pointer back to beginning
+        input_file.seekg(0, std::ios_base::beg);
+
+        input_file.read((char*)input_data.data(), size);
+    }
+
+    return input_data;
+}
+
 }
\ No newline at end of file
@@ -5,9 +5,12 @@
 #ifndef NCHIP8_LOG_HPP
 #define NCHIP8_LOG_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <string>
+#include <vector>
 
 namespace nchip8
 {
@@ -33,6 +36,12 @@ std::ostream& kk(std::ostream& out);
 //! @brief Register pretty-print
 std::ostream& V(std::ostream& out);
 
+//! @brief          Reads a whole file, e.g. a ROM
+//! @param path     Path to the file
+//! @returns        The file's bytes
+//! @throws         std::invalid_argument if the file could not be opened
+std::vector<std::uint8_t> read_binary_file(const std::string &path);
+
 }
 
 #endif //NCHIP8_LOG_HPP
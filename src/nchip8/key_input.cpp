@@ -0,0 +1,414 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "key_input.hpp"
+#include "io.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace nchip8
+{
+
+// kitty keyboard protocol: push flags 1 (disambiguate) | 2 (report event types) | 8 (all keys as escapes),
+// then ask for the current flags, only terminals that support the protocol answer
+static constexpr char kitty_enable[] = "\x1b[>11u\x1b[?u";
+static constexpr char kitty_disable[] = "\x1b[<u";
+
+/**
+ * Typical CHIP-8 keypad was to look like this:
+    1	2   3	C
+    4	5	6	D
+    7	8	9	E
+    A	0	B	F
+
+    Let's do our best to map it to a modern keyboard,
+    the character at index n is CHIP-8 key n
+ */
+static constexpr char key_layout[] = "x123qweasdzc4rfv";
+
+//! @brief The fields of a CSI key sequence: code[:alternates] [; modifiers[:event] [; text]]
+struct csi_key
+{
+    unsigned long m_code;
+
+    //! Shift 1, alt 2, ctrl 4, ...
+    unsigned long m_mods;
+
+    //! 1 press, 2 repeat, 3 release
+    unsigned long m_event;
+};
+
+static csi_key parse_csi_key(const std::string &params)
+{
+    csi_key key { std::strtoul(params.c_str(), nullptr, 10), 0, 1 };
+
+    const std::size_t modifiers = params.find(';');
+    if(modifiers != std::string::npos)
+    {
+        // sent as 1 + the bits
+        key.m_mods = std::strtoul(params.c_str() + modifiers + 1, nullptr, 10);
+        key.m_mods = (key.m_mods > 0) ? key.m_mods - 1 : 0;
+
+        const std::size_t event_at = params.find(':', modifiers);
+        const std::size_t next_field = params.find(';', modifiers + 1);
+
+        if(event_at != std::string::npos && event_at < next_field)
+        {
+            key.m_event = std::strtoul(params.c_str() + event_at + 1, nullptr, 10);
+        }
+    }
+
+    return key;
+}
+
+static void write_all(const int &fd, const char *data, std::size_t size)
+{
+    while(size > 0)
+    {
+        const ssize_t written = ::write(fd, data, size);
+        if(written <= 0) { return; }
+
+        data += written;
+        size -= written;
+    }
+}
+
+key_input::key_input(std::shared_ptr<cpu_daemon> &cpu, const int &fd) :
+    m_cpu_daemon(cpu),
+    m_fd(fd),
+    m_release_events(false),
+    m_quit_requested(false)
+{
+    if(::pipe(m_wake_pipe) != 0)
+    {
+        throw std::runtime_error("could not create the input thread's wake pipe");
+    }
+
+    write_all(STDOUT_FILENO, kitty_enable, sizeof(kitty_enable) - 1);
+
+    m_input_thread = std::thread(&key_input::input_thread, this);
+}
+
+key_input::~key_input()
+{
+    const char wake = 0;
+    write_all(m_wake_pipe[1], &wake, 1);
+    m_input_thread.join();
+
+    ::close(m_wake_pipe[0]);
+    ::close(m_wake_pipe[1]);
+
+    write_all(STDOUT_FILENO, kitty_disable, sizeof(kitty_disable) - 1);
+
+    for(std::uint8_t key = 0; key < m_slots.size(); key++)
+    {
+        if(m_slots[key].m_down) { release(key); }
+    }
+}
+
+std::optional<std::uint8_t> key_input::map_key(const std::uint32_t &codepoint)
+{
+    if(codepoint > 0x7F) { return std::nullopt; }
+
+    const char c = static_cast<char>(std::tolower(static_cast<int>(codepoint)));
+
+    for(std::uint8_t key = 0; key < 16; key++)
+    {
+        if(key_layout[key] == c) { return key; }
+    }
+
+    return std::nullopt;
+}
+
+void key_input::input_thread()
+{
+    pollfd fds[2] = {
+        { m_fd, POLLIN, 0 },
+        { m_wake_pipe[0], POLLIN, 0 }
+    };
+
+    while(true)
+    {
+        // block until a byte arrives, or until a key held by the auto-repeat model is due for release
+        timespec timeout {};
+        timespec* wait = nullptr;
+
+        const std::optional<clock::time_point> deadline = get_next_deadline();
+        if(deadline.has_value())
+        {
+            const auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::max<clock::duration>(*deadline - clock::now(), clock::duration::zero())
+            ).count();
+
+            timeout.tv_sec = left / 1000000000;
+            timeout.tv_nsec = left % 1000000000;
+            wait = &timeout;
+        }
+
+        if(::ppoll(fds, 2, wait, nullptr) < 0)
+        {
+            if(errno == EINTR) { continue; }
+            return;
+        }
+
+        if(fds[1].revents != 0) { return; }
+
+        // the terminal went away, nothing more will come in
+        if((fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) && !(fds[0].revents & POLLIN)) { return; }
+
+        update(clock::now());
+    }
+}
+
+void key_input::update(const clock::time_point &now)
+{
+    // drain everything that's waiting, a burst of repeats shouldn't take several frames to get through
+    pollfd pfd { m_fd, POLLIN, 0 };
+    char buffer[256];
+
+    while(::poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN))
+    {
+        const ssize_t got = ::read(m_fd, buffer, sizeof(buffer));
+        if(got <= 0) { break; }
+
+        m_pending.append(buffer, got);
+    }
+
+    decode(now);
+
+    // keys whose auto-repeat has stopped have been let go
+    for(std::uint8_t key = 0; key < m_slots.size(); key++)
+    {
+        const key_slot &slot = m_slots[key];
+
+        if(slot.m_down && !slot.m_reported && now >= get_release_time(slot))
+        {
+            release(key);
+        }
+    }
+}
+
+std::optional<key_input::clock::time_point> key_input::get_next_deadline() const
+{
+    std::optional<clock::time_point> next;
+
+    for(const key_slot &slot : m_slots)
+    {
+        if(slot.m_down && !slot.m_reported)
+        {
+            const clock::time_point release_at = get_release_time(slot);
+            if(!next.has_value() || release_at < *next) { next = release_at; }
+        }
+    }
+
+    return next;
+}
+
+bool key_input::has_release_events() const
+{
+    return m_release_events.load();
+}
+
+int key_input::get_fd() const
+{
+    return m_fd;
+}
+
+bool key_input::is_quit_requested() const
+{
+    return m_quit_requested.load();
+}
+
+key_input::clock::time_point key_input::get_release_time(const key_slot &slot) const
+{
+    // before the first repeat, wait out the repeat delay, after that a couple of missed repeats
+    if(slot.m_repeats == 0)
+    {
+        return slot.m_last_seen + m_repeat_delay + m_repeat_interval;
+    }
+
+    return slot.m_last_seen + m_repeat_interval * 2;
+}
+
+void key_input::decode(const clock::time_point &now)
+{
+    std::size_t i = 0;
+
+    while(i < m_pending.size())
+    {
+        const std::uint8_t byte = m_pending[i];
+
+        if(byte != 0x1B)
+        {
+            on_byte(byte, now);
+            i++;
+            continue;
+        }
+
+        // a lone ESC at the end might be the start of a sequence still on its way
+        if(i + 1 >= m_pending.size()) { break; }
+
+        const char introducer = m_pending[i + 1];
+
+        if(introducer == '[')
+        {
+            // CSI: parameter and intermediate bytes, then a final byte in 0x40-0x7E
+            std::size_t end = i + 2;
+            while(end < m_pending.size() && (m_pending[end] < 0x40 || m_pending[end] > 0x7E)) { end++; }
+
+            if(end >= m_pending.size()) { break; }
+
+            if(m_pending[end] == 'u')
+            {
+                on_kitty_key(m_pending.substr(i + 2, end - (i + 2)), now);
+            }
+            else if(m_pending[end] == '~')
+            {
+                on_function_key(m_pending.substr(i + 2, end - (i + 2)));
+            }
+
+            // anything else (arrows, ...) isn't mapped
+            i = end + 1;
+        }
+        else if(introducer == 'O')
+        {
+            // SS3, e.g. F1-F4, one more byte
+            if(i + 2 >= m_pending.size()) { break; }
+            i += 3;
+        }
+        else
+        {
+            // Alt+key or a bare ESC, skip the ESC
+            i++;
+        }
+    }
+
+    m_pending.erase(0, i);
+}
+
+void key_input::on_kitty_key(const std::string &params, const clock::time_point &now)
+{
+    // reply to the flags query: CSI ? flags u
+    if(!params.empty() && params[0] == '?')
+    {
+        if(!m_release_events)
+        {
+            nchip8::log << "[input] terminal reports key releases" << '\n';
+        }
+
+        m_release_events = true;
+        return;
+    }
+
+    const csi_key csi = parse_csi_key(params);
+
+    // Ctrl+C comes as a key rather than SIGINT, and no other Ctrl chord is a CHIP-8 key,
+    // a release still goes through in case the key went down before Ctrl did
+    if((csi.m_mods & 4) && csi.m_event != 3)
+    {
+        if(csi.m_code == 'c') { m_quit_requested = true; }
+        return;
+    }
+
+    const std::optional<std::uint8_t> key = map_key(csi.m_code);
+    if(!key.has_value()) { return; }
+
+    if(csi.m_event == 3)    { release(*key); }
+    else                    { press(*key, true, now); }
+}
+
+void key_input::on_function_key(const std::string &params)
+{
+    const csi_key csi = parse_csi_key(params);
+
+    // act on presses and repeats, holding F6 keeps stepping back
+    if(csi.m_event == 3) { return; }
+
+    switch(csi.m_code)
+    {
+        case 15: // F5
+        {
+            const bool pause = (m_cpu_daemon->get_cpu_state() == cpu_daemon::running);
+            m_cpu_daemon->set_cpu_state(pause ? cpu_daemon::paused : cpu_daemon::running);
+
+            nchip8::log << "[input] " << (pause ? "paused" : "resumed") << '\n';
+            break;
+        }
+
+        case 17: // F6
+            m_cpu_daemon->send_message(cpu_message(cpu_message_type::ReverseStep));
+            break;
+
+        case 18: // F7
+            m_cpu_daemon->send_message(cpu_message(cpu_message_type::ReverseContinue));
+            break;
+
+        default:
+            break;
+    }
+}
+
+void key_input::on_byte(const std::uint8_t &byte, const clock::time_point &now)
+{
+    const std::optional<std::uint8_t> key = map_key(byte);
+    if(!key.has_value()) { return; }
+
+    key_slot &slot = m_slots[*key];
+
+    if(!slot.m_down)
+    {
+        press(*key, false, now);
+        return;
+    }
+
+    // an auto-repeat, learn the terminal's timing from it
+    const clock::duration gap = now - slot.m_last_seen;
+
+    if(slot.m_repeats == 0)
+    {
+        if(gap > std::chrono::milliseconds(100) && gap < std::chrono::milliseconds(1000))
+        {
+            m_repeat_delay = (m_repeat_delay * 3 + gap) / 4;
+        }
+    }
+    else if(gap > std::chrono::milliseconds(5) && gap < std::chrono::milliseconds(200))
+    {
+        m_repeat_interval = (m_repeat_interval * 3 + gap) / 4;
+    }
+
+    slot.m_repeats++;
+    slot.m_last_seen = now;
+}
+
+void key_input::press(const std::uint8_t &key, const bool &reported, const clock::time_point &now)
+{
+    key_slot &slot = m_slots[key];
+
+    const bool was_down = slot.m_down;
+
+    slot.m_down = true;
+    slot.m_reported = reported;
+    slot.m_last_seen = now;
+
+    if(!was_down)
+    {
+        slot.m_repeats = 0;
+        m_cpu_daemon->set_key_down(key);
+    }
+}
+
+void key_input::release(const std::uint8_t &key)
+{
+    m_slots[key] = key_slot {};
+    m_cpu_daemon->set_key_up(key);
+}
+
+}
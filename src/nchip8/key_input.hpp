@@ -0,0 +1,133 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_KEY_INPUT_HPP
+#define NCHIP8_KEY_INPUT_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "cpu_daemon.hpp"
+
+namespace nchip8
+{
+
+//! @brief      Reads keys straight from the terminal and forwards presses and releases to the cpu
+//! @details    Terminals that speak the kitty keyboard protocol report real key releases.
+//!             Everywhere else a key is held for as long as the terminal's auto-repeat keeps resending it,
+//!             with the repeat delay and rate learnt from the gaps between repeats.
+//!             (xterm's modifyOtherKeys only disambiguates modifiers, it has no release events,
+//!             so those terminals use the auto-repeat model too.)
+//!             Keys are read on their own thread, blocked on the terminal, so a slow redraw never delays them.
+class key_input
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    //! @brief      Starts the input thread
+    //! @param cpu  Where key changes are sent
+    //! @param fd   The terminal, read directly so ncurses never sees the bytes
+    //! @throws     std::runtime_error if the thread's wake pipe can't be created
+    key_input(std::shared_ptr<cpu_daemon> &cpu, const int &fd);
+
+    //! @brief Stops the input thread, turns the kitty keyboard protocol back off and releases any held keys
+    virtual ~key_input();
+
+    //! @brief Returns true once the terminal has confirmed it sends release events
+    bool has_release_events() const;
+
+    //! @brief Returns the terminal file descriptor
+    int get_fd() const;
+
+    //! @brief      Returns true once Ctrl+C has been pressed
+    //! @details    With the kitty protocol on, the terminal sends Ctrl+C as a key instead of raising SIGINT,
+    //!             so whoever owns the loop has to quit on it
+    bool is_quit_requested() const;
+
+private:
+    //! @brief A CHIP-8 key
+    struct key_slot
+    {
+        bool m_down = false;
+
+        //! True if held by a kitty press event rather than the auto-repeat model
+        bool m_reported = false;
+
+        //! Repeats seen since the press
+        std::uint32_t m_repeats = 0;
+
+        //! When the press or the last repeat arrived
+        clock::time_point m_last_seen;
+    };
+
+    std::shared_ptr<cpu_daemon> m_cpu_daemon;
+
+    int m_fd;
+
+    //! Indexed by CHIP-8 key
+    std::array<key_slot, 16> m_slots;
+
+    //! Bytes of an escape sequence that hasn't fully arrived yet
+    std::string m_pending;
+
+    //! Set when the terminal answers the kitty protocol query
+    std::atomic<bool> m_release_events;
+
+    //! Set by Ctrl+C, see is_quit_requested
+    std::atomic<bool> m_quit_requested;
+
+    //! Learnt auto-repeat timing, starts at common desktop defaults
+    clock::duration m_repeat_delay = std::chrono::milliseconds(400);
+    clock::duration m_repeat_interval = std::chrono::milliseconds(33);
+
+    //! Written to by the destructor to wake the input thread, [0] is the read end
+    int m_wake_pipe[2];
+
+    //! Thread object for void input_thread()
+    std::thread m_input_thread;
+
+    //! @brief  Blocks on the terminal until bytes arrive or an auto-repeat release is due,
+    //!         handling each as soon as it happens, until the destructor wakes it
+    void input_thread();
+
+    //! @brief  Reads every byte waiting on the terminal without blocking,
+    //!         then releases keys whose auto-repeat has stopped
+    void update(const clock::time_point &now);
+
+    //! @brief Returns when update() next needs to run to release a key, if any key is held by the auto-repeat model
+    std::optional<clock::time_point> get_next_deadline() const;
+
+    //! @brief Decodes m_pending, leaving an incomplete trailing escape sequence in it
+    void decode(const clock::time_point &now);
+
+    //! @brief Handles a kitty CSI ... u sequence, params excludes the CSI and the final 'u'
+    void on_kitty_key(const std::string &params, const clock::time_point &now);
+
+    //! @brief      Handles a CSI ... ~ sequence, params excludes the CSI and the final '~'
+    //! @details    The debugger keys: F5 pauses and resumes, F6 steps back an instruction,
+    //!             F7 goes back to the last breakpoint reached (see cpu_message_type)
+    void on_function_key(const std::string &params);
+
+    //! @brief Handles a plain byte, a press or an auto-repeat
+    void on_byte(const std::uint8_t &byte, const clock::time_point &now);
+
+    //! @brief Returns when a key held by the auto-repeat model counts as released
+    clock::time_point get_release_time(const key_slot &slot) const;
+
+    void press(const std::uint8_t &key, const bool &reported, const clock::time_point &now);
+    void release(const std::uint8_t &key);
+
+    //! @brief Maps a (lowercase) character to a CHIP-8 key, see key_input.cpp for the layout
+    static std::optional<std::uint8_t> map_key(const std::uint32_t &codepoint);
+};
+
+}
+
+#endif //NCHIP8_KEY_INPUT_HPP
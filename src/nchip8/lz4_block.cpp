@@ -0,0 +1,168 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "lz4_block.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace nchip8
+{
+
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+static constexpr std::size_t min_match = 4;
+
+//! The last 5 bytes are always literals
+static constexpr std::size_t last_literals = 5;
+
+//! The last match has to start at least 12 bytes before the end
+static constexpr std::size_t match_limit = 12;
+
+static constexpr std::size_t max_offset = 0xFFFF;
+
+static constexpr unsigned hash_bits = 12;
+
+static std::uint32_t read_u32(const std::uint8_t *p)
+{
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static std::uint32_t hash_u32(const std::uint32_t &value)
+{
+    return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+//! @brief Writes the 255, 255, ..., remainder tail of a length that didn't fit in its token nibble
+static void write_length(std::size_t length, std::vector<std::uint8_t> &out)
+{
+    for(; length >= 255; length -= 255) { out.push_back(255); }
+    out.push_back(static_cast<std::uint8_t>(length));
+}
+
+static void write_sequence(const std::uint8_t *literals, const std::size_t &literal_count,
+                           const std::size_t &offset, const std::size_t &match_length,
+                           std::vector<std::uint8_t> &out)
+{
+    const std::size_t match_code = match_length - min_match;
+
+    out.push_back(static_cast<std::uint8_t>(
+        ((literal_count < 15 ? literal_count : 15) << 4) | (match_code < 15 ? match_code : 15)
+    ));
+
+    if(literal_count >= 15) { write_length(literal_count - 15, out); }
+    out.insert(out.end(), literals, literals + literal_count);
+
+    out.push_back(offset & 0xFF);
+    out.push_back(offset >> 8);
+
+    if(match_code >= 15) { write_length(match_code - 15, out); }
+}
+
+void lz4_compress(const std::uint8_t *src, const std::size_t &size, std::vector<std::uint8_t> &out)
+{
+    // last position seen for each hash of 4 bytes, +1 so 0 means empty
+    std::array<std::uint32_t, 1 << hash_bits> table {};
+
+    std::size_t anchor = 0;
+    std::size_t ip = 0;
+
+    if(size > match_limit)
+    {
+        while(ip < size - match_limit)
+        {
+            const std::uint32_t sequence = read_u32(src + ip);
+            std::uint32_t &slot = table[hash_u32(sequence)];
+            const std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(ip + 1);
+
+            if(candidate == 0 || ip - (candidate - 1) > max_offset || read_u32(src + candidate - 1) != sequence)
+            {
+                ip++;
+                continue;
+            }
+
+            const std::size_t ref = candidate - 1;
+
+            // matches may overlap what they copy, a run of zeros is one byte then a match at offset 1
+            std::size_t length = min_match;
+            while(ip + length < size - last_literals && src[ref + length] == src[ip + length]) { length++; }
+
+            write_sequence(src + anchor, ip - anchor, ip - ref, length, out);
+
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    // the rest as literals
+    const std::size_t literal_count = size - anchor;
+
+    out.push_back(static_cast<std::uint8_t>((literal_count < 15 ? literal_count : 15) << 4));
+    if(literal_count >= 15) { write_length(literal_count - 15, out); }
+    out.insert(out.end(), src + anchor, src + size);
+}
+
+//! @brief Reads the tail of a length, returns false if it runs off the end of the input
+static bool read_length(const std::uint8_t *src, const std::size_t &size, std::size_t &ip, std::size_t &length)
+{
+    std::uint8_t byte;
+
+    do
+    {
+        if(ip >= size) { return false; }
+
+        byte = src[ip++];
+        length += byte;
+    } while(byte == 255);
+
+    return true;
+}
+
+bool lz4_decompress(const std::uint8_t *src, const std::size_t &size, std::uint8_t *dst, const std::size_t &dst_size)
+{
+    std::size_t ip = 0;
+    std::size_t op = 0;
+
+    while(ip < size)
+    {
+        const std::uint8_t token = src[ip++];
+
+        std::size_t literal_count = token >> 4;
+        if(literal_count == 15 && !read_length(src, size, ip, literal_count)) { return false; }
+
+        if(literal_count > size - ip || literal_count > dst_size - op) { return false; }
+
+        if(literal_count > 0) { std::memcpy(dst + op, src + ip, literal_count); }
+        ip += literal_count;
+        op += literal_count;
+
+        // the last sequence has no match
+        if(ip == size) { break; }
+
+        if(size - ip < 2) { return false; }
+
+        const std::size_t offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+
+        if(offset == 0 || offset > op) { return false; }
+
+        std::size_t match_length = token & 0xF;
+        if(match_length == 15 && !read_length(src, size, ip, match_length)) { return false; }
+        match_length += min_match;
+
+        if(match_length > dst_size - op) { return false; }
+
+        // byte by byte, the match may overlap its own output
+        for(std::size_t i = 0; i < match_length; i++, op++)
+        {
+            dst[op] = dst[op - offset];
+        }
+    }
+
+    return op == dst_size;
+}
+
+}
@@ -0,0 +1,28 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_LZ4_BLOCK_HPP
+#define NCHIP8_LZ4_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nchip8
+{
+
+//! @brief      Compresses a buffer into the LZ4 block format
+//! @details    A small greedy single-pass encoder, tuned for short mostly-empty inputs like frame deltas
+//!             rather than ratio. The output decodes with any LZ4 block decoder (e.g. LZ4_decompress_safe).
+//! @param out  Compressed bytes are appended to it
+void lz4_compress(const std::uint8_t *src, const std::size_t &size, std::vector<std::uint8_t> &out);
+
+//! @brief          Decompresses an LZ4 block
+//! @param dst_size The exact decompressed size, known from the container
+//! @returns        False if the block is malformed or doesn't decompress to exactly dst_size bytes
+bool lz4_decompress(const std::uint8_t *src, const std::size_t &size, std::uint8_t *dst, const std::size_t &dst_size);
+
+}
+
+#endif //NCHIP8_LZ4_BLOCK_HPP
@@ -24,49 +24,93 @@ nchip8_app::nchip8_app(const std::vector<std::string> &args) :
 
 int nchip8_app::run()
 {
+    static const char* usage = "Usage: nchip8 <path to rom> [--clock HZ] [--max-output-rate BYTES] [--stream SOCKET] "
+                               "[--record FILE.cast|FILE.n8m] [--audio FILE.wav] [--trace FILE.n8t] [--break ADDR]...";
+
     // complain if they don't supply a file
     //
     if (m_args.size() < 2) // args should contain [executable,first_argument]
     {
-        throw std::invalid_argument("No ROM! (Usage: nchip8 <path to rom>");
+        throw std::invalid_argument(std::string("No ROM! (") + usage + ")");
     }
 
-    // try to read in the supplied rom file
-    std::ifstream input_file(m_args[1], std::ios::binary | std::ios::in);
+    int clock = 0;
+    std::size_t max_output_rate = 0;
+    std::string stream_path, record_path, audio_path, trace_path;
+    std::vector<std::uint16_t> breakpoints;
 
-    if (!input_file) {
-        throw std::invalid_argument("Could not open " + m_args[1] + "!");
+    for(std::size_t i = 2; i < m_args.size(); i++)
+    {
+        const std::string& arg = m_args[i];
+        const bool has_value = (i + 1 < m_args.size());
+
+        if(arg == "--clock" && has_value)                   { clock = std::stoi(m_args[++i]); }
+        else if(arg == "--max-output-rate" && has_value)    { max_output_rate = std::stoul(m_args[++i]); }
+        else if(arg == "--stream" && has_value)             { stream_path = m_args[++i]; }
+        else if(arg == "--record" && has_value)             { record_path = m_args[++i]; }
+        else if(arg == "--audio" && has_value)              { audio_path = m_args[++i]; }
+        else if(arg == "--trace" && has_value)              { trace_path = m_args[++i]; }
+        else if(arg == "--break" && has_value)
+        {
+            breakpoints.push_back(std::stoul(m_args[++i], nullptr, 16) & 0xFFF);
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown argument: " + arg + " (" + usage + ")");
+        }
     }
 
-    // read in file
-    std::vector<std::uint8_t> input_data;
+    // try to read in the supplied rom file
+    std::vector<std::uint8_t> input_data = nchip8::read_binary_file(m_args[1]);
 
-    if(!input_file.eof() && !input_file.fail())
-    {
-        // seek to end of file, to get it's size
-        input_file.seekg(0, std::ios_base::end);
+    m_cpu_daemon = std::make_shared<cpu_daemon>();
 
-        auto size = input_file.tellg();
-        input_data.resize(size);
+    // cap on terminal output, for slow links
+    m_gui = std::make_unique<gui>(m_cpu_daemon, max_output_rate);
 
-        // move file pointer back to beginning
-        input_file.seekg(0, std::ios_base::beg);
+    if(clock > 0)
+    {
+        m_cpu_daemon->set_cpu_clockspeed(clock);
+    }
 
-        input_file.read((char*)&input_data[0], size);
+    if(!stream_path.empty())
+    {
+        m_frame_server = std::make_unique<frame_server>(m_cpu_daemon, stream_path);
     }
 
+    if(!record_path.empty())
+    {
+        const bool cast = record_path.size() >= 5 && record_path.compare(record_path.size() - 5, 5, ".cast") == 0;
+
+        m_recorder = std::make_shared<frame_recorder>(record_path, cast ? recording_format::asciicast
+                                                                        : recording_format::packed_movie);
+        m_cpu_daemon->set_recorder(m_recorder);
+    }
 
-    m_cpu_daemon = std::make_shared<cpu_daemon>();
-    m_gui = std::make_unique<gui>(m_cpu_daemon);
+    if(!audio_path.empty())
+    {
+        // paced like a sound card, so the file lines up with the session and stalls show up as underruns
+        m_audio = std::make_shared<audio_synth>(std::make_unique<wav_sink>(audio_path, 44100), audio_pacing::realtime);
+        m_cpu_daemon->set_audio(m_audio);
+    }
 
-    if(m_args.size() > 2)
+    if(!trace_path.empty())
     {
-        m_cpu_daemon->set_cpu_clockspeed(std::stoi(m_args.at(2)));
+        m_tracer = std::make_shared<trace_writer>(trace_path);
+        m_cpu_daemon->set_tracer(m_tracer);
     }
 
     // reset the cpu
     m_cpu_daemon->send_message(cpu_message(cpu_message_type::Reset));
 
+    // where F7 (continue back) stops, and running forward pauses
+    for(const std::uint16_t &address : breakpoints)
+    {
+        m_cpu_daemon->send_message(cpu_message(
+            cpu_message_type::SetBreakpoint, { std::uint8_t(address >> 8), std::uint8_t(address & 0xFF) }
+        ));
+    }
+
     // load rom
     m_cpu_daemon->send_message(cpu_message(
         cpu_message_type::LoadROM,
@@ -85,6 +129,19 @@ int nchip8_app::run()
     // start gui, note: blocking
     m_gui->loop();
 
+    if(m_audio)
+    {
+        nchip8::log << "[nchip8] audio: " << std::dec << m_audio->get_underruns() << " underruns, latency "
+                    << m_audio->get_latency().count() << "us (max " << m_audio->get_max_latency().count() << "us), "
+                    << m_audio->get_edges_dropped() << " edges dropped" << '\n';
+    }
+
+    if(m_tracer)
+    {
+        nchip8::log << "[nchip8] trace: " << std::dec << m_tracer->get_records() << " instructions, "
+                    << m_tracer->get_records_dropped() << " dropped" << '\n';
+    }
+
     return 0;
 }
 
@@ -6,13 +6,16 @@
 #define CHIP8_NCURSES_NCHIP8_HPP
 
 #include <memory>
+#include <string>
 #include <vector>
 
-#include <bits/stdc++.h>
-
+#include "audio.hpp"
 #include "io.hpp"
 #include "cpu_daemon.hpp"
+#include "frame_stream.hpp"
 #include "gui.hpp"
+#include "recorder.hpp"
+#include "trace_file.hpp"
 
 namespace nchip8
 {
@@ -35,6 +38,18 @@ private:
 
     std::unique_ptr<gui> m_gui;
     std::shared_ptr<cpu_daemon> m_cpu_daemon;
+
+    //! Serves the screen to remote viewers, only if a socket path was given
+    std::unique_ptr<frame_server> m_frame_server;
+
+    //! Records the session, only if a recording path was given
+    std::shared_ptr<frame_recorder> m_recorder;
+
+    //! Plays the buzzer into a WAV file, only if an audio path was given
+    std::shared_ptr<audio_synth> m_audio;
+
+    //! Traces every instruction to a file, only if a trace path was given
+    std::shared_ptr<trace_writer> m_tracer;
 };
 
 }
@@ -0,0 +1,138 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+/* C interface to the emulator core, for driving instances from other languages.
+ * Every buffer is owned by the caller and no C++ exception ever crosses these functions,
+ * failures are reported through nchip8_status. */
+
+#ifndef NCHIP8_C_H
+#define NCHIP8_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define NCHIP8_API __declspec(dllexport)
+#else
+#define NCHIP8_API __attribute__((visibility("default")))
+#endif
+
+/* Size of the buffer nchip8_get_framebuffer_packed fills, one bit per pixel of the 128*64 screen */
+#define NCHIP8_FRAMEBUFFER_PACKED_SIZE 1024
+
+/* Stop conditions for nchip8_run_cycles, combined into a mask. The budget, traps and halts always stop a run */
+#define NCHIP8_STOP_ON_FRAME        0x1u    /* after a DRW or CLS */
+#define NCHIP8_STOP_ON_KEY_WAIT     0x2u    /* before an LD Vx, K with no key down */
+#define NCHIP8_STOP_ON_BREAKPOINT   0x4u    /* before the instruction at a breakpoint, see nchip8_set_breakpoint */
+#define NCHIP8_STOP_ON_SOUND        0x8u    /* after an LD ST, Vx */
+
+typedef enum nchip8_status
+{
+    NCHIP8_OK = 0,
+    NCHIP8_ERROR_INVALID_ARGUMENT = -1,     /* null pointer, bad size etc. */
+    NCHIP8_ERROR_ROM_TOO_LARGE = -2,        /* the ROM does not fit in memory at 0x200 */
+    NCHIP8_ERROR_BUFFER_TOO_SMALL = -3,     /* the caller's buffer is smaller than required */
+    NCHIP8_ERROR_BAD_STATE = -4,            /* a saved state from another version, or not a state at all */
+    NCHIP8_ERROR_INTERNAL = -5              /* anything else, e.g. out of memory */
+} nchip8_status;
+
+/* Why a run returned, matches nchip8::run_stop */
+typedef enum nchip8_stop
+{
+    NCHIP8_STOP_BUDGET = 0,
+    NCHIP8_STOP_FRAME = 1,
+    NCHIP8_STOP_KEY_WAIT = 2,
+    NCHIP8_STOP_BREAKPOINT = 3,
+    NCHIP8_STOP_HALTED = 4,
+    NCHIP8_STOP_TRAPPED = 5,
+    NCHIP8_STOP_SOUND = 6
+} nchip8_stop;
+
+/* The fault that stopped an instance, matches nchip8::trap */
+typedef enum nchip8_trap
+{
+    NCHIP8_TRAP_NONE = 0,
+    NCHIP8_TRAP_ILLEGAL_OPCODE = 1,
+    NCHIP8_TRAP_STACK_OVERFLOW = 2,
+    NCHIP8_TRAP_STACK_UNDERFLOW = 3,
+    NCHIP8_TRAP_PC_OUT_OF_RANGE = 4
+} nchip8_trap;
+
+typedef struct nchip8_run_result
+{
+    uint64_t cycles;    /* cycles consumed */
+    uint32_t stop;      /* nchip8_stop */
+    uint32_t trap;      /* nchip8_trap, NCHIP8_TRAP_NONE unless stop is NCHIP8_STOP_TRAPPED */
+} nchip8_run_result;
+
+/* An emulator instance, independent of every other one */
+typedef struct nchip8_instance nchip8_instance;
+
+/* Creates an instance in the power-on state, returns NULL on failure */
+NCHIP8_API nchip8_instance* nchip8_create(void);
+
+/* Destroys an instance, NULL is ignored */
+NCHIP8_API void nchip8_destroy(nchip8_instance* instance);
+
+/* Resets to the power-on state and loads a ROM at 0x200 */
+NCHIP8_API nchip8_status nchip8_load_rom(nchip8_instance* instance, const uint8_t* rom, size_t size);
+
+/* Seeds the generator used by RND, runs with the same seed and input are reproducible */
+NCHIP8_API nchip8_status nchip8_seed_rng(nchip8_instance* instance, uint32_t seed);
+
+/* Sets the instruction clock in Hz the 60Hz timers are counted against, 500 by default.
+ * The timers tick at exactly 60Hz of cycles on average even when hz isn't a multiple of 60 */
+NCHIP8_API nchip8_status nchip8_set_clock_rate(nchip8_instance* instance, uint32_t hz);
+
+/* Sets the clock to a whole number of cycles per 60Hz timer tick, i.e. nchip8_set_clock_rate(cycles_per_tick * 60).
+ * The default 500Hz isn't one, 8 per tick is 480Hz */
+NCHIP8_API nchip8_status nchip8_set_cycles_per_tick(nchip8_instance* instance, uint32_t cycles_per_tick);
+
+/* Runs up to `cycles` cycles, see the NCHIP8_STOP_ON_* flags. result may be NULL */
+NCHIP8_API nchip8_status nchip8_run_cycles(nchip8_instance* instance, uint64_t cycles, uint32_t stop_mask,
+                                           nchip8_run_result* result);
+
+/* Runs every instance in the array for up to `cycles` cycles each, in one call.
+ * results must hold `count` entries (or be NULL). A NULL instance fails the whole call before anything runs */
+NCHIP8_API nchip8_status nchip8_run_cycles_bulk(nchip8_instance* const* instances, size_t count,
+                                                uint64_t cycles, uint32_t stop_mask,
+                                                nchip8_run_result* results);
+
+/* Adds or removes a breakpoint, only stops runs with NCHIP8_STOP_ON_BREAKPOINT */
+NCHIP8_API nchip8_status nchip8_set_breakpoint(nchip8_instance* instance, uint16_t address, int enabled);
+
+/* Sets the keys held down, bit n = key n */
+NCHIP8_API nchip8_status nchip8_set_keys_mask(nchip8_instance* instance, uint16_t keys);
+
+/* Copies the screen at one bit per pixel, most significant bit first, into a NCHIP8_FRAMEBUFFER_PACKED_SIZE buffer.
+ * Rows are 128 pixels wide in hires mode and 64 in lores, see nchip8_get_screen_size */
+NCHIP8_API nchip8_status nchip8_get_framebuffer_packed(const nchip8_instance* instance, uint8_t* buffer, size_t size);
+
+/* Returns the current screen size in pixels, 64*32 or 128*64 */
+NCHIP8_API nchip8_status nchip8_get_screen_size(const nchip8_instance* instance, uint32_t* width, uint32_t* height);
+
+/* Returns the instance's trap, NCHIP8_TRAP_NONE if it is running normally */
+NCHIP8_API nchip8_trap nchip8_get_trap(const nchip8_instance* instance);
+
+/* Returns the buffer size nchip8_save_state needs */
+NCHIP8_API size_t nchip8_state_size(void);
+
+/* Saves the machine state (registers, RAM, screen, timers, RND) into a nchip8_state_size() buffer.
+ * States only load into the same build of the library */
+NCHIP8_API nchip8_status nchip8_save_state(const nchip8_instance* instance, uint8_t* buffer, size_t size);
+
+/* Restores a state saved with nchip8_save_state, keys are left as they are.
+ * NCHIP8_ERROR_BAD_STATE, with the instance untouched, if the buffer isn't a state from this build
+ * or holds values no machine could be in (e.g. a screen mode or trap that doesn't exist) */
+NCHIP8_API nchip8_status nchip8_load_state(nchip8_instance* instance, const uint8_t* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NCHIP8_C_H */
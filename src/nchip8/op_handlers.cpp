@@ -8,7 +8,6 @@
 #include <sstream>
 #include <iostream>
 #include <bitset>
-#include <random>
 
 #include "cpu.hpp"
 #include "io.hpp"
@@ -24,7 +23,7 @@ namespace nchip8
 //! for the purposes of space and readability, we are aliasing this to DATA
 static constexpr std::nullopt_t DATA = std::nullopt;
 
-cpu::op_handler cpu::CLS
+constexpr cpu::op_handler cpu::CLS
 {
     {0x0, 0x0, 0xE, 0x0},
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -35,17 +34,22 @@ cpu::op_handler cpu::CLS
     [](const cpu::operand_data &operands, std::stringstream &ss)
     {
         ss << "CLS";
-    }
+    },
+
+    stop_on_frame
 };
 
 
-cpu::op_handler cpu::RET
+constexpr cpu::op_handler cpu::RET
 {
     {0x0, 0x0, 0xE, 0xE},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-        cpu.m_pc = cpu.m_stack[cpu.m_sp];
-        cpu.m_sp--;
+        if(cpu.m_sp == 0) { cpu.m_trap = trap::stack_underflow; return; }
+
+        // the stack pointer stays masked within the 16 entry stack
+        cpu.m_pc = cpu.m_stack[cpu.m_sp & 0xF];
+        cpu.m_sp = (cpu.m_sp - 1) & 0xF;
     },
 
     [](const cpu::operand_data &operands, std::stringstream &ss)
@@ -54,7 +58,7 @@ cpu::op_handler cpu::RET
     }
 };
 
-cpu::op_handler cpu::JP
+constexpr cpu::op_handler cpu::JP
 {
     {0x1, DATA, DATA, DATA},
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -68,12 +72,14 @@ cpu::op_handler cpu::JP
     }
 };
 
-cpu::op_handler cpu::CALL
+constexpr cpu::op_handler cpu::CALL
 {
     { 0x2, DATA, DATA, DATA },
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-        cpu.m_sp++; // get space on the stack to store return value
+        if(cpu.m_sp == 0xF) { cpu.m_trap = trap::stack_overflow; return; }
+
+        cpu.m_sp = (cpu.m_sp + 1) & 0xF; // get space on the stack to store return value
 
         // store return address (which is the instruction after current PC)
         cpu.m_stack[cpu.m_sp] = cpu.m_pc + 0x2;
@@ -90,7 +96,7 @@ cpu::op_handler cpu::CALL
 
 // 0x3xkk - SE Vx, byte
 // Skip next instruction if Vx = kk.
-cpu::op_handler cpu::SE_VX_KK
+constexpr cpu::op_handler cpu::SE_VX_KK
 {
     { 0x3, DATA, DATA, DATA },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -109,7 +115,7 @@ cpu::op_handler cpu::SE_VX_KK
 
 // 0x4xkk - SNE Vx, byte
 // Skip next instruction if Vx != kk.
-cpu::op_handler cpu::SNE_VX_KK
+constexpr cpu::op_handler cpu::SNE_VX_KK
 {
     { 0x4, DATA, DATA, DATA },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -125,7 +131,7 @@ cpu::op_handler cpu::SNE_VX_KK
 
 // 0x5xy0 - SE Vx, Vy
 // Skip next instruction if Vx == Vy.
-cpu::op_handler cpu::SE_VX_VY
+constexpr cpu::op_handler cpu::SE_VX_VY
 {
     { 0x5, DATA, DATA, 0x0 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -141,7 +147,7 @@ cpu::op_handler cpu::SE_VX_VY
 
 // 0x6xkk - LD Vx, byte
 // Set Vx = kk.
-cpu::op_handler cpu::LD_VX_KK
+constexpr cpu::op_handler cpu::LD_VX_KK
 {
     { 0x6, DATA, DATA, DATA },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -158,7 +164,7 @@ cpu::op_handler cpu::LD_VX_KK
 
 // 0x7xkk - ADD Vx, byte
 // Set Vx = Vx + kk
-cpu::op_handler cpu::ADD_VX_KK
+constexpr cpu::op_handler cpu::ADD_VX_KK
 {
     { 0x7, DATA, DATA, DATA },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -174,7 +180,7 @@ cpu::op_handler cpu::ADD_VX_KK
 
 // 0x8xy0 - LD Vx, Vy
 // Set Vx = Vy.
-cpu::op_handler cpu::LD_VX_VY
+constexpr cpu::op_handler cpu::LD_VX_VY
 {
     { 0x8, DATA, DATA, 0x0 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -190,7 +196,7 @@ cpu::op_handler cpu::LD_VX_VY
 
 // 0x8xy1 - OR Vx, Vy
 // Set Vx = Vx OR Vy.
-cpu::op_handler cpu::OR_VX_VY
+constexpr cpu::op_handler cpu::OR_VX_VY
 {
     { 0x8, DATA, DATA, 0x1 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -206,7 +212,7 @@ cpu::op_handler cpu::OR_VX_VY
 
 // 0x8xy2 - AND Vx, Vy
 // Set Vx = Vx AND Vy.
-cpu::op_handler cpu::AND_VX_VY
+constexpr cpu::op_handler cpu::AND_VX_VY
 {
     { 0x8, DATA, DATA, 0x2 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -222,7 +228,7 @@ cpu::op_handler cpu::AND_VX_VY
 
 // 0x8xy3 - XOR Vx, Vy
 // Set Vx = Vx XOR Vy.
-cpu::op_handler cpu::XOR_VX_VY
+constexpr cpu::op_handler cpu::XOR_VX_VY
 {
     { 0x8, DATA, DATA, 0x3 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -239,7 +245,7 @@ cpu::op_handler cpu::XOR_VX_VY
 // 0x8xy4 - ADD Vx, Vy
 // Set Vx = Vx + Vy.
 // If the result is greater than 8 bits (i.e., > 255,) VF (carry) is set to 1, other
-cpu::op_handler cpu::ADD_VX_VY
+constexpr cpu::op_handler cpu::ADD_VX_VY
 {
     { 0x8, DATA, DATA, 0x4 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -262,7 +268,7 @@ cpu::op_handler cpu::ADD_VX_VY
 // Set Vx = Vx - Vy, set VF = NOT borrow.
 //
 // If Vx > Vy, then VF is set to 1, otherwise 0. Then Vy is subtracted from Vx, and the results stored in Vx.
-cpu::op_handler cpu::SUB_VX_VY
+constexpr cpu::op_handler cpu::SUB_VX_VY
 {
     { 0x8, DATA, DATA, 0x5 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -283,7 +289,7 @@ cpu::op_handler cpu::SUB_VX_VY
 // Set Vx = Vx SHR 1.
 //
 // Before this, if the least-significant bit of Vx (before shift) is 1, then VF is set to 1, otherwise 0. Then Vx is divided by 2.
-cpu::op_handler cpu::SHR_VX_VY
+constexpr cpu::op_handler cpu::SHR_VX_VY
 {
     { 0x8, DATA, DATA, 0x6 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -303,7 +309,7 @@ cpu::op_handler cpu::SHR_VX_VY
 // Set Vx = Vy - Vx, set VF = NOT borrow.
 //
 // If Vy > Vx, then VF is set to 1, otherwise 0. Then Vx is subtracted from Vy, and the results stored in Vx.
-cpu::op_handler cpu::SUBN_VX_VY
+constexpr cpu::op_handler cpu::SUBN_VX_VY
 {
     { 0x8, DATA, DATA, 0x7 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -325,7 +331,7 @@ cpu::op_handler cpu::SUBN_VX_VY
 // Set Vx = Vx SHR 1.
 //
 // Before this, if the most-significant bit of Vx (before shift) is 1, then VF is set to 1, otherwise 0. Then Vx is divided by 2.
-cpu::op_handler cpu::SHL_VX_VY
+constexpr cpu::op_handler cpu::SHL_VX_VY
 {
     { 0x8, DATA, DATA, 0xE },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -345,7 +351,7 @@ cpu::op_handler cpu::SHL_VX_VY
 // Skip next instruction if Vx != Vy.
 //
 // The values of Vx and Vy are compared, and if they are not equal, the program counter is increased by 2.
-cpu::op_handler cpu::SNE_VX_VY
+constexpr cpu::op_handler cpu::SNE_VX_VY
 {
     { 0x9, DATA, DATA, 0x0 },
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -362,7 +368,7 @@ cpu::op_handler cpu::SNE_VX_VY
 
 // Annn - LD I, addr
 // Set I = nnn.
-cpu::op_handler cpu::LD_I_NNN
+constexpr cpu::op_handler cpu::LD_I_NNN
 {
     {0xA, DATA, DATA, DATA},
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -378,7 +384,7 @@ cpu::op_handler cpu::LD_I_NNN
 
 // Bnnn - JP V0, addr
 // Jump to location nnn + V0.
-cpu::op_handler cpu::JP_V0_NNN
+constexpr cpu::op_handler cpu::JP_V0_NNN
 {
     {0xB, DATA, DATA, DATA},
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -394,15 +400,12 @@ cpu::op_handler cpu::JP_V0_NNN
 
 // Cxkk - RND Vx, byte
 // Set Vx = random byte AND kk.
-cpu::op_handler cpu::RND_VX_KK
+constexpr cpu::op_handler cpu::RND_VX_KK
 {
     {0xC, DATA, DATA, DATA},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-        std::default_random_engine random(std::random_device{}());
-        std::uniform_int_distribution<std::uint8_t> dist{ 0, 255 };
-
-        cpu.m_gpr[operands.m_x] = (dist(random) & operands.m_kk);
+        cpu.m_gpr[operands.m_x] = (cpu.next_random() & operands.m_kk);
     },
 
     [](const cpu::operand_data &operands, std::stringstream &ss)
@@ -413,17 +416,19 @@ cpu::op_handler cpu::RND_VX_KK
 
 // Dxyn - DRW Vx, Vy, nibble
 // Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
-cpu::op_handler cpu::DRW_VX_VY_N
+constexpr cpu::op_handler cpu::DRW_VX_VY_N
 {
     { 0xD, DATA, DATA, DATA },
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-        int x = cpu.m_gpr[operands.m_x];
-        int y = cpu.m_gpr[operands.m_y];
+        // the starting position wraps as well as the sprite itself
+        int x = cpu.m_gpr[operands.m_x] % 64;
+        int y = cpu.m_gpr[operands.m_y] % 32;
         cpu.m_gpr[0xF] = 0;
         for(int n = 0; n < operands.m_n; n++)
         {
-            std::uint8_t line = cpu.m_ram.at(cpu.m_i + n);
+            // sprite data past the end of RAM wraps around to 0x000
+            std::uint8_t line = cpu.m_ram[(cpu.m_i + n) & 0xFFF];
             std::bitset<8> sprite_byte(line);
 
             for(int i = 0; i < 8 ; i++)
@@ -439,7 +444,7 @@ cpu::op_handler cpu::DRW_VX_VY_N
                 x += 1;
                 x %= 64;
             }
-            x = cpu.m_gpr[operands.m_x];
+            x = cpu.m_gpr[operands.m_x] % 64;
             y++;
             y %= 32;
 
@@ -449,17 +454,19 @@ cpu::op_handler cpu::DRW_VX_VY_N
     [](const cpu::operand_data &operands, std::stringstream &ss)
     {
         ss << "DRW " << nchip8::V << operands.m_x << ", " << nchip8::V << operands.m_y << ", " << nchip8::n << operands.m_n;
-    }
+    },
+
+    stop_on_frame
 };
 
 // Ex9E - SKP Vx
 // Skip next instruction if key with the value of Vx is pressed.
-cpu::op_handler cpu::SKP_VX
+constexpr cpu::op_handler cpu::SKP_VX
 {
     {0xE, DATA, 0x9, 0xE},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-        if(cpu.m_keys_down.at(cpu.m_gpr[operands.m_x]))
+        if((cpu.m_keys_down.load(std::memory_order_relaxed) >> (cpu.m_gpr[operands.m_x] & 0xF)) & 1)
         {
             cpu.m_pc += 0x4;
         }
@@ -473,12 +480,12 @@ cpu::op_handler cpu::SKP_VX
 
 // ExA1 - SKNP Vx
 // Skip next instruction if key with the value of Vx is not pressed.
-cpu::op_handler cpu::SKNP_VX
+constexpr cpu::op_handler cpu::SKNP_VX
 {
     {0xE, DATA, 0xA, 0x1},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-        if(!cpu.m_keys_down.at(cpu.m_gpr[operands.m_x]))
+        if(!((cpu.m_keys_down.load(std::memory_order_relaxed) >> (cpu.m_gpr[operands.m_x] & 0xF)) & 1))
         {
             cpu.m_pc += 0x4;
         }
@@ -492,12 +499,12 @@ cpu::op_handler cpu::SKNP_VX
 
 // Fx07 - LD Vx, DT
 // Set Vx = delay timer value.
-cpu::op_handler cpu::LD_VX_DT
+constexpr cpu::op_handler cpu::LD_VX_DT
 {
     {0xF, DATA, 0x0, 0x7},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-        cpu.m_gpr[operands.m_x] = cpu.m_dt;
+        cpu.m_gpr[operands.m_x] = cpu.get_dt();
     },
 
     [](const cpu::operand_data &operands, std::stringstream &ss)
@@ -508,20 +515,17 @@ cpu::op_handler cpu::LD_VX_DT
 
 // Fx0A - LD Vx, K
 // Wait for a key press, store the value of the key in Vx.
-cpu::op_handler cpu::LD_VX_K
+constexpr cpu::op_handler cpu::LD_VX_K
 {
     {0xF, DATA, 0x0, 0xA},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
-         // wait for the value of key to change to valid
-        while(cpu.m_last_key_down == std::nullopt)
-        {
+        // never blocks, dispatchers don't execute this until a key is down (see cpu::is_waiting_for_key)
+        const std::uint8_t key = cpu.m_last_key_down.load(std::memory_order_acquire);
 
-        }
-
-        if(cpu.m_last_key_down.has_value())
+        if(key != cpu::no_key)
         {
-            cpu.m_gpr[operands.m_x] = cpu.m_last_key_down.value();
+            cpu.m_gpr[operands.m_x] = key;
         }
     },
 
@@ -533,11 +537,12 @@ cpu::op_handler cpu::LD_VX_K
 
 // Fx15 - LD DT, Vx
 // Set delay timer = Vx.
-cpu::op_handler cpu::LD_DT_VX
+constexpr cpu::op_handler cpu::LD_DT_VX
 {
     {0xF, DATA, 0x1, 0x5},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
+        cpu.sync_timers();
         cpu.m_dt = cpu.m_gpr[operands.m_x];
     },
 
@@ -549,25 +554,28 @@ cpu::op_handler cpu::LD_DT_VX
 
 // Fx18 - LD ST, Vx
 // Set sound timer = Vx.
-cpu::op_handler cpu::LD_ST_VX
+constexpr cpu::op_handler cpu::LD_ST_VX
 {
     {0xF, DATA, 0x1, 0x8},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
+        cpu.sync_timers();
         cpu.m_st = cpu.m_gpr[operands.m_x];
     },
 
     [](const cpu::operand_data &operands, std::stringstream &ss)
     {
         ss << "LD ST, " << nchip8::V << operands.m_x;
-    }
+    },
+
+    stop_on_sound
 };
 
 // Fx1E - ADD I, Vx
 // Set I = I + Vx.
 //
 // The values of I and Vx are added, and the results are stored in I.
-cpu::op_handler cpu::ADD_I_VX
+constexpr cpu::op_handler cpu::ADD_I_VX
 {
     {0xF, DATA, 0x1, 0xE},
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -584,7 +592,7 @@ cpu::op_handler cpu::ADD_I_VX
 //
 // Fx29 - LD F, Vx
 // Set I = location of sprite for digit Vx.
-cpu::op_handler cpu::LD_F_VX
+constexpr cpu::op_handler cpu::LD_F_VX
 {
     {0xF, DATA, 0x2, 0x9},
     [](cpu &cpu, const cpu::operand_data &operands)
@@ -602,15 +610,16 @@ cpu::op_handler cpu::LD_F_VX
 
 // Fx33 - LD B, Vx
 // stores BCD representation of VX in I, I+1, I+2
-cpu::op_handler cpu::LD_B_VX
+constexpr cpu::op_handler cpu::LD_B_VX
 {
     {0xF, DATA, 0x3, 0x3},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
         std::uint8_t& val = cpu.m_gpr[operands.m_x];
-        cpu.m_ram[cpu.m_i + 2] = val % 10;          // ones digit
-        cpu.m_ram[cpu.m_i + 1] = (val / 10) % 10;   // tens digit
-        cpu.m_ram[cpu.m_i]     = (val / 100);       // hundreds digit
+        cpu.m_ram[(cpu.m_i + 2) & 0xFFF] = val % 10;          // ones digit
+        cpu.m_ram[(cpu.m_i + 1) & 0xFFF] = (val / 10) % 10;   // tens digit
+        cpu.m_ram[cpu.m_i & 0xFFF]       = (val / 100);       // hundreds digit
+        cpu.mark_ram_written(cpu.m_i, 3);
     },
 
     [](const cpu::operand_data &operands, std::stringstream &ss)
@@ -623,16 +632,18 @@ cpu::op_handler cpu::LD_B_VX
 //Store registers V0 through Vx in memory starting at location I.
 //
 //The interpreter copies the values of registers V0 through Vx into memory, starting at the address in I.
-cpu::op_handler cpu::LD_imm_I_VX
+constexpr cpu::op_handler cpu::LD_imm_I_VX
 {
     {0xF, DATA, 0x5, 0x5},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
         for(int i = 0; i <= operands.m_x; ++i)
         {
-            cpu.m_ram[cpu.m_i + i] = cpu.m_gpr[i];
+            cpu.m_ram[(cpu.m_i + i) & 0xFFF] = cpu.m_gpr[i];
         }
 
+        cpu.mark_ram_written(cpu.m_i, operands.m_x + 1);
+
         //cpu.m_i += operands.m_x + 1;
     },
 
@@ -646,14 +657,14 @@ cpu::op_handler cpu::LD_imm_I_VX
 //Read registers V0 through Vx from memory starting at location I.
 //
 //The interpreter reads values from memory starting at location I into registers V0 through Vx.
-cpu::op_handler cpu::LD_VX_imm_I
+constexpr cpu::op_handler cpu::LD_VX_imm_I
 {
     {0xF, DATA, 0x6, 0x5},
     [](cpu &cpu, const cpu::operand_data &operands)
     {
         for(int i = 0; i <= operands.m_x; ++i)
         {
-            cpu.m_gpr[i] = cpu.m_ram[cpu.m_i + i];
+            cpu.m_gpr[i] = cpu.m_ram[(cpu.m_i + i) & 0xFFF];
         }
 
         //cpu.m_i += operands.m_x + 1;
@@ -665,5 +676,194 @@ cpu::op_handler cpu::LD_VX_imm_I
     }
 };
 
+//! @brief      The decode table, shared by every cpu and built entirely at compile time
+//! @details    No CHIP-8 instruction is distinguished by its X nibble alone,
+//!             so the table is indexed by the other three nibbles, 0xAXCD -> 0xACD.
+//!             The few instructions that do fix X (e.g. 00E0 CLS) are confirmed
+//!             against their full mask/value pair after the lookup.
+struct cpu::decode_table
+{
+    //! Every handler the decoder knows about, index 0 is reserved for "no handler"
+    static constexpr const op_handler* handlers[] = {
+        nullptr,
+        &CLS,
+        &RET,
+        // &SYS,
+        &JP,
+        &CALL,
+        &SE_VX_KK,
+        &SNE_VX_KK,
+        &SE_VX_VY,
+        &LD_VX_KK,
+        &ADD_VX_KK,
+        &LD_VX_VY,
+        &OR_VX_VY,
+        &AND_VX_VY,
+        &XOR_VX_VY,
+        &ADD_VX_VY,
+        &SUB_VX_VY,
+        &SHR_VX_VY,
+        &SUBN_VX_VY,
+        &SHL_VX_VY,
+        &SNE_VX_VY,
+        &LD_I_NNN,
+        &JP_V0_NNN,
+        &RND_VX_KK,
+        &DRW_VX_VY_N,
+        &SKP_VX,
+        &SKNP_VX,
+        &LD_VX_DT,
+        &LD_VX_K,
+        &LD_DT_VX,
+        &LD_ST_VX,
+        &ADD_I_VX,
+        &LD_F_VX,
+        &LD_B_VX,
+        &LD_imm_I_VX,
+        &LD_VX_imm_I,
+    };
+
+    static constexpr std::size_t handler_count = sizeof(handlers) / sizeof(handlers[0]);
+
+    //! What each handler is called in get_op_info, indexed by handler
+    static constexpr const char* mnemonics[] = {
+        "???",
+        "CLS",
+        "RET",
+        // "SYS addr",
+        "JP addr",
+        "CALL addr",
+        "SE Vx, byte",
+        "SNE Vx, byte",
+        "SE Vx, Vy",
+        "LD Vx, byte",
+        "ADD Vx, byte",
+        "LD Vx, Vy",
+        "OR Vx, Vy",
+        "AND Vx, Vy",
+        "XOR Vx, Vy",
+        "ADD Vx, Vy",
+        "SUB Vx, Vy",
+        "SHR Vx",
+        "SUBN Vx, Vy",
+        "SHL Vx",
+        "SNE Vx, Vy",
+        "LD I, addr",
+        "JP V0, addr",
+        "RND Vx, byte",
+        "DRW Vx, Vy, n",
+        "SKP Vx",
+        "SKNP Vx",
+        "LD Vx, DT",
+        "LD Vx, K",
+        "LD DT, Vx",
+        "LD ST, Vx",
+        "ADD I, Vx",
+        "LD F, Vx",
+        "LD B, Vx",
+        "LD [I], Vx",
+        "LD Vx, [I]",
+    };
+
+    static_assert(sizeof(mnemonics) / sizeof(mnemonics[0]) == handler_count, "a handler is missing its mnemonic");
+
+    //! Handler index for each 0xACD key
+    std::array<std::uint8_t, 0x1000> m_index;
+
+    //! Bits of the instruction that the handler's encoding fixes, indexed by handler
+    std::array<std::uint16_t, handler_count> m_mask;
+
+    //! Value those fixed bits must have, indexed by handler
+    std::array<std::uint16_t, handler_count> m_value;
+
+    static constexpr decode_table build()
+    {
+        decode_table table {};
+
+        // slot 0 can never match, (instruction & 0) != 1
+        table.m_mask[0] = 0x0000;
+        table.m_value[0] = 0x0001;
+
+        for(std::size_t h = 1; h < handler_count; h++)
+        {
+            const auto &encoding = handlers[h]->m_encoding;
+
+            std::uint16_t mask = 0;
+            std::uint16_t value = 0;
+
+            for(std::size_t nibble = 0; nibble < 4; nibble++)
+            {
+                const unsigned shift = 12 - (nibble * 4);
+
+                if(encoding[nibble].has_value())
+                {
+                    mask |= 0xF << shift;
+                    value |= *encoding[nibble] << shift;
+                }
+            }
+
+            table.m_mask[h] = mask;
+            table.m_value[h] = value;
+        }
+
+        for(std::size_t key = 0; key < 0x1000; key++)
+        {
+            // expand 0xACD back to an instruction with X = 0
+            const std::uint16_t instruction = ((key & 0xF00) << 4) | (key & 0x0FF);
+
+            for(std::size_t h = 1; h < handler_count; h++)
+            {
+                const std::uint16_t mask = table.m_mask[h] & 0xF0FF;
+
+                if((instruction & mask) == (table.m_value[h] & mask))
+                {
+                    table.m_index[key] = h;
+                    break;
+                }
+            }
+        }
+
+        return table;
+    }
+
+    //! @brief Returns the handler index for an instruction, 0 if none decodes it
+    std::uint8_t find(const std::uint16_t &instruction) const
+    {
+        const std::uint8_t h = m_index[((instruction & 0xF000) >> 4) | (instruction & 0x00FF)];
+
+        // confirm any nibbles the key skipped over
+        if((instruction & m_mask[h]) != m_value[h]) { return 0; }
+
+        return h;
+    }
+};
+
+constexpr cpu::decode_table cpu::op_decode_table = cpu::decode_table::build();
+
+const cpu::op_handler* cpu::get_op_handler_for_instruction(const std::uint16_t &instruction)
+{
+    return decode_table::handlers[op_decode_table.find(instruction)];
+}
+
+cpu::op_info cpu::get_op_info(const std::uint16_t &instruction)
+{
+    const std::uint8_t h = op_decode_table.find(instruction);
+    const op_handler* handler = decode_table::handlers[h];
+
+    op_info info;
+    info.m_index = h;
+    info.m_mnemonic = decode_table::mnemonics[h];
+    info.m_conditional_skip = (handler == &SE_VX_KK || handler == &SNE_VX_KK || handler == &SE_VX_VY
+                               || handler == &SNE_VX_VY || handler == &SKP_VX || handler == &SKNP_VX);
+    info.m_jump = (handler == &JP || handler == &JP_V0_NNN);
+
+    return info;
+}
+
+std::size_t cpu::get_op_count()
+{
+    return decode_table::handler_count;
+}
+
 }
-#endif //NCHIP8_OP_HANDLERS_HPP
+#endif //NCHIP8_OP_HANDLERS_HPP
\ No newline at end of file
@@ -0,0 +1,129 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "output_throttle.hpp"
+#include "io.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace nchip8
+{
+
+//! How much longer than the last write blocked for to wait before writing again
+static constexpr int blocked_backoff = 3;
+
+output_throttle::output_throttle(const int &fd, const std::size_t &max_bytes_per_second) :
+    m_fd(fd),
+    m_max_bytes_per_second(max_bytes_per_second),
+    m_last_refill(clock::now())
+{
+
+}
+
+output_throttle::~output_throttle()
+{
+    if(m_io_fd >= 0) { ::close(m_io_fd); }
+}
+
+bool output_throttle::begin_frame()
+{
+    // thread-self is whichever thread opens it, so wait for the one that writes
+    if(!m_io_opened)
+    {
+        m_io_opened = true;
+        m_io_fd = ::open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+
+        if(m_max_bytes_per_second > 0 && !get_thread_bytes_written().has_value())
+        {
+            nchip8::log << "[gui] /proc/thread-self/io can't be read, the output rate cap is off" << '\n';
+        }
+    }
+
+    const clock::time_point now = clock::now();
+
+    bool send = true;
+
+    if(m_max_bytes_per_second > 0)
+    {
+        // refill, holding at most a quarter second of output in reserve
+        const double elapsed = std::chrono::duration<double>(now - m_last_refill).count();
+        m_budget = std::min(m_budget + elapsed * m_max_bytes_per_second, m_max_bytes_per_second / 4.0);
+
+        if(m_budget < 0) { send = false; }
+    }
+
+    m_last_refill = now;
+
+    // the last frame hasn't drained yet, adding another only adds latency
+    int queued = 0;
+    if(::ioctl(m_fd, TIOCOUTQ, &queued) == 0 && queued > 0) { send = false; }
+
+    // a pty always reports an empty queue, a full one shows up as a write that blocked,
+    // back off for a few times as long as it blocked for so the gui spends most of its time drawing
+    if(now - m_write_end < (m_write_end - m_write_start) * blocked_backoff) { send = false; }
+
+    if(!send)
+    {
+        m_frames_dropped++;
+        return false;
+    }
+
+    m_write_start = now;
+    m_written_at_start = get_thread_bytes_written();
+    return true;
+}
+
+void output_throttle::end_frame()
+{
+    m_write_end = clock::now();
+    m_frames_sent++;
+
+    const std::optional<std::uint64_t> written = get_thread_bytes_written();
+    if(!written.has_value() || !m_written_at_start.has_value()) { return; }
+
+    const std::uint64_t bytes = *written - *m_written_at_start;
+
+    m_bytes_sent += bytes;
+    m_budget -= bytes;
+}
+
+std::size_t output_throttle::get_frames_sent() const
+{
+    return m_frames_sent;
+}
+
+std::size_t output_throttle::get_frames_dropped() const
+{
+    return m_frames_dropped;
+}
+
+std::uint64_t output_throttle::get_bytes_sent() const
+{
+    return m_bytes_sent;
+}
+
+std::optional<std::uint64_t> output_throttle::get_thread_bytes_written()
+{
+    // ncurses writes straight to the descriptor, so count what this thread wrote instead
+    if(m_io_fd < 0) { return std::nullopt; }
+
+    char text[512];
+    const ssize_t size = ::pread(m_io_fd, text, sizeof(text) - 1, 0);
+    if(size <= 0) { return std::nullopt; }
+
+    text[size] = '\0';
+
+    const char* field = std::strstr(text, "wchar:");
+    if(field == nullptr) { return std::nullopt; }
+
+    return std::strtoull(field + std::strlen("wchar:"), nullptr, 10);
+}
+
+}
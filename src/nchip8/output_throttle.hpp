@@ -0,0 +1,84 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_OUTPUT_THROTTLE_HPP
+#define NCHIP8_OUTPUT_THROTTLE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace nchip8
+{
+
+//! @brief      Decides which frames are sent to the terminal when it can't keep up
+//! @details    A frame is dropped while the previous one is still queued in the tty (TIOCOUTQ),
+//!             and for as long as the last write blocked for, which is how a full pty shows itself.
+//!             An optional byte rate cap drops frames until enough budget has built up again, it's charged
+//!             what the writing thread wrote according to /proc/thread-self/io, and logs that it's off without it.
+//!             Nothing is lost by dropping, ncurses sends the difference between what the terminal
+//!             shows and the newest frame, so the next frame that goes out is always the latest.
+class output_throttle
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    //! @param fd                   The terminal being written to
+    //! @param max_bytes_per_second Cap on output, 0 = unlimited
+    output_throttle(const int &fd, const std::size_t &max_bytes_per_second);
+
+    virtual ~output_throttle();
+
+    output_throttle(const output_throttle &) = delete;
+    output_throttle& operator=(const output_throttle &) = delete;
+
+    //! @brief      Call before writing a frame, always from the thread that writes them
+    //! @returns    True if the frame should be written, false if it should be dropped
+    bool begin_frame();
+
+    //! @brief      Call after writing a frame, from the thread that wrote it
+    //! @details    Measures how long the write blocked for and how many bytes it was
+    void end_frame();
+
+    //! @brief Returns the number of frames written
+    std::size_t get_frames_sent() const;
+
+    //! @brief Returns the number of frames dropped
+    std::size_t get_frames_dropped() const;
+
+    //! @brief Returns the number of bytes written, 0 if the kernel doesn't account them
+    std::uint64_t get_bytes_sent() const;
+
+private:
+    int m_fd;
+
+    std::size_t m_max_bytes_per_second;
+
+    //! Bytes that may still be sent, goes negative after a big frame
+    double m_budget = 0;
+
+    clock::time_point m_last_refill;
+
+    //! When the last frame started and finished writing
+    clock::time_point m_write_start;
+    clock::time_point m_write_end;
+
+    //! /proc/thread-self/io of the writing thread, opened on the first frame and read with pread, -1 if unreadable
+    int m_io_fd = -1;
+    bool m_io_opened = false;
+
+    //! The writing thread's write counter when the last frame started, if it can be read
+    std::optional<std::uint64_t> m_written_at_start;
+
+    std::size_t m_frames_sent = 0;
+    std::size_t m_frames_dropped = 0;
+    std::uint64_t m_bytes_sent = 0;
+
+    //! @brief Returns the bytes the writing thread has written so far, if the kernel accounts them
+    std::optional<std::uint64_t> get_thread_bytes_written();
+};
+
+}
+
+#endif //NCHIP8_OUTPUT_THROTTLE_HPP
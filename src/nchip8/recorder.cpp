@@ -0,0 +1,210 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "recorder.hpp"
+
+#include <ctime>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+
+namespace nchip8
+{
+
+// half block characters, indexed by (top pixel) | (bottom pixel << 1), same as the gui draws
+static const char* const cell_glyphs[] = { " ", "▀", "▄", "█" };
+
+static unsigned get_cell(const packed_framebuffer &frame, const unsigned &width, const unsigned &x, const unsigned &row)
+{
+    auto pixel = [&](const unsigned &y)
+    {
+        const std::size_t index = y * width + x;
+        return (frame[index / 8] >> (7 - index % 8)) & 1;
+    };
+
+    return pixel(row * 2) | (pixel(row * 2 + 1) << 1);
+}
+
+static std::string json_escape(const std::string &text)
+{
+    std::string escaped;
+    escaped.reserve(text.size() + 16);
+
+    for(const char &c : text)
+    {
+        if(c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if(static_cast<unsigned char>(c) < 0x20)
+        {
+            static const char hex[] = "0123456789abcdef";
+            escaped += "\\u00";
+            escaped += hex[(c >> 4) & 0xF];
+            escaped += hex[c & 0xF];
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+frame_recorder::frame_recorder(const std::string &path, const recording_format &format) :
+    m_format(format),
+    m_out(path, std::ios::binary | std::ios::trunc),
+    m_frames_recorded(0),
+    m_frames_dropped(0),
+    m_stop(false),
+    m_start(clock::now())
+{
+    if(!m_out)
+    {
+        throw std::runtime_error("could not open " + path + " for recording");
+    }
+
+    if(m_format == recording_format::asciicast) { write_asciicast_header(); }
+    else                                        { write_movie_header(); }
+
+    m_encoder_thread = std::thread(&frame_recorder::encoder_thread, this);
+}
+
+frame_recorder::~frame_recorder()
+{
+    m_stop = true;
+    m_encoder_thread.join();
+}
+
+void frame_recorder::publish(const packed_framebuffer &frame, const screen_mode &mode)
+{
+    if(!m_queue.try_push(queued_frame { frame, mode, clock::now() }))
+    {
+        m_frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::size_t frame_recorder::get_frames_recorded() const
+{
+    return m_frames_recorded;
+}
+
+std::size_t frame_recorder::get_frames_dropped() const
+{
+    return m_frames_dropped;
+}
+
+void frame_recorder::encoder_thread()
+{
+    queued_frame frame;
+
+    while(true)
+    {
+        // read before draining, not after: a frame pushed just before m_stop was set is still caught
+        const bool stopping = m_stop;
+
+        while(m_queue.try_pop(frame))
+        {
+            if(m_format == recording_format::asciicast) { write_asciicast_frame(frame); }
+            else                                        { write_movie_frame(frame); }
+
+            m_frames_recorded++;
+        }
+
+        // caught up, get it onto disk
+        m_out.flush();
+
+        if(stopping) { return; }
+
+        // polled rather than notified, so publish() never has to touch a lock or make a system call
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+void frame_recorder::write_asciicast_header()
+{
+    // https://docs.asciinema.org/manual/asciicast/v2/
+    // sized for hires, 128 columns and two pixel rows per line
+    m_out << "{\"version\": 2, \"width\": 128, \"height\": 32, \"timestamp\": " << std::time(nullptr)
+          << ", \"title\": \"nchip8\", \"env\": {\"TERM\": \"xterm-256color\"}}\n";
+}
+
+void frame_recorder::write_asciicast_frame(const queued_frame &frame)
+{
+    const bool hires = (frame.m_mode == screen_mode::hires_sc8);
+    const unsigned width = hires ? 128 : 64;
+    const unsigned rows = hires ? 32 : 16;
+
+    // first frame or a mode switch: everything, otherwise only the cells that changed
+    const bool full = !m_started || frame.m_mode != m_previous_mode;
+
+    std::string data = full ? "\x1b[?25l\x1b[2J" : "";
+
+    unsigned cursor_row = rows;
+    unsigned cursor_col = 0;
+
+    for(unsigned row = 0; row < rows; row++)
+    {
+        for(unsigned col = 0; col < width; col++)
+        {
+            const unsigned cell = get_cell(frame.m_frame, width, col, row);
+
+            if(full ? (cell == 0) : (cell == get_cell(m_previous, width, col, row))) { continue; }
+
+            // a few unchanged cells are cheaper to rewrite than to jump over
+            if(row == cursor_row && col >= cursor_col && col - cursor_col <= 3)
+            {
+                for(unsigned skipped = cursor_col; skipped < col; skipped++)
+                {
+                    data += cell_glyphs[get_cell(frame.m_frame, width, skipped, row)];
+                }
+            }
+            else
+            {
+                data += "\x1b[" + std::to_string(row + 1) + ';' + std::to_string(col + 1) + 'H';
+            }
+
+            data += cell_glyphs[cell];
+            cursor_row = row;
+            cursor_col = col + 1;
+        }
+    }
+
+    m_previous = frame.m_frame;
+    m_previous_mode = frame.m_mode;
+    m_started = true;
+
+    if(data.empty()) { return; }
+
+    const double seconds = std::chrono::duration<double>(frame.m_time - m_start).count();
+
+    m_out << '[' << std::fixed << std::setprecision(6) << seconds << ", \"o\", \"" << json_escape(data) << "\"]\n";
+}
+
+void frame_recorder::write_movie_header()
+{
+    m_out.write("NC8M", 4);
+}
+
+void frame_recorder::write_movie_frame(const queued_frame &frame)
+{
+    // a keyframe every second of frames so playback can seek
+    std::vector<std::uint8_t> message;
+    m_encoder.encode(frame.m_frame, frame.m_mode, m_encoder.get_sequence() % 60 == 0, message);
+
+    const std::uint32_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(frame.m_time - m_start).count();
+    const std::uint16_t size = message.size();
+
+    const std::uint8_t record[6] = {
+        std::uint8_t(ms), std::uint8_t(ms >> 8), std::uint8_t(ms >> 16), std::uint8_t(ms >> 24),
+        std::uint8_t(size), std::uint8_t(size >> 8)
+    };
+
+    m_out.write(reinterpret_cast<const char*>(record), sizeof(record));
+    m_out.write(reinterpret_cast<const char*>(message.data()), message.size());
+}
+
+}
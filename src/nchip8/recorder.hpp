@@ -0,0 +1,108 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_RECORDER_HPP
+#define NCHIP8_RECORDER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "cpu.hpp"
+#include "frame_stream.hpp"
+#include "framebuffer.hpp"
+#include "spsc_ring.hpp"
+
+namespace nchip8
+{
+
+//! @brief What a recording is written as
+enum class recording_format : std::uint8_t
+{
+    //! asciicast v2, plays back in any asciinema player, only the cells that changed are written per frame
+    asciicast,
+
+    //! A movie of frame stream messages (see frame_header), each preceded by
+    //! a u32 millisecond timestamp and a u16 length, after an "NC8M" magic. A keyframe every second.
+    packed_movie
+};
+
+//! @brief      Records published frames to a file on a background thread
+//! @details    publish() only copies the frame into a lock-free queue, so the cpu thread never waits on
+//!             the encoder or the disk. If the encoder falls behind, frames that don't fit are dropped
+//!             and counted. The file is flushed whenever the encoder catches up, so a session that is
+//!             killed still leaves a playable recording.
+class frame_recorder
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    //! @param path     The file to write, replaced if it exists
+    //! @throws         std::runtime_error if it can't be opened
+    frame_recorder(const std::string &path, const recording_format &format);
+
+    //! @brief Encodes whatever is still queued, then closes the file
+    virtual ~frame_recorder();
+
+    //! @brief      Queues a frame, never blocks
+    //! @details    Only ever call from one thread
+    void publish(const packed_framebuffer &frame, const screen_mode &mode);
+
+    //! @brief Returns the number of frames written
+    std::size_t get_frames_recorded() const;
+
+    //! @brief Returns the number of frames dropped because the queue was full
+    std::size_t get_frames_dropped() const;
+
+private:
+    //! @brief A frame waiting to be encoded
+    struct queued_frame
+    {
+        packed_framebuffer m_frame;
+        screen_mode m_mode;
+        clock::time_point m_time;
+    };
+
+    recording_format m_format;
+
+    std::ofstream m_out;
+
+    spsc_ring<queued_frame, 64> m_queue;
+
+    std::atomic<std::size_t> m_frames_recorded;
+    std::atomic<std::size_t> m_frames_dropped;
+
+    //! Set by the destructor, the encoder drains the queue and exits
+    std::atomic<bool> m_stop;
+
+    //! When recording started, timestamps are relative to it
+    clock::time_point m_start;
+
+    //! asciicast: the last frame written, and whether anything has been written yet
+    packed_framebuffer m_previous {};
+    screen_mode m_previous_mode = screen_mode::lores_c8;
+    bool m_started = false;
+
+    //! packed movie: deltas against the previous frame
+    frame_encoder m_encoder;
+
+    //! Thread object for void encoder_thread()
+    std::thread m_encoder_thread;
+
+    //! @brief Encodes queued frames until m_stop is set and the queue is empty
+    void encoder_thread();
+
+    void write_asciicast_header();
+    void write_asciicast_frame(const queued_frame &frame);
+
+    void write_movie_header();
+    void write_movie_frame(const queued_frame &frame);
+};
+
+}
+
+#endif //NCHIP8_RECORDER_HPP
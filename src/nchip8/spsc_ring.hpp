@@ -0,0 +1,73 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_SPSC_RING_HPP
+#define NCHIP8_SPSC_RING_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace nchip8
+{
+
+//! @brief      Fixed size lock-free queue for exactly one producer thread and one consumer thread
+//! @details    Neither side ever blocks or makes a system call, a full push or an empty pop just fails.
+//!             Each side keeps a cached copy of the other's index so it only touches the other's
+//!             cache line when it looks full (or empty).
+template<typename T, std::size_t Capacity>
+class spsc_ring
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    //! @brief      Producer only
+    //! @returns    False if the queue is full, the item is not queued
+    bool try_push(const T &item)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+
+        if(head - m_tail_cache == Capacity)
+        {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if(head - m_tail_cache == Capacity) { return false; }
+        }
+
+        m_items[head & (Capacity - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! @brief      Consumer only
+    //! @returns    False if the queue is empty
+    bool try_pop(T &item)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if(tail == m_head_cache)
+        {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if(tail == m_head_cache) { return false; }
+        }
+
+        item = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    //! Producer side, the next slot to write and the last tail it saw
+    alignas(64) std::atomic<std::size_t> m_head { 0 };
+    std::size_t m_tail_cache = 0;
+
+    //! Consumer side, the next slot to read and the last head it saw
+    alignas(64) std::atomic<std::size_t> m_tail { 0 };
+    std::size_t m_head_cache = 0;
+
+    alignas(64) std::array<T, Capacity> m_items;
+};
+
+}
+
+#endif //NCHIP8_SPSC_RING_HPP
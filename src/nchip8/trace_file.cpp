@@ -0,0 +1,340 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#include "trace_file.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace nchip8
+{
+
+//! Full blocks the writer thread may fall behind by before blocks are dropped
+static constexpr std::size_t max_queued_blocks = 32;
+
+static void put_le(std::uint8_t* out, const std::uint64_t &value, const unsigned &bytes)
+{
+    for(unsigned b = 0; b < bytes; b++)
+    {
+        out[b] = (value >> (8 * b)) & 0xFF;
+    }
+}
+
+static std::uint64_t get_le(const std::uint8_t* in, const unsigned &bytes)
+{
+    std::uint64_t value = 0;
+
+    for(unsigned b = 0; b < bytes; b++)
+    {
+        value |= std::uint64_t(in[b]) << (8 * b);
+    }
+
+    return value;
+}
+
+trace_writer::trace_writer(const std::string &path, const std::size_t &block_size) :
+    m_fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)),
+    m_block_size(std::max<std::size_t>(block_size, 64)),
+    m_records(0),
+    m_records_dropped(0),
+    m_bytes_written(0)
+{
+    if(m_fd < 0)
+    {
+        throw std::runtime_error("could not open " + path + " for tracing");
+    }
+
+    std::uint8_t header[trace_format::file_header_size];
+    std::memcpy(header, trace_format::file_magic, 4);
+    put_le(header + 4, trace_format::version, 4);
+
+    if(::write(m_fd, header, sizeof(header)) != sizeof(header))
+    {
+        ::close(m_fd);
+        throw std::runtime_error("could not write " + path);
+    }
+
+    m_bytes_written = sizeof(header);
+
+    begin_block();
+    m_writer_thread = std::thread(&trace_writer::writer_thread, this);
+}
+
+trace_writer::~trace_writer()
+{
+    if(m_block_records > 0) { end_block(); }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_one();
+    m_writer_thread.join();
+
+    ::close(m_fd);
+}
+
+void trace_writer::record(const std::uint16_t &pc, const std::uint16_t &opcode, const std::uint64_t &cycle)
+{
+    using namespace trace_format;
+
+    const std::uint16_t address = pc & 0xFFF;
+    const std::uint16_t step = (address - m_pc) & 0xFFF;
+    const std::uint64_t delta = cycle - m_cycle - 1;
+    const bool known = (m_known[address] == opcode);
+
+    // the next instruction, nothing new about it: fold it into the last tag
+    if(step == 2 && known && delta == 0 && m_can_repeat && (m_block[m_last_tag] >> 4) < max_repeat)
+    {
+        m_block[m_last_tag] += 0x10;
+    }
+    else
+    {
+        m_last_tag = m_block.size();
+        m_block.push_back(0);
+
+        std::uint8_t tag = 0;
+        const int instructions = (static_cast<int>(address) - m_pc) / 2;
+
+        if(step == 2)                   { tag = pc_next; }
+        else if(step == 4)              { tag = pc_skip; }
+        else if((address - m_pc) % 2 == 0 && instructions >= INT8_MIN && instructions <= INT8_MAX)
+        {
+            tag = pc_relative;
+            m_block.push_back(static_cast<std::uint8_t>(instructions));
+        }
+        else
+        {
+            tag = pc_absolute;
+            m_block.push_back(address & 0xFF);
+            m_block.push_back(address >> 8);
+        }
+
+        if(!known)
+        {
+            tag |= has_opcode;
+            m_block.push_back(opcode >> 8);
+            m_block.push_back(opcode & 0xFF);
+            m_known[address] = opcode;
+        }
+
+        if(delta != 0)
+        {
+            tag |= has_cycles;
+
+            for(std::uint64_t rest = delta; ; rest >>= 7)
+            {
+                const std::uint8_t byte = rest & 0x7F;
+                m_block.push_back((rest >> 7) ? (byte | 0x80) : byte);
+                if(!(rest >> 7)) { break; }
+            }
+        }
+
+        m_block[m_last_tag] = tag;
+        m_can_repeat = true;
+    }
+
+    m_pc = address;
+    m_cycle = cycle;
+    m_block_records++;
+    m_records.fetch_add(1, std::memory_order_relaxed);
+
+    if(m_block.size() - block_header_size >= m_block_size)
+    {
+        end_block();
+        begin_block();
+    }
+}
+
+std::uint64_t trace_writer::get_records() const
+{
+    return m_records;
+}
+
+std::uint64_t trace_writer::get_records_dropped() const
+{
+    return m_records_dropped;
+}
+
+std::uint64_t trace_writer::get_bytes_written() const
+{
+    return m_bytes_written;
+}
+
+void trace_writer::begin_block()
+{
+    using namespace trace_format;
+
+    // the header is built aside and copied in, end_block fills in its size and record count.
+    // (resizing the empty vector instead sets off a bogus -Wstringop-overflow under LTO)
+    std::array<std::uint8_t, block_header_size> header {};
+    std::memcpy(header.data(), block_magic, 4);
+    put_le(header.data() + 12, m_pc, 2);
+    put_le(header.data() + 16, m_cycle, 8);
+
+    m_block.clear();
+    m_block.reserve(block_header_size + m_block_size + 32);
+    m_block.insert(m_block.end(), header.begin(), header.end());
+
+    m_block_records = 0;
+    m_can_repeat = false;
+    m_known.fill(unknown);
+}
+
+void trace_writer::end_block()
+{
+    put_le(m_block.data() + 4, m_block.size() - trace_format::block_header_size, 4);
+    put_le(m_block.data() + 8, m_block_records, 4);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if(m_full.size() >= max_queued_blocks)
+        {
+            m_records_dropped += m_block_records;
+            return;
+        }
+
+        m_full.emplace_back(std::move(m_block), m_block_records);
+    }
+
+    m_wake.notify_one();
+    m_block = std::vector<std::uint8_t>();
+}
+
+void trace_writer::writer_thread()
+{
+    std::vector<std::pair<std::vector<std::uint8_t>, std::uint32_t>> blocks;
+
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_stop || !m_full.empty(); });
+
+            if(m_full.empty()) { return; }
+            std::swap(blocks, m_full);
+        }
+
+        // everything waiting goes out in as few system calls as possible
+        std::vector<iovec> pieces;
+        for(auto &block : blocks)
+        {
+            pieces.push_back({ block.first.data(), block.first.size() });
+        }
+
+        std::size_t first = 0;
+        while(first < pieces.size())
+        {
+            const int count = std::min<std::size_t>(pieces.size() - first, IOV_MAX);
+            const ssize_t wrote = ::writev(m_fd, pieces.data() + first, count);
+
+            if(wrote <= 0)
+            {
+                // the disk is gone, what's left is lost
+                for(std::size_t b = first; b < blocks.size(); b++) { m_records_dropped += blocks[b].second; }
+                break;
+            }
+
+            m_bytes_written += wrote;
+
+            // step over what was written, part of a block may be left
+            for(std::size_t left = wrote; left > 0;)
+            {
+                const std::size_t taken = std::min(left, pieces[first].iov_len);
+                pieces[first].iov_base = static_cast<std::uint8_t*>(pieces[first].iov_base) + taken;
+                pieces[first].iov_len -= taken;
+                left -= taken;
+
+                if(pieces[first].iov_len == 0) { first++; }
+            }
+        }
+
+        blocks.clear();
+    }
+}
+
+trace_file::trace_file(const std::string &path)
+{
+    using namespace trace_format;
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) { throw std::runtime_error("could not open " + path); }
+
+    struct stat info {};
+    if(::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(file_header_size))
+    {
+        ::close(fd);
+        throw std::runtime_error(path + " is not a trace file");
+    }
+
+    m_size = info.st_size;
+    void* mapped = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if(mapped == MAP_FAILED) { throw std::runtime_error("could not map " + path); }
+
+    m_data = static_cast<const std::uint8_t*>(mapped);
+
+    // each decoder reads its blocks front to back
+    ::madvise(mapped, m_size, MADV_SEQUENTIAL);
+
+    if(std::memcmp(m_data, file_magic, 4) != 0 || get_le(m_data + 4, 4) != version)
+    {
+        ::munmap(mapped, m_size);
+        throw std::runtime_error(path + " is not a trace file");
+    }
+
+    for(std::size_t offset = file_header_size; offset + block_header_size <= m_size;)
+    {
+        const std::uint8_t* header = m_data + offset;
+        const std::uint32_t size = get_le(header + 4, 4);
+
+        if(std::memcmp(header, block_magic, 4) != 0 || offset + block_header_size + size > m_size) { break; }
+
+        m_blocks.push_back({ offset, size,
+                             static_cast<std::uint32_t>(get_le(header + 8, 4)),
+                             static_cast<std::uint16_t>(get_le(header + 12, 2)),
+                             get_le(header + 16, 8) });
+
+        offset += block_header_size + size;
+    }
+}
+
+trace_file::~trace_file()
+{
+    ::munmap(const_cast<std::uint8_t*>(m_data), m_size);
+}
+
+const std::vector<trace_file::block_info>& trace_file::get_blocks() const
+{
+    return m_blocks;
+}
+
+std::uint64_t trace_file::get_records() const
+{
+    std::uint64_t records = 0;
+
+    for(const block_info &block : m_blocks)
+    {
+        records += block.m_records;
+    }
+
+    return records;
+}
+
+std::size_t trace_file::get_size() const
+{
+    return m_size;
+}
+
+}
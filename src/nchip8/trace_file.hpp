@@ -0,0 +1,257 @@
+//
+// Created by ocanty on 17/10/26.
+//
+
+#ifndef NCHIP8_TRACE_FILE_HPP
+#define NCHIP8_TRACE_FILE_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nchip8
+{
+
+//! @brief One executed instruction
+struct trace_record
+{
+    std::uint16_t m_pc;
+    std::uint16_t m_opcode;
+
+    //! get_cycles() after it ran, a gap of more than one cycle was spent waiting (e.g. on LD Vx, K)
+    std::uint64_t m_cycle;
+};
+
+//! @brief      The on-disk trace format
+//! @details    An 8 byte file header ("N8TR", u32 version), then blocks. Each block is a 24 byte header
+//!             ("N8TB", u32 payload size, u32 records, u16 pc and u64 cycle of the record before the first)
+//!             followed by its records, and decodes on its own, so blocks can be analysed in parallel.
+//!
+//!             A record is a tag byte and whatever it says follows:
+//!             - bits 0-1, the pc: 0 = the next instruction, 1 = the one after (a skip),
+//!               2 = an int8 of instructions follows, 3 = a u16 address follows
+//!             - bit 2, a u16 opcode follows, only when it differs from the last one seen at that pc in the block
+//!             - bit 3, a varint of the cycle delta minus one follows, otherwise the delta is one
+//!             - bits 4-7, this many more records follow with no bytes of their own: the next instruction,
+//!               the opcode already seen there, a delta of one
+//!
+//!             Straight-line code costs under a byte per instruction, a jump a few.
+namespace trace_format
+{
+    static constexpr char file_magic[4] = { 'N', '8', 'T', 'R' };
+    static constexpr char block_magic[4] = { 'N', '8', 'T', 'B' };
+    static constexpr std::uint32_t version = 1;
+
+    static constexpr std::size_t file_header_size = 8;
+    static constexpr std::size_t block_header_size = 24;
+
+    static constexpr std::uint8_t pc_next = 0;
+    static constexpr std::uint8_t pc_skip = 1;
+    static constexpr std::uint8_t pc_relative = 2;
+    static constexpr std::uint8_t pc_absolute = 3;
+    static constexpr std::uint8_t has_opcode = 1 << 2;
+    static constexpr std::uint8_t has_cycles = 1 << 3;
+    static constexpr std::uint8_t max_repeat = 15;
+
+    //! Opcodes seen at each address in the current block, unknown = not yet seen
+    static constexpr std::uint32_t unknown = 0xFFFFFFFF;
+    using opcode_table = std::array<std::uint32_t, 0x1000>;
+}
+
+//! @brief      Writes a trace file from the cpu thread, the disk is left to a background thread
+//! @details    record() encodes into the current block, full blocks are handed to the writer thread,
+//!             which gathers everything waiting into one writev. If the disk falls so far behind that
+//!             the queue is full, the block is dropped (and counted) rather than blocking emulation,
+//!             the blocks either side still decode.
+class trace_writer
+{
+public:
+    //! @param path         The file to write, replaced if it exists
+    //! @param block_size   Payload bytes per block
+    //! @throws             std::runtime_error if it can't be opened
+    explicit trace_writer(const std::string &path, const std::size_t &block_size = 256 * 1024);
+
+    //! @brief Writes the last partial block and closes the file
+    virtual ~trace_writer();
+
+    //! @brief      Appends an executed instruction
+    //! @details    Only ever call from one thread
+    void record(const std::uint16_t &pc, const std::uint16_t &opcode, const std::uint64_t &cycle);
+
+    //! @brief Returns the number of records taken so far
+    std::uint64_t get_records() const;
+
+    //! @brief Returns the number of records lost with dropped blocks
+    std::uint64_t get_records_dropped() const;
+
+    //! @brief Returns the number of bytes written to the file so far
+    std::uint64_t get_bytes_written() const;
+
+private:
+    int m_fd;
+
+    std::size_t m_block_size;
+
+    //! Producer only: the block being filled, header included, and the state its records are relative to
+    std::vector<std::uint8_t> m_block;
+    std::uint32_t m_block_records = 0;
+    std::size_t m_last_tag = 0;
+    bool m_can_repeat = false;
+    trace_format::opcode_table m_known;
+
+    std::uint16_t m_pc = 0;
+    std::uint64_t m_cycle = 0;
+
+    std::atomic<std::uint64_t> m_records;
+    std::atomic<std::uint64_t> m_records_dropped;
+    std::atomic<std::uint64_t> m_bytes_written;
+
+    //! Guards m_full and m_stop
+    std::mutex m_mutex;
+
+    //! The writer thread waits on this for blocks
+    std::condition_variable m_wake;
+
+    //! Blocks waiting to be written, with how many records each holds
+    std::vector<std::pair<std::vector<std::uint8_t>, std::uint32_t>> m_full;
+
+    bool m_stop = false;
+
+    //! Thread object for void writer_thread()
+    std::thread m_writer_thread;
+
+    //! @brief Writes blocks as they arrive until m_stop is set and there are none left
+    void writer_thread();
+
+    //! @brief Starts a new block relative to the current pc and cycle
+    void begin_block();
+
+    //! @brief Fills in the current block's header and queues it
+    void end_block();
+};
+
+//! @brief      Reads a trace file through a read-only mapping
+//! @details    Blocks are indexed up front, decode_block can then be called for different blocks from any number of
+//!             threads at once. A block cut short (e.g. the session was killed mid-write) ends the index.
+class trace_file
+{
+public:
+    //! @brief Where a block is and where it starts from
+    struct block_info
+    {
+        std::size_t m_offset;
+        std::uint32_t m_size;
+        std::uint32_t m_records;
+        std::uint16_t m_pc;
+        std::uint64_t m_cycle;
+    };
+
+    //! @throws std::runtime_error if it can't be read or isn't a trace
+    explicit trace_file(const std::string &path);
+
+    virtual ~trace_file();
+
+    trace_file(const trace_file &) = delete;
+    trace_file& operator=(const trace_file &) = delete;
+
+    const std::vector<block_info>& get_blocks() const;
+
+    //! @brief Returns the total records in every complete block
+    std::uint64_t get_records() const;
+
+    //! @brief Returns the size of the file
+    std::size_t get_size() const;
+
+    //! @brief          Calls on_record(const trace_record &) for every record in a block, in order
+    //! @returns        False if the block is malformed, records up to that point have been passed on
+    template<typename F>
+    bool decode_block(const std::size_t &index, F &&on_record) const
+    {
+        using namespace trace_format;
+
+        const block_info &block = m_blocks.at(index);
+        const std::uint8_t* data = m_data + block.m_offset + block_header_size;
+        const std::uint8_t* end = data + block.m_size;
+
+        opcode_table known;
+        known.fill(unknown);
+
+        trace_record record { block.m_pc, 0, block.m_cycle };
+
+        while(data < end)
+        {
+            const std::uint8_t tag = *data++;
+
+            switch(tag & 0x3)
+            {
+                case pc_next:       record.m_pc += 2; break;
+                case pc_skip:       record.m_pc += 4; break;
+                case pc_relative:
+                    if(data + 1 > end) { return false; }
+                    record.m_pc += 2 * static_cast<std::int8_t>(*data++);
+                    break;
+                case pc_absolute:
+                    if(data + 2 > end) { return false; }
+                    record.m_pc = data[0] | (data[1] << 8);
+                    data += 2;
+                    break;
+            }
+
+            record.m_pc &= 0xFFF;
+
+            if(tag & has_opcode)
+            {
+                if(data + 2 > end) { return false; }
+                known[record.m_pc] = (data[0] << 8) | data[1];
+                data += 2;
+            }
+
+            if(known[record.m_pc] == unknown) { return false; }
+            record.m_opcode = known[record.m_pc];
+
+            std::uint64_t delta = 0;
+            if(tag & has_cycles)
+            {
+                for(unsigned shift = 0; ; shift += 7)
+                {
+                    if(data >= end || shift > 63) { return false; }
+
+                    const std::uint8_t byte = *data++;
+                    delta |= std::uint64_t(byte & 0x7F) << shift;
+                    if(!(byte & 0x80)) { break; }
+                }
+            }
+
+            record.m_cycle += delta + 1;
+            on_record(static_cast<const trace_record&>(record));
+
+            for(unsigned repeat = tag >> 4; repeat > 0; repeat--)
+            {
+                record.m_pc = (record.m_pc + 2) & 0xFFF;
+                if(known[record.m_pc] == unknown) { return false; }
+
+                record.m_opcode = known[record.m_pc];
+                record.m_cycle++;
+                on_record(static_cast<const trace_record&>(record));
+            }
+        }
+
+        return true;
+    }
+
+private:
+    const std::uint8_t* m_data = nullptr;
+    std::size_t m_size = 0;
+
+    std::vector<block_info> m_blocks;
+};
+
+}
+
+#endif //NCHIP8_TRACE_FILE_HPP
@@ -0,0 +1,273 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nchip8/nchip8_c.h"
+
+static int failures = 0;
+
+static void expect(const int ok, const char* what)
+{
+    if(!ok)
+    {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/* Steps through each stop condition in turn */
+static const uint8_t stops_rom[] = {
+    0x00, 0xE0,     /* 200: CLS              stop on frame */
+    0xF0, 0x0A,     /* 202: LD V0, K         stop on key wait */
+    0x61, 0x0A,     /* 204: LD V1, 0x0A */
+    0xF1, 0x18,     /* 206: LD ST, V1        stop on sound */
+    0x62, 0x01,     /* 208: LD V2, 0x01      a run steps over a breakpoint it starts on, so not here */
+    0x63, 0x01,     /* 20A: LD V3, 0x01      breakpoint */
+    0x12, 0x0C,     /* 20C: JP 0x20C         halts */
+};
+
+/* Counts DT down from 60, then halts: takes one second of cycles at whatever the clock rate is */
+static const uint8_t second_rom[] = {
+    0x60, 0x3C,     /* 200: LD V0, 60 */
+    0xF0, 0x15,     /* 202: LD DT, V0 */
+    0xF1, 0x07,     /* 204: LD V1, DT */
+    0x31, 0x00,     /* 206: SE V1, 0 */
+    0x12, 0x04,     /* 208: JP 0x204 */
+    0x12, 0x0A,     /* 20A: JP 0x20A */
+};
+
+/* Draws random sprites forever, a different picture for every seed */
+static const uint8_t noise_rom[] = {
+    0xC0, 0x3F,     /* 200: RND V0, 0x3F */
+    0xC1, 0x1F,     /* 202: RND V1, 0x1F */
+    0xC2, 0x0F,     /* 204: RND V2, 0x0F */
+    0xF2, 0x29,     /* 206: LD F, V2 */
+    0xD0, 0x15,     /* 208: DRW V0, V1, 5 */
+    0x12, 0x00,     /* 20A: JP 0x200 */
+};
+
+static nchip8_instance* create_with(const uint8_t* rom, const size_t size)
+{
+    nchip8_instance* instance = nchip8_create();
+    expect(instance != NULL, "nchip8_create");
+
+    if(instance != NULL)
+    {
+        expect(nchip8_load_rom(instance, rom, size) == NCHIP8_OK, "nchip8_load_rom");
+    }
+
+    return instance;
+}
+
+static void expect_stop(nchip8_instance* instance, const uint32_t stop_mask, const uint32_t stop, const char* what)
+{
+    nchip8_run_result result;
+    memset(&result, 0xAA, sizeof(result));
+
+    expect(nchip8_run_cycles(instance, 1000, stop_mask, &result) == NCHIP8_OK && result.stop == stop, what);
+}
+
+static void test_create_and_load(void)
+{
+    uint8_t too_big[0x1000];
+    nchip8_instance* instance = nchip8_create();
+
+    expect(instance != NULL, "nchip8_create");
+    if(instance == NULL) { return; }
+
+    memset(too_big, 0, sizeof(too_big));
+
+    expect(nchip8_load_rom(NULL, stops_rom, sizeof(stops_rom)) == NCHIP8_ERROR_INVALID_ARGUMENT, "load into NULL");
+    expect(nchip8_load_rom(instance, NULL, 4) == NCHIP8_ERROR_INVALID_ARGUMENT, "load from NULL");
+    expect(nchip8_load_rom(instance, too_big, sizeof(too_big)) == NCHIP8_ERROR_ROM_TOO_LARGE, "a ROM too large for RAM");
+    expect(nchip8_load_rom(instance, stops_rom, sizeof(stops_rom)) == NCHIP8_OK, "load a ROM");
+    expect(nchip8_get_trap(instance) == NCHIP8_TRAP_NONE, "no trap after loading");
+
+    nchip8_destroy(instance);
+    nchip8_destroy(NULL);
+}
+
+static void test_run_cycles(void)
+{
+    const uint32_t all = NCHIP8_STOP_ON_FRAME | NCHIP8_STOP_ON_KEY_WAIT | NCHIP8_STOP_ON_BREAKPOINT | NCHIP8_STOP_ON_SOUND;
+    nchip8_run_result result;
+    nchip8_instance* instance = create_with(stops_rom, sizeof(stops_rom));
+
+    if(instance == NULL) { return; }
+
+    expect(nchip8_set_breakpoint(instance, 0x20A, 1) == NCHIP8_OK, "set a breakpoint");
+    expect(nchip8_set_breakpoint(instance, 0x1000, 1) == NCHIP8_ERROR_INVALID_ARGUMENT, "a breakpoint outside RAM");
+
+    expect_stop(instance, all, NCHIP8_STOP_FRAME, "CLS stops on frame");
+    expect_stop(instance, all, NCHIP8_STOP_KEY_WAIT, "LD V0, K stops on key wait");
+    expect_stop(instance, all, NCHIP8_STOP_KEY_WAIT, "and keeps stopping until a key is down");
+
+    expect(nchip8_set_keys_mask(instance, 1 << 0x7) == NCHIP8_OK, "press a key");
+    expect_stop(instance, all, NCHIP8_STOP_SOUND, "LD ST, V1 stops on sound");
+    expect_stop(instance, all, NCHIP8_STOP_BREAKPOINT, "stops on the breakpoint");
+    expect_stop(instance, all, NCHIP8_STOP_HALTED, "JP to itself halts");
+
+    /* without stop flags only the budget stops a run */
+    expect(nchip8_load_rom(instance, stops_rom, sizeof(stops_rom)) == NCHIP8_OK, "reload the ROM");
+    expect(nchip8_set_keys_mask(instance, 0) == NCHIP8_OK, "release the keys");
+    expect(nchip8_run_cycles(instance, 100, 0, &result) == NCHIP8_OK, "a run with no stop flags");
+    expect(result.stop == NCHIP8_STOP_BUDGET && result.cycles == 100, "waits out the whole budget on the key");
+    expect(nchip8_run_cycles(instance, 1, 0, NULL) == NCHIP8_OK, "a NULL result is allowed");
+    expect(nchip8_run_cycles(NULL, 1, 0, NULL) == NCHIP8_ERROR_INVALID_ARGUMENT, "run a NULL instance");
+
+    nchip8_destroy(instance);
+}
+
+static void test_clock_rate(void)
+{
+    const uint32_t rates[] = { 500, 600, 1000 };
+    size_t i;
+
+    for(i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        nchip8_run_result result;
+        nchip8_instance* instance = create_with(second_rom, sizeof(second_rom));
+
+        if(instance == NULL) { return; }
+
+        expect(nchip8_set_clock_rate(instance, rates[i]) == NCHIP8_OK, "set the clock rate");
+        expect(nchip8_run_cycles(instance, 100000, 0, &result) == NCHIP8_OK && result.stop == NCHIP8_STOP_HALTED,
+               "the timer ROM halts");
+
+        /* 60 ticks are one second of cycles, give or take the loop around the last one */
+        expect(result.cycles >= rates[i] && result.cycles <= rates[i] + 8, "DT counts 60 ticks per clock rate of cycles");
+
+        nchip8_destroy(instance);
+    }
+
+    expect(nchip8_set_clock_rate(NULL, 500) == NCHIP8_ERROR_INVALID_ARGUMENT, "clock rate of a NULL instance");
+}
+
+static void test_states(void)
+{
+    const size_t size = nchip8_state_size();
+    uint8_t* saved = malloc(size);
+    uint8_t* again = malloc(size);
+    uint8_t* bad = malloc(size);
+    uint8_t first[NCHIP8_FRAMEBUFFER_PACKED_SIZE], second[NCHIP8_FRAMEBUFFER_PACKED_SIZE];
+    nchip8_instance* instance = create_with(noise_rom, sizeof(noise_rom));
+
+    if(instance == NULL || saved == NULL || again == NULL || bad == NULL) { expect(0, "allocate states"); return; }
+
+    expect(nchip8_seed_rng(instance, 7) == NCHIP8_OK, "seed RND");
+    expect(nchip8_run_cycles(instance, 500, 0, NULL) == NCHIP8_OK, "run before saving");
+    expect(nchip8_save_state(instance, saved, size) == NCHIP8_OK, "save a state");
+    expect(nchip8_save_state(instance, saved, size - 1) == NCHIP8_ERROR_BUFFER_TOO_SMALL, "save into a short buffer");
+
+    /* the same run twice from the state draws the same picture */
+    expect(nchip8_run_cycles(instance, 5000, 0, NULL) == NCHIP8_OK, "run on from the state");
+    expect(nchip8_get_framebuffer_packed(instance, first, sizeof(first)) == NCHIP8_OK, "read the screen");
+
+    expect(nchip8_load_state(instance, saved, size) == NCHIP8_OK, "load the state back");
+    expect(nchip8_save_state(instance, again, size) == NCHIP8_OK && memcmp(saved, again, size) == 0,
+           "a loaded state saves back the same");
+
+    expect(nchip8_run_cycles(instance, 5000, 0, NULL) == NCHIP8_OK, "run on from the loaded state");
+    expect(nchip8_get_framebuffer_packed(instance, second, sizeof(second)) == NCHIP8_OK, "read the screen again");
+    expect(memcmp(first, second, sizeof(first)) == 0, "the run after loading repeats the first");
+
+    /* states that aren't states, each leaves the instance alone */
+    expect(nchip8_load_state(instance, saved, size - 1) == NCHIP8_ERROR_BUFFER_TOO_SMALL, "load from a short buffer");
+
+    memcpy(bad, saved, size);
+    bad[0] ^= 0xFF;
+    expect(nchip8_load_state(instance, bad, size) == NCHIP8_ERROR_BAD_STATE, "a state with a bad header");
+
+    memcpy(bad, saved, size);
+    memset(bad + 8, 0xFF, size - 8);
+    expect(nchip8_load_state(instance, bad, size) == NCHIP8_ERROR_BAD_STATE, "a state full of 0xFF");
+
+    /* the screen is one byte per pixel, a byte that's neither 0 nor 1 can't be a pixel */
+    memcpy(bad, saved, size);
+    bad[size / 2] = 2;
+    expect(nchip8_load_state(instance, bad, size) == NCHIP8_ERROR_BAD_STATE, "a pixel that's neither on nor off");
+
+    expect(nchip8_save_state(instance, again, size) == NCHIP8_OK, "save after the bad loads");
+    expect(nchip8_get_framebuffer_packed(instance, first, sizeof(first)) == NCHIP8_OK
+           && memcmp(first, second, sizeof(first)) == 0, "bad states leave the instance as it was");
+
+    nchip8_destroy(instance);
+    free(saved);
+    free(again);
+    free(bad);
+}
+
+static void test_bulk(void)
+{
+    enum { count = 4 };
+
+    nchip8_instance* bulk[count];
+    nchip8_instance* single[count];
+    nchip8_run_result bulk_results[count];
+    uint8_t a[NCHIP8_FRAMEBUFFER_PACKED_SIZE], b[NCHIP8_FRAMEBUFFER_PACKED_SIZE];
+    size_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        bulk[i] = create_with(noise_rom, sizeof(noise_rom));
+        single[i] = create_with(noise_rom, sizeof(noise_rom));
+        if(bulk[i] == NULL || single[i] == NULL) { return; }
+
+        nchip8_seed_rng(bulk[i], (uint32_t)(i + 1));
+        nchip8_seed_rng(single[i], (uint32_t)(i + 1));
+    }
+
+    expect(nchip8_run_cycles_bulk(bulk, count, 3000, NCHIP8_STOP_ON_FRAME, bulk_results) == NCHIP8_OK, "a bulk run");
+
+    /* the same as running each one on its own */
+    for(i = 0; i < count; i++)
+    {
+        nchip8_run_result result;
+
+        expect(nchip8_run_cycles(single[i], 3000, NCHIP8_STOP_ON_FRAME, &result) == NCHIP8_OK, "a single run");
+        expect(result.cycles == bulk_results[i].cycles && result.stop == bulk_results[i].stop
+               && result.trap == bulk_results[i].trap, "bulk results match single runs");
+
+        nchip8_get_framebuffer_packed(bulk[i], a, sizeof(a));
+        nchip8_get_framebuffer_packed(single[i], b, sizeof(b));
+        expect(memcmp(a, b, sizeof(a)) == 0, "bulk screens match single runs");
+    }
+
+    expect(nchip8_run_cycles_bulk(bulk, count, 100000, 0, NULL) == NCHIP8_OK, "a bulk run without results");
+    nchip8_get_framebuffer_packed(bulk[0], a, sizeof(a));
+    nchip8_get_framebuffer_packed(bulk[1], b, sizeof(b));
+    expect(memcmp(a, b, sizeof(a)) != 0, "differently seeded instances draw different pictures");
+
+    /* a NULL anywhere fails the call before anything runs */
+    nchip8_destroy(single[count - 1]);
+    single[count - 1] = NULL;
+    expect(nchip8_run_cycles_bulk(single, count, 1, 0, NULL) == NCHIP8_ERROR_INVALID_ARGUMENT, "a NULL instance in a bulk run");
+    expect(nchip8_run_cycles_bulk(NULL, 0, 1, 0, NULL) == NCHIP8_OK, "an empty bulk run");
+
+    for(i = 0; i < count; i++)
+    {
+        nchip8_destroy(bulk[i]);
+        nchip8_destroy(single[i]);
+    }
+}
+
+/* Drives the C interface from plain C: create and load, runs against every stop condition, the clock rate,
+ * state round trips and rejected states, and bulk runs against single ones. Exits non-zero on a failure. */
+int main(void)
+{
+    test_create_and_load();
+    test_run_cycles();
+    test_clock_rate();
+    test_states();
+    test_bulk();
+
+    if(failures > 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("c api: ok\n");
+    return 0;
+}
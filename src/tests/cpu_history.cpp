@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "nchip8/cpu.hpp"
+#include "nchip8/cpu_history.hpp"
+#include "nchip8/hash.hpp"
+
+static int failures = 0;
+
+static void expect(const bool &ok, const std::string &what)
+{
+    if(!ok)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+//! Cycles per burst, keys only change between bursts like they do under cpu_daemon
+static constexpr std::uint64_t burst = 1000;
+
+//! Key 5 goes down and comes back up on these cycles, well into the ROM's wait
+static constexpr std::uint64_t key_down_at = 150000;
+static constexpr std::uint64_t key_up_at = 151000;
+
+//! Where the ROM below waits on a key, and an instruction it reaches every 256 iterations
+static constexpr std::uint16_t wait_pc = 0x212;
+static constexpr std::uint16_t counter_pc = 0x20C;
+
+static void apply_keys(nchip8::cpu &c)
+{
+    if(c.get_cycles() == key_down_at)   { c.set_key_down(0x5); }
+    if(c.get_cycles() == key_up_at)     { c.set_key_up(0x5); }
+}
+
+//! @brief Runs up to a cycle the way cpu_daemon does, the history recording between bursts
+static void run_to(nchip8::cpu &c, nchip8::cpu_history &history, const std::uint64_t &end)
+{
+    while(c.get_cycles() < end)
+    {
+        apply_keys(c);
+        history.record(c);
+
+        const std::uint64_t cycles = std::min(burst - c.get_cycles() % burst, end - c.get_cycles());
+        const nchip8::run_result result = c.run(cycles, nchip8::stop_on_key_wait);
+
+        if(result.m_reason == nchip8::run_stop::key_wait) { c.idle(cycles - result.m_cycles); }
+    }
+}
+
+//! @brief The same run a cycle at a time, looking at the cpu before each cycle runs
+static void step_to(nchip8::cpu &c, const std::uint64_t &end, const std::function<void(const nchip8::cpu&)> &look)
+{
+    while(c.get_cycles() < end)
+    {
+        if(c.get_cycles() % burst == 0) { apply_keys(c); }
+        look(c);
+
+        const nchip8::run_result result = c.run(1, nchip8::stop_on_key_wait);
+        if(result.m_reason == nchip8::run_stop::key_wait) { c.idle(1); }
+    }
+}
+
+static std::uint64_t hash_cpu(const nchip8::cpu &c)
+{
+    auto state = std::make_unique<nchip8::machine_state>();
+    c.save_state(*state);
+    return nchip8::hash_machine_state(*state);
+}
+
+// Records a run's history like cpu_daemon does and checks seek, step_back over an LD Vx, K wait and
+// continue_back to a breakpoint all land on exactly the state a cycle-by-cycle run had. Exits non-zero on a failure.
+int main()
+{
+    const std::vector<std::uint8_t> rom = {
+        0x60, 0x00,     // 200: LD V0, 0
+        0x61, 0x00,     // 202: LD V1, 0
+        0x70, 0x01,     // 204: ADD V0, 1
+        0xC2, 0xFF,     // 206: RND V2, 0xFF
+        0x83, 0x24,     // 208: ADD V3, V2
+        0x40, 0x00,     // 20A: SNE V0, 0
+        0x71, 0x01,     // 20C: ADD V1, 1       every 256 iterations
+        0x31, 0x40,     // 20E: SE V1, 0x40
+        0x12, 0x04,     // 210: JP 0x204
+        0xF4, 0x0A,     // 212: LD V4, K        after 64 * 256 iterations, ~98k cycles
+        0x61, 0x00,     // 214: LD V1, 0
+        0x12, 0x04,     // 216: JP 0x204
+    };
+
+    std::optional<nchip8::machine_state> image = nchip8::cpu::make_power_on_state(rom, 0x200);
+    expect(image.has_value(), "the power-on image builds");
+    if(!image.has_value()) { return 1; }
+
+    nchip8::cpu::seed_rng(*image, 1234);
+
+    const std::uint64_t end = 160000;
+
+    // first pass: where the wait starts, and every cycle the counter instruction is about to run
+    auto reference = std::make_unique<nchip8::cpu>();
+    reference->reset(*image);
+
+    std::optional<std::uint64_t> wait_start;
+    std::vector<std::uint64_t> counter_hits;
+
+    step_to(*reference, end, [&](const nchip8::cpu &c)
+    {
+        if(!wait_start.has_value() && c.is_waiting_for_key()) { wait_start = c.get_cycles(); }
+        if(c.get_pc() == counter_pc) { counter_hits.push_back(c.get_cycles()); }
+    });
+
+    expect(wait_start.has_value() && *wait_start + nchip8::cpu_history::snapshot_interval < key_down_at,
+           "the ROM waits on a key more than a snapshot before it's pressed");
+    expect(counter_hits.size() > 2, "the counter instruction runs");
+    if(failures > 0) { return 1; }
+
+    const std::uint64_t wait = *wait_start;
+
+    // the LD Vx, K runs on the first cycle of the burst the key arrives in
+    const std::uint64_t after_ld = key_down_at + 1;
+
+    // second pass: the state on every cycle that's gone back to
+    std::vector<std::uint64_t> wanted = { 0, 1, 2, wait - 1, wait, wait + 1, key_down_at - 1, key_down_at, after_ld,
+                                          after_ld + 1, end - 1, end };
+
+    for(const std::uint64_t &cycle : { nchip8::cpu_history::snapshot_interval,
+                                       nchip8::cpu_history::snapshot_interval * 3 + 7 })
+    {
+        wanted.insert(wanted.end(), { cycle - 1, cycle, cycle + 1 });
+    }
+
+    wanted.insert(wanted.end(), counter_hits.end() - 2, counter_hits.end());
+
+    std::map<std::uint64_t, std::uint64_t> hashes;
+
+    reference->reset(*image);
+    step_to(*reference, end, [&](const nchip8::cpu &c)
+    {
+        if(std::find(wanted.begin(), wanted.end(), c.get_cycles()) != wanted.end()) { hashes[c.get_cycles()] = hash_cpu(c); }
+    });
+    hashes[end] = hash_cpu(*reference);
+
+    auto target = std::make_unique<nchip8::cpu>();
+    nchip8::cpu_history history;
+
+    target->reset(*image);
+    run_to(*target, history, end);
+    expect(hash_cpu(*target) == hashes[end], "running in bursts ends where stepping a cycle at a time does");
+    expect(history.get_oldest_cycle() == std::optional<std::uint64_t>(0), "the history goes back to power-on");
+
+    // seek: everything after the cycle gone back to is forgotten, so latest first
+    std::sort(wanted.begin(), wanted.end());
+
+    for(auto cycle = wanted.rbegin(); cycle != wanted.rend(); cycle++)
+    {
+        const bool went = history.seek(*target, *cycle);
+        const std::string what = "seek to cycle " + std::to_string(*cycle);
+
+        expect(went && target->get_cycles() == *cycle, what);
+        expect(hash_cpu(*target) == hashes[*cycle], what + " restores the state");
+    }
+
+    expect(!history.seek(*target, 1), "can't seek forward past the history");
+
+    // step_back over the wait: the LD Vx, K, then everything spent waiting on it, then the instruction before
+    target->reset(*image);
+    history.clear();
+    run_to(*target, history, after_ld + 1);
+
+    expect(history.step_back(*target) && target->get_cycles() == after_ld, "step back over LD V1, 0");
+    expect(hash_cpu(*target) == hashes[after_ld], "step back over LD V1, 0 restores the state");
+
+    expect(history.step_back(*target) && target->get_cycles() == key_down_at, "step back over the LD Vx, K");
+    expect(target->get_pc() == wait_pc, "step back over the LD Vx, K lands on it");
+    expect(hash_cpu(*target) == hashes[key_down_at], "step back over the LD Vx, K restores the state");
+
+    expect(history.step_back(*target) && target->get_cycles() == wait - 1, "step back over the wait");
+    expect(target->get_pc() == wait_pc - 4, "step back over the wait lands on the SE before it");
+    expect(hash_cpu(*target) == hashes[wait - 1], "step back over the wait restores the state");
+
+    // and running on again from there goes the same way as before
+    run_to(*target, history, end);
+    expect(hash_cpu(*target) == hashes[end], "a run after stepping back repeats the first");
+
+    // continue_back: the latest breakpoint reached first, then the one before
+    target->set_breakpoint(counter_pc);
+
+    for(auto hit = counter_hits.rbegin(); hit != counter_hits.rbegin() + 2; hit++)
+    {
+        const std::string what = "continue back to the breakpoint on cycle " + std::to_string(*hit);
+
+        expect(history.continue_back(*target) && target->get_cycles() == *hit, what);
+        expect(target->get_pc() == counter_pc, what + " lands on it");
+        expect(hash_cpu(*target) == hashes[*hit], what + " restores the state");
+    }
+
+    // a breakpoint on the LD Vx, K is reached once however long it's waited on
+    target->clear_breakpoints();
+    target->set_breakpoint(wait_pc);
+
+    run_to(*target, history, end);
+    expect(history.continue_back(*target) && target->get_cycles() == wait, "continue back to the start of the wait");
+    expect(hash_cpu(*target) == hashes[wait], "continue back to the start of the wait restores the state");
+
+    const std::uint64_t before = hash_cpu(*target);
+    expect(!history.continue_back(*target), "no breakpoint was reached before the wait");
+    expect(target->get_cycles() == wait && hash_cpu(*target) == before, "a failed continue back leaves the cpu alone");
+
+    if(failures > 0)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "cpu history: ok" << std::endl;
+    return 0;
+}
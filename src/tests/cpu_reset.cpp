@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "nchip8/cpu.hpp"
+#include "nchip8/hash.hpp"
+
+// the layout the per-instance state was packed into, batch runs keep thousands of these
+static_assert(alignof(nchip8::cpu) == 64, "cpu must be cache line aligned");
+static_assert(sizeof(nchip8::machine_state) == 64 + 0x1000 + 128*64 + 64, "machine_state layout changed");
+static_assert(sizeof(nchip8::cpu) == sizeof(nchip8::machine_state) + 64 + 0x1000 / 8, "cpu layout changed");
+static_assert(!std::is_polymorphic<nchip8::cpu>::value, "a vptr would push the register file off its cache line");
+
+static int failures = 0;
+
+static void expect(const bool &ok, const std::string &what)
+{
+    if(!ok)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+//! @brief Checks every field of a saved state against the one expected
+static void expect_state(const nchip8::machine_state &got, const nchip8::machine_state &want, const std::string &when)
+{
+    expect(got.m_gpr == want.m_gpr, when + ": V registers");
+    expect(got.m_i == want.m_i, when + ": I");
+    expect(got.m_pc == want.m_pc, when + ": PC");
+    expect(got.m_sp == want.m_sp, when + ": SP");
+    expect(got.m_dt == want.m_dt, when + ": DT");
+    expect(got.m_st == want.m_st, when + ": ST");
+    expect(got.m_rng == want.m_rng, when + ": RND state");
+    expect(got.m_cycles == want.m_cycles, when + ": cycles");
+    expect(got.m_ram == want.m_ram, when + ": RAM");
+    expect(got.m_screen == want.m_screen, when + ": screen");
+    expect(got.m_stack == want.m_stack, when + ": stack");
+    expect(got.m_screen_mode == want.m_screen_mode, when + ": screen mode");
+    expect(got.m_trap == want.m_trap, when + ": trap");
+}
+
+//! @brief Touches as much state as a ROM can, ending on a trap with the keypad held
+static void dirty(nchip8::cpu &c)
+{
+    c.take_ram_written();
+
+    const nchip8::run_result result = c.run(1000);
+    expect(result.m_reason == nchip8::run_stop::trapped, "the dirtying ROM traps");
+    expect(c.get_trap() == nchip8::trap::stack_underflow, "the dirtying ROM underflows the stack");
+    expect(c.take_ram_written() != 0, "the dirtying ROM marks RAM written");
+
+    c.set_key_down(0x5);
+    c.set_key_down(0xA);
+    c.set_key_up(0x5);
+    expect(c.get_keys_mask() == (1 << 0xA) && c.get_latched_key() == 0xA, "keys are held");
+}
+
+//! @brief Checks nothing outside machine_state survived a reset either
+static void expect_clean_extras(nchip8::cpu &c, const std::string &when)
+{
+    expect(c.get_keys_mask() == 0, when + ": no keys down");
+    expect(c.get_latched_key() == nchip8::cpu::no_key, when + ": no key latched");
+    expect(c.get_trap() == nchip8::trap::none, when + ": trap cleared");
+    expect(c.take_ram_written() == ~std::uint64_t(0), when + ": all of RAM marked written");
+}
+
+// Dirties a cpu (registers, timers, the stack, RAM, the screen, keys, the latch, the RAM written blocks
+// and a trap), resets it and checks nothing is left over. Exits non-zero on a failure.
+int main()
+{
+    const std::vector<std::uint8_t> rom = {
+        0x60, 0xAB,     // 200: LD V0, 0xAB
+        0x6F, 0x01,     // 202: LD VF, 0x01
+        0xA3, 0x00,     // 204: LD I, 0x300
+        0xFF, 0x55,     // 206: LD [I], VF      RAM 0x300-0x30F
+        0xF0, 0x15,     // 208: LD DT, V0
+        0xF0, 0x18,     // 20A: LD ST, V0
+        0xC1, 0xFF,     // 20C: RND V1, 0xFF
+        0xD0, 0x15,     // 20E: DRW V0, V1, 5
+        0x22, 0x14,     // 210: CALL 0x214
+        0x00, 0xEE,     // 212: RET             nothing left to return to, traps
+        0x22, 0x18,     // 214: CALL 0x218
+        0x00, 0xEE,     // 216: RET
+        0x00, 0xEE,     // 218: RET
+    };
+
+    // ~12KiB, keep it off the stack
+    auto c = std::make_unique<nchip8::cpu>();
+    auto state = std::make_unique<nchip8::machine_state>();
+
+    // without a ROM
+    expect(c->load_rom(rom, 0x200), "the ROM loads");
+    dirty(*c);
+
+    c->reset();
+    c->save_state(*state);
+    expect_state(*state, nchip8::cpu::get_power_on_state(), "reset()");
+    expect_clean_extras(*c, "reset()");
+
+    // with a ROM image, a second run has to go exactly the way the first did
+    const std::optional<nchip8::machine_state> image = nchip8::cpu::make_power_on_state(rom, 0x200);
+    expect(image.has_value(), "the power-on image builds");
+    if(!image.has_value()) { return 1; }
+
+    c->reset(*image);
+    dirty(*c);
+    c->save_state(*state);
+    const std::uint64_t first_run = nchip8::hash_machine_state(*state);
+
+    c->reset(*image);
+    c->save_state(*state);
+    expect_state(*state, *image, "reset(image)");
+    expect_clean_extras(*c, "reset(image)");
+
+    dirty(*c);
+    c->save_state(*state);
+    expect(nchip8::hash_machine_state(*state) == first_run, "a run after reset(image) repeats the first");
+
+    if(failures > 0)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "cpu reset: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "nchip8/frame_stream.hpp"
+#include "nchip8/lz4_block.hpp"
+
+static int failures = 0;
+
+static void expect(const bool &ok, const std::string &what)
+{
+    if(!ok)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+//! @brief The input the reference block below was made from
+static std::vector<std::uint8_t> make_reference_input()
+{
+    std::vector<std::uint8_t> data;
+    for(int i = 0; i < 20; i++)
+    {
+        for(const char &c : std::string("nchip8 ")) { data.push_back(c); }
+    }
+
+    for(int i = 0; i < 64; i++) { data.push_back(i); }
+    data.resize(data.size() + 300, 0);
+    for(const char &c : std::string("abcabcabcabd")) { data.push_back(c); }
+
+    return data;
+}
+
+//! make_reference_input() compressed by the reference liblz4 (LZ4_compress_default)
+static const std::vector<std::uint8_t> reference_block = {
+    0x7f, 0x6e, 0x63, 0x68, 0x69, 0x70, 0x38, 0x20, 0x07, 0x00, 0x72, 0xff, 0x32, 0x00, 0x01, 0x02,
+    0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22,
+    0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32,
+    0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f, 0x00, 0x01, 0x00,
+    0xff, 0x19, 0xc0, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x64
+};
+
+//! @brief Compresses and decompresses a buffer, true if it comes back the same
+static bool round_trips(const std::vector<std::uint8_t> &data)
+{
+    std::vector<std::uint8_t> packed;
+    nchip8::lz4_compress(data.data(), data.size(), packed);
+
+    std::vector<std::uint8_t> unpacked(data.size());
+    return nchip8::lz4_decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()) && unpacked == data;
+}
+
+// Round-trips buffers through the LZ4 block codec, decodes a block made by the reference liblz4,
+// and streams frames through frame_encoder/frame_decoder. Exits non-zero on a failure.
+int main()
+{
+    // blocks from liblz4 decode
+    const std::vector<std::uint8_t> reference = make_reference_input();
+    std::vector<std::uint8_t> decoded(reference.size());
+    expect(nchip8::lz4_decompress(reference_block.data(), reference_block.size(), decoded.data(), decoded.size())
+           && decoded == reference, "the reference liblz4 block decodes");
+
+    // the size comes from the container, a block that doesn't fill it exactly is malformed
+    std::vector<std::uint8_t> too_big(reference.size() + 1);
+    expect(!nchip8::lz4_decompress(reference_block.data(), reference_block.size(), too_big.data(), too_big.size()),
+           "a block shorter than the expected size is rejected");
+    expect(!nchip8::lz4_decompress(reference_block.data(), reference_block.size() - 3, decoded.data(), decoded.size()),
+           "a truncated block is rejected");
+
+    // round trips: empty, tiny, the reference input, then random buffers of every shape the encoder branches on
+    expect(round_trips({}), "an empty buffer round-trips");
+    expect(round_trips({ 0x42 }), "one byte round-trips");
+    expect(round_trips(reference), "the reference input round-trips");
+
+    std::uint32_t state = 0x2545F491;
+    auto next = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    for(int i = 0; i < 2000; i++)
+    {
+        std::vector<std::uint8_t> data(next() % 4096);
+
+        // runs of zeros, repeats of earlier bytes and noise, like frame deltas and ROMs
+        for(std::size_t at = 0; at < data.size();)
+        {
+            const std::size_t run = std::min<std::size_t>(1 + next() % 300, data.size() - at);
+            const std::uint32_t kind = next() % 3;
+
+            for(std::size_t b = 0; b < run; b++, at++)
+            {
+                if(kind == 0)               { data[at] = 0; }
+                else if(kind == 1 && at > 8){ data[at] = data[at - 1 - (next() % 8)]; }
+                else                        { data[at] = next() & 0xFF; }
+            }
+        }
+
+        if(!round_trips(data))
+        {
+            expect(false, "random buffer " + std::to_string(i) + " round-trips");
+            break;
+        }
+    }
+
+    // frames: a keyframe, deltas, a mode switch, and a delta that skips a frame
+    nchip8::frame_encoder encoder;
+    nchip8::frame_decoder decoder;
+    std::vector<std::uint8_t> message;
+
+    nchip8::packed_framebuffer frame {};
+    for(int f = 0; f < 50; f++)
+    {
+        frame[next() % frame.size()] ^= 1 << (next() % 8);
+        frame[next() % frame.size()] ^= 1 << (next() % 8);
+
+        const nchip8::screen_mode mode = (f < 25) ? nchip8::screen_mode::lores_c8 : nchip8::screen_mode::hires_sc8;
+        encoder.encode(frame, mode, f == 0, message);
+
+        expect(decoder.decode(message.data(), message.size()), "frame " + std::to_string(f) + " decodes");
+        expect(decoder.get_frame() == frame, "frame " + std::to_string(f) + " matches");
+        expect(decoder.get_header().m_width == ((f < 25) ? 64 : 128), "frame " + std::to_string(f) + " width");
+    }
+
+    encoder.encode(frame, nchip8::screen_mode::lores_c8, false, message);
+    encoder.encode(frame, nchip8::screen_mode::lores_c8, false, message);
+    expect(!decoder.decode(message.data(), message.size()), "a delta after a dropped frame is rejected");
+
+    encoder.encode(frame, nchip8::screen_mode::lores_c8, true, message);
+    message[2] = 255;
+    expect(!decoder.decode(message.data(), message.size()), "a frame with a bad size is rejected");
+
+    if(failures > 0)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "lz4 and frame stream: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "nchip8/trace_file.hpp"
+
+static int failures = 0;
+
+static void expect(const bool &ok, const std::string &what)
+{
+    if(!ok)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+static bool same_record(const nchip8::trace_record &a, const nchip8::trace_record &b)
+{
+    return a.m_pc == b.m_pc && a.m_opcode == b.m_opcode && a.m_cycle == b.m_cycle;
+}
+
+//! @brief  Makes up an execution that goes through every way the format has of encoding a record:
+//!         straight runs longer than a repeat, skips, short and long jumps, odd addresses, wrapping off the
+//!         top of RAM, code rewriting itself and waits from one cycle to days long
+static std::vector<nchip8::trace_record> make_records(const std::size_t &count)
+{
+    std::uint32_t state = 0x2545F491;
+    auto next = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    std::array<std::uint16_t, 0x1000> ram {};
+    for(std::uint16_t &opcode : ram) { opcode = next() & 0xFFFF; }
+
+    std::vector<nchip8::trace_record> records;
+    std::uint16_t pc = 0x200;
+    std::uint64_t cycle = 0;
+
+    while(records.size() < count)
+    {
+        const std::uint32_t kind = next() % 100;
+
+        if(kind < 70)       { pc += 2; }
+        else if(kind < 78)  { pc += 4; }
+        else if(kind < 86)  { pc += 2 * (static_cast<int>(next() % 256) - 128); }
+        else if(kind < 92)  { pc = next() & 0xFFF; }
+        else if(kind < 94)  { pc = 0xFFE; }
+        else if(kind < 97)  { ram[(pc + 2) & 0xFFF] = next() & 0xFFFF; pc += 2; }
+        else                { pc += 2; cycle += (next() % 2) ? next() % 1000 : std::uint64_t(next()) << (next() % 24); }
+
+        pc &= 0xFFF;
+        cycle++;
+        records.push_back({ pc, ram[pc], cycle });
+    }
+
+    return records;
+}
+
+//! @brief Decodes every block of a trace, checking each against the records it should hold
+static std::size_t expect_blocks(const nchip8::trace_file &trace, const std::vector<nchip8::trace_record> &records,
+                                 const std::string &what)
+{
+    std::size_t decoded = 0;
+
+    for(std::size_t b = 0; b < trace.get_blocks().size(); b++)
+    {
+        const nchip8::trace_file::block_info &block = trace.get_blocks()[b];
+
+        // a dropped block leaves a gap, a block starts after the record it's relative to
+        auto expected = std::upper_bound(records.begin(), records.end(), block.m_cycle,
+            [](const std::uint64_t &cycle, const nchip8::trace_record &r) { return cycle < r.m_cycle; });
+
+        std::vector<nchip8::trace_record> got;
+        const bool good = trace.decode_block(b, [&](const nchip8::trace_record &r) { got.push_back(r); });
+
+        const std::string block_what = what + ": block " + std::to_string(b);
+        expect(good, block_what + " decodes");
+        expect(got.size() == block.m_records, block_what + " has the records its header says");
+        expect(std::distance(expected, records.end()) >= static_cast<std::ptrdiff_t>(got.size())
+               && std::equal(got.begin(), got.end(), expected, same_record), block_what + " matches what was recorded");
+
+        decoded += got.size();
+    }
+
+    return decoded;
+}
+
+// Writes a made-up execution with trace_writer and reads it back with trace_file, block by block and after the file
+// is cut short mid-block, and checks anything that isn't a trace is refused. Exits non-zero on a failure.
+int main()
+{
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("nchip8_trace_test_" + std::to_string(::getpid()) + ".n8t")).string();
+
+    const std::vector<nchip8::trace_record> records = make_records(200000);
+
+    std::uint64_t dropped = 0;
+    {
+        nchip8::trace_writer writer(path, 4096);
+
+        for(const nchip8::trace_record &r : records)
+        {
+            writer.record(r.m_pc, r.m_opcode, r.m_cycle);
+        }
+
+        expect(writer.get_records() == records.size(), "the writer counts every record");
+        dropped = writer.get_records_dropped();
+    }
+
+    // only ever drops when the disk falls behind, the blocks either side still have to decode
+    std::size_t full_blocks = 0;
+    std::size_t cut_at = 0;
+    {
+        const nchip8::trace_file trace(path);
+        full_blocks = trace.get_blocks().size();
+        cut_at = trace.get_blocks().back().m_offset + nchip8::trace_format::block_header_size
+                 + trace.get_blocks().back().m_size / 2;
+
+        expect(full_blocks > 1, "the trace spans several blocks");
+        expect(trace.get_records() + dropped == records.size(), "the block headers hold every record not dropped");
+        expect(expect_blocks(trace, records, "whole file") == trace.get_records(), "every record decodes");
+    }
+
+    // a session killed mid-write: the cut block ends the index, the ones before it still decode
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    bytes.resize(cut_at);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    }
+
+    {
+        const nchip8::trace_file trace(path);
+        expect(trace.get_blocks().size() == full_blocks - 1, "a cut block is left out");
+        expect_blocks(trace, records, "cut file");
+    }
+
+    // not a trace
+    bytes[0] = 'X';
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    }
+
+    bool refused = false;
+    try
+    {
+        const nchip8::trace_file trace(path);
+    }
+    catch(const std::runtime_error &)
+    {
+        refused = true;
+    }
+
+    expect(refused, "a file without the trace magic is refused");
+
+    std::filesystem::remove(path);
+
+    if(failures > 0)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "trace file: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nchip8/batch_runner.hpp"
+#include "nchip8/io.hpp"
+
+// Usage: nchip8_batch [--engine ENGINE] [--cycles N] [--cycles-per-tick N]
+//                     [--seed N] [--jobs N] [--dump-dir DIR] [--dump-at C1,C2,...]
+//                     [--dump-every FRAMES] [--dump-format pbm|png]
+//                     [--hash-frames] [--write-hashes FILE] [--golden FILE] <rom path>...
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+
+    for(int i = 0; i < argc; i++)
+    {
+        args.emplace_back(argv[i]);
+    }
+
+    nchip8::batch_options options;
+    std::vector<std::string> roms;
+    std::string hashes_path;
+
+    for(std::size_t i = 1; i < args.size(); i++)
+    {
+        const std::string& arg = args[i];
+        const bool has_value = (i + 1 < args.size());
+
+        if(arg == "--engine" && has_value)                  { options.m_engine = args[++i]; }
+        else if(arg == "--cycles" && has_value)             { options.m_max_cycles = std::stoul(args[++i]); }
+        else if(arg == "--cycles-per-tick" && has_value)    { options.m_cycles_per_tick = std::stoul(args[++i]); }
+        else if(arg == "--seed" && has_value)               { options.m_seed = std::stoul(args[++i]); }
+        else if(arg == "--jobs" && has_value)               { options.m_jobs = std::stoul(args[++i]); }
+        else if(arg == "--dump-dir" && has_value)           { options.m_dump_dir = args[++i]; }
+        else if(arg == "--dump-every" && has_value)         { options.m_dump_every = std::stoul(args[++i]); }
+        else if(arg == "--hash-frames")                     { options.m_hash_frames = true; }
+        else if(arg == "--write-hashes" && has_value)       { hashes_path = args[++i]; options.m_hash_frames = true; }
+        else if(arg == "--golden" && has_value)             { options.m_golden = args[++i]; }
+        else if(arg == "--dump-at" && has_value)
+        {
+            std::stringstream cycles(args[++i]);
+            for(std::string cycle; std::getline(cycles, cycle, ',');)
+            {
+                options.m_dump_at.push_back(std::stoul(cycle));
+            }
+        }
+        else if(arg == "--dump-format" && has_value)
+        {
+            const std::string& format = args[++i];
+            if(format == "png")         { options.m_dump_format = nchip8::image_format::png; }
+            else if(format == "pbm")    { options.m_dump_format = nchip8::image_format::pbm; }
+            else
+            {
+                std::cerr << "unknown dump format: " << format << std::endl;
+                return 1;
+            }
+        }
+        else if(arg.rfind("--", 0) == 0)
+        {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 1;
+        }
+        else { roms.push_back(arg); }
+    }
+
+    if(roms.empty())
+    {
+        std::cerr << "Usage: nchip8_batch [--engine ENGINE] [--cycles N] [--cycles-per-tick N] "
+                     "[--seed N] [--jobs N] [--dump-dir DIR] [--dump-at C1,C2,...] "
+                     "[--dump-every FRAMES] [--dump-format pbm|png] "
+                     "[--hash-frames] [--write-hashes FILE] [--golden FILE] <rom path>..." << std::endl;
+        return 1;
+    }
+
+    nchip8::batch_runner runner(options);
+    const std::vector<nchip8::batch_result> results = runner.run_corpus(roms);
+
+    std::size_t failures = 0;
+    for(const nchip8::batch_result &result : results)
+    {
+        if(!result.m_error.empty())
+        {
+            std::cout << "ERROR    " << result.m_rom << ": " << result.m_error << std::endl;
+            failures++;
+            continue;
+        }
+
+        if(result.m_trap != nchip8::trap::none)
+        {
+            std::cout << "TRAP     " << result.m_rom << " " << nchip8::to_string(result.m_trap)
+                      << " at " << nchip8::nnn << result.m_pc
+                      << " after " << std::dec << result.m_cycles << " cycles" << std::endl;
+            failures++;
+            continue;
+        }
+
+        std::cout << (result.m_stop == nchip8::engine_stop::halted ? "halted   " : "ok       ")
+                  << result.m_rom << " " << std::dec << result.m_cycles << " cycles pc " << nchip8::nnn << result.m_pc
+                  << " hash " << std::noshowbase << std::hex << result.m_state_hash;
+
+        if(options.m_hash_frames || !options.m_golden.empty())
+        {
+            std::cout << " frames " << std::dec << result.m_frames.m_frames
+                      << " " << std::hex << result.m_frames.m_sequence_hash;
+        }
+
+        std::cout << std::endl;
+
+        if(options.m_golden.empty()) { continue; }
+
+        if(!result.m_has_golden)
+        {
+            std::cout << "NEW      " << result.m_rom << " not in " << options.m_golden << std::endl;
+            failures++;
+        }
+        else if(result.m_mismatched_frames > 0)
+        {
+            std::cout << "DIFF     " << result.m_rom << " " << std::dec << result.m_mismatched_frames
+                      << " frames differ, first at frame " << result.m_first_mismatch
+                      << " (cycle " << (result.m_first_mismatch + 1) * std::max<std::uint32_t>(options.m_cycles_per_tick, 1)
+                      << ")" << std::endl;
+            failures++;
+        }
+    }
+
+    if(!hashes_path.empty())
+    {
+        nchip8::write_frame_traces(hashes_path, results);
+    }
+
+    if(!options.m_dump_dir.empty())
+    {
+        const std::size_t failed = runner.finish_dumps();
+        std::cout << "dumped " << std::dec << runner.get_dumps_written() << " screens to " << options.m_dump_dir;
+        if(failed) { std::cout << ", " << failed << " failed"; }
+        std::cout << std::endl;
+
+        failures += failed;
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nchip8/engine.hpp"
+#include "nchip8/hash.hpp"
+#include "nchip8/io.hpp"
+
+//! @brief Keys held from a cycle onwards, until the next event
+struct key_event
+{
+    std::uint64_t m_cycle;
+    std::uint16_t m_keys;
+};
+
+//! @brief A ROM and the input played into it
+struct workload
+{
+    std::string m_name;
+    std::vector<std::uint8_t> m_rom;
+    std::vector<key_event> m_script;
+};
+
+//! @brief Lays instructions out big endian from 0x200, anything placed past the end is zero filled up to it
+static std::vector<std::uint8_t> assemble(const std::vector<std::pair<std::uint16_t, std::vector<std::uint16_t>>> &blocks)
+{
+    std::vector<std::uint8_t> rom;
+
+    for(const auto &block : blocks)
+    {
+        rom.resize(block.first - 0x200, 0);
+
+        for(const std::uint16_t &op : block.second)
+        {
+            rom.push_back(op >> 8);
+            rom.push_back(op & 0xFF);
+        }
+    }
+
+    return rom;
+}
+
+//! @brief The built-in workloads, written to cover what games spend their time on
+static std::vector<workload> get_builtin_workloads(const std::size_t &cycles)
+{
+    std::vector<workload> workloads;
+
+    // a font digit bouncing around the screen, drawn and erased every step: DRW, the skip
+    // instructions, ALU adds with carries, and a CALL/RET into a BCD routine
+    workloads.push_back({ "sprites", assemble({
+        { 0x200, {
+            0x6000, 0x6100, 0x6201, 0x6301,     // x, y, dx, dy
+            0x6400, 0xF429,                     // digit 0
+            0xD015, 0xD015,                     // 20C: draw, erase
+            0x8024, 0x403B, 0x62FF, 0x4000, 0x6201,     // x += dx, bounce off 0 and 59
+            0x8134, 0x411A, 0x63FF, 0x4100, 0x6301,     // y += dy, bounce off 0 and 26
+            0x7401, 0x650F, 0x8452,             // next digit
+            0x2300, 0xF429,                     // BCD of x, then point I back at the digit
+            0x120C } },
+        { 0x300, {
+            0xA400, 0xF033, 0x00EE } }
+    }), {} });
+
+    // random operands through every 8xy_ instruction, then BCD and register stores/loads through a moving I
+    workloads.push_back({ "alu", assemble({
+        { 0x200, {
+            0x6B03, 0x6A00, 0xA500,             // stride, counter, I
+            0xC0FF, 0xC1FF,                     // 206: random operands
+            0x8200, 0x8211, 0x8300, 0x8312, 0x8400, 0x8413,
+            0x8500, 0x8514, 0x8600, 0x8615, 0x8700, 0x8716,
+            0x8800, 0x8817, 0x8900, 0x891E,
+            0x5010, 0x7C01, 0x9010, 0x7D01,     // count equal and unequal operands
+            0x3A80, 0x123A,                     // wrap I every 128 steps
+            0x6A00, 0xA500,
+            0xF533, 0xFB1E, 0xF355, 0xF365,     // 23A: BCD, I += 3, store, load
+            0x7A01, 0x1206 } }
+    }), {} });
+
+    // a game loop: wait on DT for each frame, poll keys to move, beep on one and block on LD Vx, K on another
+    workload input { "input", assemble({
+        { 0x200, {
+            0x6020, 0x6110, 0x6400, 0x6804,     // x, y, digit, beep length
+            0xF429, 0xD015,
+            0x6502, 0xF515,                     // 20C: two ticks a frame
+            0xF607, 0x3600, 0x1210,             // 210: wait them out
+            0xD015,                             // erase
+            0x6705, 0xE7A1, 0x71FF,             // 5: up
+            0x6708, 0xE7A1, 0x7101,             // 8: down
+            0x6707, 0xE7A1, 0x70FF,             // 7: left
+            0x6709, 0xE7A1, 0x7001,             // 9: right
+            0x6706, 0xE7A1, 0xF818,             // 6: beep
+            0x670A, 0xE7A1, 0xF90A,             // A: wait for a key
+            0x7401, 0x6A0F, 0x84A2, 0xF429,     // next digit
+            0xD015, 0x120C } }
+    }), {} };
+
+    // each key in turn, held for 500 cycles out of every 1500
+    static const std::uint8_t keys[] = { 0x5, 0x9, 0x8, 0x7, 0x6, 0xA };
+
+    for(std::uint64_t cycle = 1000, n = 0; cycle < cycles; cycle += 1500, n++)
+    {
+        input.m_script.push_back({ cycle, std::uint16_t(1 << keys[n % sizeof(keys)]) });
+        input.m_script.push_back({ cycle + 500, 0 });
+    }
+
+    workloads.push_back(std::move(input));
+
+    return workloads;
+}
+
+//! @brief What running a workload on an engine did
+struct bench_result
+{
+    std::size_t m_cycles = 0;
+    std::chrono::duration<double> m_time {};
+    std::uint64_t m_state_hash = 0;
+    std::string m_error;
+};
+
+//! @brief Runs a workload one 60Hz frame at a time, the way the schedulers do, applying its script between frames
+static bench_result run_workload(const workload &load, const std::string &engine_name,
+                                 const std::size_t &cycles, const std::uint32_t &cycles_per_tick)
+{
+    bench_result result;
+
+    auto image = nchip8::cpu::make_power_on_state(load.m_rom, 0x200);
+    if(!image.has_value())
+    {
+        result.m_error = "ROM does not fit in memory";
+        return result;
+    }
+
+    auto target = std::make_unique<nchip8::cpu>();
+    target->reset(*image);
+
+    std::unique_ptr<nchip8::engine> runner = nchip8::make_engine(engine_name, cycles_per_tick);
+
+    auto event = load.m_script.begin();
+    const auto start = std::chrono::steady_clock::now();
+
+    while(result.m_cycles < cycles)
+    {
+        for(; event != load.m_script.end() && event->m_cycle <= result.m_cycles; event++)
+        {
+            target->set_keys_mask(event->m_keys);
+        }
+
+        std::size_t burst = std::min<std::size_t>(cycles_per_tick, cycles - result.m_cycles);
+        if(event != load.m_script.end()) { burst = std::min<std::size_t>(burst, event->m_cycle - result.m_cycles); }
+
+        const nchip8::engine_result ran = runner->step(*target, burst);
+        result.m_cycles += ran.m_cycles;
+
+        if(ran.m_stop == nchip8::engine_stop::fault)
+        {
+            result.m_error = std::string("trapped: ") + nchip8::to_string(ran.m_trap);
+            break;
+        }
+
+        if(ran.m_stop == nchip8::engine_stop::halted) { break; }
+    }
+
+    result.m_time = std::chrono::steady_clock::now() - start;
+
+    nchip8::machine_state state;
+    target->save_state(state);
+    result.m_state_hash = nchip8::hash_machine_state(state);
+
+    return result;
+}
+
+// Usage: nchip8_bench [--engine ENGINE] [--cycles N] [--cycles-per-tick N] [rom path]...
+// Runs the built-in workloads, and any ROMs given (with no input), on every engine or just one.
+// The state hashes printed don't depend on the build, so optimised builds can be checked against plain ones.
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+
+    for(int i = 0; i < argc; i++)
+    {
+        args.emplace_back(argv[i]);
+    }
+
+    std::vector<std::string> engines = nchip8::get_engine_names();
+    std::size_t cycles = 20000000;
+    std::uint32_t cycles_per_tick = 16;
+    std::vector<std::string> roms;
+
+    for(std::size_t i = 1; i < args.size(); i++)
+    {
+        const std::string& arg = args[i];
+        const bool has_value = (i + 1 < args.size());
+
+        if(arg == "--engine" && has_value)                  { engines = { args[++i] }; }
+        else if(arg == "--cycles" && has_value)             { cycles = std::stoul(args[++i]); }
+        else if(arg == "--cycles-per-tick" && has_value)    { cycles_per_tick = std::stoul(args[++i]); }
+        else if(arg.rfind("--", 0) == 0)
+        {
+            std::cerr << "Usage: nchip8_bench [--engine ENGINE] [--cycles N] [--cycles-per-tick N] [rom path]..."
+                      << std::endl;
+            return 1;
+        }
+        else { roms.push_back(arg); }
+    }
+
+    for(const std::string &name : engines)
+    {
+        if(!nchip8::make_engine(name, cycles_per_tick))
+        {
+            std::cerr << "unknown engine: " << name << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<workload> workloads = get_builtin_workloads(cycles);
+    for(const std::string &path : roms)
+    {
+        workloads.push_back({ path, nchip8::read_binary_file(path), {} });
+    }
+
+    std::size_t failures = 0;
+
+    for(const std::string &engine_name : engines)
+    {
+        std::size_t total_cycles = 0;
+        double total_seconds = 0;
+
+        for(const workload &load : workloads)
+        {
+            const bench_result result = run_workload(load, engine_name, cycles, cycles_per_tick);
+
+            if(!result.m_error.empty())
+            {
+                std::cout << std::left << std::setw(10) << engine_name << std::setw(12) << load.m_name
+                          << result.m_error << std::endl;
+                failures++;
+                continue;
+            }
+
+            const double seconds = result.m_time.count();
+            total_cycles += result.m_cycles;
+            total_seconds += seconds;
+
+            std::cout << std::left << std::setw(10) << engine_name << std::setw(12) << load.m_name
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(8)
+                      << (seconds > 0 ? result.m_cycles / seconds / 1e6 : 0) << " MIPS  "
+                      << std::dec << result.m_cycles << " cycles  hash "
+                      << std::hex << result.m_state_hash << std::dec << std::endl;
+        }
+
+        std::cout << std::left << std::setw(10) << engine_name << std::setw(12) << "total"
+                  << std::right << std::fixed << std::setprecision(1) << std::setw(8)
+                  << (total_seconds > 0 ? total_cycles / total_seconds / 1e6 : 0) << " MIPS" << std::endl;
+    }
+
+    return failures ? 1 : 0;
+}
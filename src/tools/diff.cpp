@@ -0,0 +1,93 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nchip8/differential.hpp"
+#include "nchip8/io.hpp"
+
+static const char* to_string(const nchip8::engine_stop &stop)
+{
+    switch(stop)
+    {
+        case nchip8::engine_stop::none:     return "running";
+        case nchip8::engine_stop::halted:   return "halted";
+        case nchip8::engine_stop::fault:    return "trapped";
+    }
+
+    return "unknown";
+}
+
+// Usage: nchip8_diff [--a ENGINE] [--b ENGINE] [--every N] [--cycles N]
+//                    [--cycles-per-tick N] [--seed N] [--jobs N] <rom path>...
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+
+    for(int i = 0; i < argc; i++)
+    {
+        args.emplace_back(argv[i]);
+    }
+
+    nchip8::differential_options options;
+    std::vector<std::string> roms;
+
+    for(std::size_t i = 1; i < args.size(); i++)
+    {
+        const std::string& arg = args[i];
+        const bool has_value = (i + 1 < args.size());
+
+        if(arg == "--a" && has_value)                       { options.m_engine_a = args[++i]; }
+        else if(arg == "--b" && has_value)                  { options.m_engine_b = args[++i]; }
+        else if(arg == "--every" && has_value)              { options.m_checkpoint = std::stoul(args[++i]); }
+        else if(arg == "--cycles" && has_value)             { options.m_max_cycles = std::stoul(args[++i]); }
+        else if(arg == "--cycles-per-tick" && has_value)    { options.m_cycles_per_tick = std::stoul(args[++i]); }
+        else if(arg == "--seed" && has_value)               { options.m_seed = std::stoul(args[++i]); }
+        else if(arg == "--jobs" && has_value)               { options.m_jobs = std::stoul(args[++i]); }
+        else if(arg.rfind("--", 0) == 0)
+        {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 1;
+        }
+        else { roms.push_back(arg); }
+    }
+
+    if(roms.empty())
+    {
+        std::cerr << "Usage: nchip8_diff [--a ENGINE] [--b ENGINE] [--every N] [--cycles N] "
+                     "[--cycles-per-tick N] [--seed N] [--jobs N] <rom path>..." << std::endl;
+        std::cerr << "Engines:";
+        for(const std::string &name : nchip8::get_engine_names()) { std::cerr << ' ' << name; }
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    nchip8::differential_runner runner(options);
+
+    std::size_t mismatches = 0;
+    for(const nchip8::differential_result &result : runner.compare_corpus(roms))
+    {
+        if(!result.m_error.empty())
+        {
+            std::cout << "ERROR    " << result.m_rom << ": " << result.m_error << std::endl;
+            mismatches++;
+            continue;
+        }
+
+        if(result.m_match)
+        {
+            std::cout << "ok       " << result.m_rom << " " << std::dec << result.m_cycles << " cycles ("
+                      << to_string(result.m_stop_a) << ") hash " << std::noshowbase << std::hex << result.m_rolling_hash << std::endl;
+            continue;
+        }
+
+        mismatches++;
+        std::cout << "MISMATCH " << result.m_rom << " at cycle " << std::dec << result.m_cycles
+                  << " pc " << nchip8::nnn << result.m_pc << " inst " << nchip8::inst << result.m_instruction
+                  << ": " << result.m_difference
+                  << " (" << options.m_engine_a << " " << to_string(result.m_stop_a)
+                  << ", " << options.m_engine_b << " " << to_string(result.m_stop_b) << ")" << std::endl;
+    }
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nchip8/fuzzer.hpp"
+#include "nchip8/io.hpp"
+
+// Usage: nchip8_fuzz <rom path> [--iterations N] [--jobs N] [--max-cycles N]
+//                               [--cycles-per-tick N] [--hang-cycles N] [--seed N] [--mutate-rom] [--out DIR]
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+
+    for(int i = 0; i < argc; i++)
+    {
+        args.emplace_back(argv[i]);
+    }
+
+    if(args.size() < 2)
+    {
+        std::cerr << "Usage: nchip8_fuzz <rom path> [--iterations N] [--jobs N] [--max-cycles N] "
+                     "[--cycles-per-tick N] [--hang-cycles N] [--seed N] [--mutate-rom] [--out DIR]" << std::endl;
+        return 1;
+    }
+
+    nchip8::fuzzer_options options;
+
+    for(std::size_t i = 2; i < args.size(); i++)
+    {
+        const std::string& arg = args[i];
+        const bool has_value = (i + 1 < args.size());
+
+        if(arg == "--mutate-rom")                         { options.m_mutate_rom = true; }
+        else if(arg == "--iterations" && has_value)       { options.m_iterations = std::stoul(args[++i]); }
+        else if(arg == "--jobs" && has_value)             { options.m_jobs = std::stoul(args[++i]); }
+        else if(arg == "--max-cycles" && has_value)       { options.m_max_cycles = std::stoul(args[++i]); }
+        else if(arg == "--cycles-per-tick" && has_value)  { options.m_cycles_per_tick = std::stoul(args[++i]); }
+        else if(arg == "--hang-cycles" && has_value)      { options.m_hang_cycles = std::stoul(args[++i]); }
+        else if(arg == "--seed" && has_value)             { options.m_seed = std::stoul(args[++i]); }
+        else if(arg == "--out" && has_value)              { options.m_output_dir = args[++i]; }
+        else
+        {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    nchip8::fuzzer fuzzer(nchip8::read_binary_file(args[1]), options);
+
+    std::thread session([&fuzzer]() { fuzzer.run(); });
+
+    // progress, once a second until the workers finish
+    auto last_report = std::chrono::steady_clock::now();
+    while(fuzzer.get_executions() < options.m_iterations)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        if(std::chrono::steady_clock::now() - last_report >= std::chrono::seconds(1))
+        {
+            last_report = std::chrono::steady_clock::now();
+            std::cout << "execs " << fuzzer.get_executions()
+                      << " edges " << fuzzer.get_edges()
+                      << " corpus " << fuzzer.get_corpus_size()
+                      << " findings " << fuzzer.get_findings().size() << std::endl;
+        }
+    }
+
+    session.join();
+
+    std::cout << "done: execs " << fuzzer.get_executions()
+              << " edges " << fuzzer.get_edges()
+              << " corpus " << fuzzer.get_corpus_size() << std::endl;
+
+    for(const nchip8::fuzz_finding &finding : fuzzer.get_findings())
+    {
+        std::cout << nchip8::to_string(finding) << " at "
+                  << nchip8::nnn << finding.m_pc << std::dec
+                  << " after " << finding.m_events.size() << " input events" << std::endl;
+    }
+
+    return 0;
+}
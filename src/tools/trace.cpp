@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nchip8/cpu.hpp"
+#include "nchip8/trace_file.hpp"
+
+//! @brief What a run of records added up to, one per worker, merged at the end
+struct trace_stats
+{
+    std::uint64_t m_records = 0;
+    std::uint64_t m_waiting = 0;
+    std::uint64_t m_bad_blocks = 0;
+
+    //! By decode table slot, see cpu::get_op_info
+    std::vector<std::uint64_t> m_ops = std::vector<std::uint64_t>(nchip8::cpu::get_op_count());
+    std::array<std::uint64_t, 0x1000> m_pcs {};
+
+    //! Conditional skips by address, how often they skipped and how often they didn't
+    std::array<std::uint64_t, 0x1000> m_taken {};
+    std::array<std::uint64_t, 0x1000> m_not_taken {};
+
+    //! Backward jumps (loops) by from << 12 | to
+    std::unordered_map<std::uint32_t, std::uint64_t> m_loops;
+
+    //! @brief Accounts for a record
+    void add(const nchip8::trace_record &record)
+    {
+        m_records++;
+        m_pcs[record.m_pc]++;
+        m_ops[nchip8::cpu::get_op_info(record.m_opcode).m_index]++;
+    }
+
+    //! @brief Accounts for control going from one record to the next
+    void add_transition(const nchip8::trace_record &from, const nchip8::trace_record &to)
+    {
+        if(to.m_cycle > from.m_cycle) { m_waiting += to.m_cycle - from.m_cycle - 1; }
+
+        const nchip8::cpu::op_info op = nchip8::cpu::get_op_info(from.m_opcode);
+
+        if(op.m_conditional_skip)
+        {
+            if(to.m_pc == ((from.m_pc + 4) & 0xFFF))   { m_taken[from.m_pc]++; }
+            else                                        { m_not_taken[from.m_pc]++; }
+        }
+
+        if(op.m_jump && to.m_pc <= from.m_pc)
+        {
+            m_loops[(std::uint32_t(from.m_pc) << 12) | to.m_pc]++;
+        }
+    }
+
+    void merge(const trace_stats &other)
+    {
+        m_records += other.m_records;
+        m_waiting += other.m_waiting;
+        m_bad_blocks += other.m_bad_blocks;
+
+        for(std::size_t i = 0; i < m_ops.size(); i++) { m_ops[i] += other.m_ops[i]; }
+
+        for(std::size_t i = 0; i < m_pcs.size(); i++)
+        {
+            m_pcs[i] += other.m_pcs[i];
+            m_taken[i] += other.m_taken[i];
+            m_not_taken[i] += other.m_not_taken[i];
+        }
+
+        for(const auto &loop : other.m_loops) { m_loops[loop.first] += loop.second; }
+    }
+};
+
+//! @brief Returns the indexes of the largest n non-zero counts, largest first
+template<typename C>
+static std::vector<std::size_t> get_top(const C &counts, const std::size_t &n)
+{
+    std::vector<std::size_t> top;
+    for(std::size_t i = 0; i < counts.size(); i++)
+    {
+        if(counts[i] > 0) { top.push_back(i); }
+    }
+
+    std::sort(top.begin(), top.end(), [&](const std::size_t &a, const std::size_t &b) { return counts[a] > counts[b]; });
+    if(top.size() > n) { top.resize(n); }
+
+    return top;
+}
+
+// Usage: nchip8_trace [--jobs N] [--top N] <trace .n8t>
+// Summarises a trace written by nchip8: an instruction histogram, hot loops, how conditional skips went,
+// and the hottest addresses. Blocks are decoded in parallel straight out of a read-only mapping.
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+
+    for(int i = 0; i < argc; i++)
+    {
+        args.emplace_back(argv[i]);
+    }
+
+    std::size_t jobs = 0;
+    std::size_t top = 10;
+    std::string path;
+
+    for(std::size_t i = 1; i < args.size(); i++)
+    {
+        const std::string& arg = args[i];
+        const bool has_value = (i + 1 < args.size());
+
+        if(arg == "--jobs" && has_value)        { jobs = std::stoul(args[++i]); }
+        else if(arg == "--top" && has_value)    { top = std::stoul(args[++i]); }
+        else if(arg.rfind("--", 0) == 0 || !path.empty())
+        {
+            path.clear();
+            break;
+        }
+        else { path = arg; }
+    }
+
+    if(path.empty())
+    {
+        std::cerr << "Usage: nchip8_trace [--jobs N] [--top N] <trace .n8t>" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<nchip8::trace_file> trace;
+    try
+    {
+        trace = std::make_unique<nchip8::trace_file>(path);
+    }
+    catch(const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    const std::vector<nchip8::trace_file::block_info> &blocks = trace->get_blocks();
+
+    if(jobs == 0) { jobs = std::max(1u, std::thread::hardware_concurrency()); }
+    jobs = std::min(jobs, std::max<std::size_t>(blocks.size(), 1));
+
+    // each block's first and last records, so transitions between blocks can be accounted for after
+    std::vector<std::pair<nchip8::trace_record, nchip8::trace_record>> ends(blocks.size());
+    std::vector<std::uint8_t> decoded(blocks.size(), false);
+
+    std::vector<trace_stats> stats(jobs);
+    std::atomic<std::size_t> next(0);
+
+    auto worker = [&](trace_stats &partial)
+    {
+        for(std::size_t b = next++; b < blocks.size(); b = next++)
+        {
+            bool first = true;
+            nchip8::trace_record last {};
+
+            const bool good = trace->decode_block(b, [&](const nchip8::trace_record &record)
+            {
+                if(first)   { ends[b].first = record; first = false; }
+                else        { partial.add_transition(last, record); }
+
+                partial.add(record);
+                last = record;
+            });
+
+            if(!good) { partial.m_bad_blocks++; }
+
+            ends[b].second = last;
+            if(!first) { decoded[b] = true; }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(std::size_t j = 0; j < jobs; j++)
+    {
+        workers.emplace_back(worker, std::ref(stats[j]));
+    }
+
+    for(std::thread &t : workers)
+    {
+        t.join();
+    }
+
+    trace_stats total;
+    for(const trace_stats &partial : stats)
+    {
+        total.merge(partial);
+    }
+
+    // a block carries on from the one before, unless that was dropped or damaged
+    for(std::size_t b = 1; b < blocks.size(); b++)
+    {
+        if(decoded[b - 1] && decoded[b] && ends[b - 1].second.m_cycle == blocks[b].m_cycle)
+        {
+            total.add_transition(ends[b - 1].second, ends[b].first);
+        }
+    }
+
+    std::cout << path << ": " << std::dec << total.m_records << " instructions, "
+              << total.m_waiting << " cycles waiting, " << blocks.size() << " blocks, "
+              << trace->get_size() << " bytes ("
+              << std::fixed << std::setprecision(2)
+              << (total.m_records ? double(trace->get_size()) / total.m_records : 0) << " per instruction)"
+              << std::endl;
+
+    if(total.m_bad_blocks > 0)
+    {
+        std::cout << total.m_bad_blocks << " blocks could not be fully decoded" << std::endl;
+    }
+
+    if(total.m_records != trace->get_records())
+    {
+        std::cout << "expected " << trace->get_records() << " instructions from the block headers" << std::endl;
+    }
+
+    // every decode table slot's name, from any instruction that decodes to it
+    std::vector<const char*> mnemonics(nchip8::cpu::get_op_count(), "???");
+    for(std::uint32_t opcode = 0; opcode <= 0xFFFF; opcode++)
+    {
+        const nchip8::cpu::op_info op = nchip8::cpu::get_op_info(opcode);
+        mnemonics[op.m_index] = op.m_mnemonic;
+    }
+
+    std::cout << "\ninstructions:" << std::endl;
+    for(const std::size_t &m : get_top(total.m_ops, total.m_ops.size()))
+    {
+        std::cout << "  " << std::left << std::setw(14) << mnemonics[m] << std::right << std::setw(14)
+                  << total.m_ops[m] << std::setw(8) << std::setprecision(1)
+                  << 100.0 * total.m_ops[m] / total.m_records << "%" << std::endl;
+    }
+
+    std::vector<std::pair<std::uint32_t, std::uint64_t>> loops(total.m_loops.begin(), total.m_loops.end());
+    std::sort(loops.begin(), loops.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    if(loops.size() > top) { loops.resize(top); }
+
+    std::cout << "\nhot loops:" << std::endl;
+    for(const auto &loop : loops)
+    {
+        std::cout << "  " << std::hex << std::setfill('0') << std::setw(3) << (loop.first >> 12)
+                  << " -> " << std::setw(3) << (loop.first & 0xFFF) << std::setfill(' ') << std::dec
+                  << std::setw(14) << loop.second << std::endl;
+    }
+
+    std::array<std::uint64_t, 0x1000> skips {};
+    for(std::size_t pc = 0; pc < skips.size(); pc++)
+    {
+        skips[pc] = total.m_taken[pc] + total.m_not_taken[pc];
+    }
+
+    std::cout << "\nconditional skips:" << std::endl;
+    for(const std::size_t &pc : get_top(skips, top))
+    {
+        std::cout << "  " << std::hex << std::setfill('0') << std::setw(3) << pc << std::setfill(' ') << std::dec
+                  << std::setw(14) << skips[pc] << std::setw(8) << std::setprecision(1)
+                  << 100.0 * total.m_taken[pc] / skips[pc] << "% taken" << std::endl;
+    }
+
+    std::cout << "\nhot addresses:" << std::endl;
+    for(const std::size_t &pc : get_top(total.m_pcs, top))
+    {
+        std::cout << "  " << std::hex << std::setfill('0') << std::setw(3) << pc << std::setfill(' ') << std::dec
+                  << std::setw(14) << total.m_pcs[pc] << std::setw(8) << std::setprecision(1)
+                  << 100.0 * total.m_pcs[pc] / total.m_records << "%" << std::endl;
+    }
+
+    return total.m_bad_blocks > 0 ? 1 : 0;
+}
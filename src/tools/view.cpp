@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "nchip8/frame_stream.hpp"
+
+// Usage: nchip8_view <socket path>
+// Renders the frames served by nchip8's frame_server with plain escape codes, two pixel rows per line
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "Usage: nchip8_view <socket path>" << std::endl;
+        return 1;
+    }
+
+    const std::string path = argv[1];
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+
+    if(path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "socket path is too long" << std::endl;
+        return 1;
+    }
+
+    path.copy(address.sun_path, path.size());
+
+    const int fd = ::socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if(fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::cerr << "could not connect to " << path << std::endl;
+        return 1;
+    }
+
+    nchip8::frame_decoder decoder;
+    std::vector<std::uint8_t> message(64 * 1024);
+
+    std::uint64_t frames = 0, bytes = 0, rejected = 0;
+    std::string out;
+
+    // clear, hide the cursor
+    std::cout << "\x1b[2J\x1b[?25l";
+
+    for(ssize_t got = ::recv(fd, message.data(), message.size(), 0); got > 0;
+        got = ::recv(fd, message.data(), message.size(), 0))
+    {
+        bytes += got;
+
+        if(!decoder.decode(message.data(), got))
+        {
+            rejected++;
+            continue;
+        }
+
+        frames++;
+
+        const nchip8::frame_header& header = decoder.get_header();
+        const nchip8::packed_framebuffer& frame = decoder.get_frame();
+
+        auto pixel = [&](const unsigned &x, const unsigned &y)
+        {
+            const std::size_t index = y * header.m_width + x;
+            return (frame[index / 8] >> (7 - index % 8)) & 1;
+        };
+
+        out = "\x1b[H";
+
+        for(unsigned y = 0; y + 1 < header.m_height; y += 2)
+        {
+            for(unsigned x = 0; x < header.m_width; x++)
+            {
+                const bool top = pixel(x, y);
+                const bool bottom = pixel(x, y + 1);
+
+                if(top && bottom)   { out += "█"; }
+                else if(top)        { out += "▀"; }
+                else if(bottom)     { out += "▄"; }
+                else                { out += ' '; }
+            }
+
+            out += "\x1b[K\n";
+        }
+
+        out += "frame " + std::to_string(header.m_sequence)
+             + ", " + std::to_string(bytes / frames) + " bytes/frame average"
+             + (rejected ? ", " + std::to_string(rejected) + " rejected" : std::string())
+             + "\x1b[K\x1b[J";
+
+        std::cout << out << std::flush;
+    }
+
+    // show the cursor again
+    std::cout << "\x1b[?25h" << std::endl;
+
+    ::close(fd);
+    return 0;
+}